@@ -0,0 +1,66 @@
+/** \file BatchDriver.hpp
+ * \brief Process several input files in parallel and merge the results
+ *
+ * Each input file is scanned by its own PixieLDF worker process, writing to
+ * the prefix <output-prefix>_w<N> where N is the index of the file on the
+ * command line. Once all workers have finished, the .his files are summed
+ * bin by bin and the root files are merged in input order, so the merged
+ * output is the same as when the files are scanned one after another.
+ *
+ * Large ldf and pld files may also be split into spill-aligned pieces using
+ * their spill index, so that a single run can be scanned by several workers.
+ */
+
+#ifndef __BATCHDRIVER_HPP_
+#define __BATCHDRIVER_HPP_
+
+#include <string>
+#include <vector>
+
+class BatchDriver{
+  private:
+	std::string exe_name; /// The name of this program
+	std::string output_prefix; /// The prefix of the merged output files
+	std::vector<std::string> input_files; /// The input files in processing order
+	std::vector<std::string> worker_args; /// Options passed to each worker
+	unsigned int num_workers; /// The maximum number of workers running at once
+	bool keep_files; /// Do not delete the worker output after merging
+	unsigned int num_pieces; /// Number of spill-aligned pieces each input file is split into (0 = no splitting)
+	std::vector<std::string> piece_files; /// Temporary files holding the pieces of split input files
+	std::vector<std::string> merged_files; /// Worker files which have been merged and may be removed
+
+	/// Return the output prefix of worker index_
+	std::string get_worker_prefix(size_t index_);
+
+	/// Replace each input file with its spill-aligned pieces
+	bool split_inputs();
+
+	/// Start a worker process for input file index_. Return its pid or -1 on failure
+	int start_worker(size_t index_);
+
+	/// Return the root files written by a worker for the given tree (empty for the master tree)
+	std::vector<std::string> get_root_files(const std::string &prefix_, const std::string &tree_);
+
+	/// Return the names of all per-processor root files written by the first worker
+	std::vector<std::string> get_friend_trees();
+
+	/// Sum the .his files of all workers
+	bool merge_his();
+
+	/// Merge the root files of all workers and re-link the friend trees
+	bool merge_root();
+
+  public:
+	BatchDriver();
+
+	/// Print the command line syntax
+	void Help();
+
+	/// Parse the arguments following --batch. Return false if they are invalid
+	bool SetArgs(int argc, char *argv[]);
+
+	/// Run all workers and merge their output. Return false if any step failed
+	bool Run();
+};
+
+#endif // __BATCHDRIVER_HPP_
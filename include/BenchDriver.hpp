@@ -0,0 +1,71 @@
+/** \file BenchDriver.hpp
+ * \brief Build synthetic events in memory to time the analysis stages
+ *
+ * Events are generated for every channel of the map file (using the same
+ * random numbers and pulse shapes as the pixieGen tool) and handed to
+ * Scanner::ProcessRawEvent() one spill at a time, so no input file and no
+ * unpacking are involved. The time spent in ProcessRawEvent() is printed
+ * along with the events/s, and DetectorDriver prints the time per channel of
+ * each trace analyzer, processor and the .his file writes when it is deleted.
+ */
+
+#ifndef __BENCHDRIVER_HPP_
+#define __BENCHDRIVER_HPP_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "StageTimer.hpp"
+#include "SyntheticPulse.hpp"
+
+class PixieEvent;
+
+class BenchDriver{
+  private:
+	std::string exe_name; /// The name of this program
+	std::string output_prefix; /// The prefix of the output files
+	unsigned int num_spills; /// Number of spills to generate
+	unsigned int events_per_spill; /// Number of events in each spill
+	double multiplicity; /// Mean number of channels in an event
+	unsigned int trace_len; /// Number of samples in each trace (0 = no traces)
+	double noise; /// Trace noise in adc channels
+	unsigned long long seed; /// Random number seed
+
+	GenRandom rand; /// Random number generator
+	std::vector<unsigned int> channels; /// Map index of each channel which may fire
+	std::vector<PulseShape> shapes; /// Pulse shape of each channel
+	std::vector<unsigned int> samples; /// Scratch trace
+	double event_time; /// Time of the last generated event (pixie clock ticks)
+	unsigned int spill; /// Number of spills generated so far
+	unsigned long long num_events; /// Number of events generated so far
+	unsigned long long num_channels; /// Number of channels generated so far
+
+	/// Return a new event for channel index_ of the channel list
+	PixieEvent *make_event(unsigned int index_, double time_, unsigned int energy_);
+
+  public:
+	BenchDriver();
+
+	/// Print the command line syntax
+	void Help();
+
+	/// Parse the arguments following --bench. Return false if they are invalid
+	bool SetArgs(int argc, char *argv[]);
+
+	/// Return the prefix of the output files
+	const std::string &GetOutputPrefix() const { return output_prefix; }
+
+	/// Find the channels of the map file. Return false if there are none
+	bool Init();
+
+	/** Append the time ordered channels of the next spill to events_.
+	  * Return the number of channels added (0 once all spills are done).
+	  */
+	size_t NextSpill(std::deque<PixieEvent*> &events_);
+
+	/// Print the number of events and the time spent in ProcessRawEvent()
+	void Print(const StageTimer &scan_timer_) const;
+};
+
+#endif // __BENCHDRIVER_HPP_
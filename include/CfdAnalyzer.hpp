@@ -15,6 +15,8 @@ class CfdAnalyzer : public TraceAnalyzer, public TimingInformation
     CfdAnalyzer();
     virtual bool InitDamm();
     virtual void Analyze(Trace &, const std::string &, const std::string &);
+    virtual bool AppliesTo(const std::string &type, const std::string &subtype) const;
+    virtual bool CanDefer() const { return true; } ///< only timing information is extracted
     virtual ~CfdAnalyzer() {};
 };
 
@@ -29,14 +29,19 @@ class ChanEvent{
     ChanEvent(){ 
     	event = new PixieEvent();
     	trace = new Trace(); 
+    	timing = NULL;
+    	chanID = NULL;
     }
     
     ChanEvent(PixieEvent *event_){ 
     	event = event_; // We will take ownership of the PixieEvent. No need to copy the variables.
     	trace = new Trace(event->adcTrace); // Copy the trace from the PixieEvent (messy, but needed for the Trace class).
+    	timing = NULL;
+    	chanID = NULL;
     }
     
     ~ChanEvent(){ 
+    	delete timing;
     	delete trace;
     	delete event;
     }
@@ -61,17 +66,45 @@ class ChanEvent{
 
     double GetCorrectedTime() const { return correctedTime; } /**< \return the corrected time */
     
-    double GetHighResTime() const { return hires_time; } /**< \return the high-resolution time */
+    /** \return the high-resolution time. It is worked out from the trace
+     * phase on every call, since the deferred trace analysis may have been run
+     * by any other reader of the trace */
+    double GetHighResTime() const {
+        UpdateHighResTime();
+        return hires_time;
+    }
+
+    /** Run any deferred trace analysis and set the high resolution time from
+     * the trace phase, if there is one */
+    void UpdateHighResTime() const;
 
     const Trace& GetTrace() const { return *trace; } /**< \return a reference to the trace */
     
     Trace& GetTrace() { return *trace; } /** \return a reference which can alter the trace */
 
-    //! \return The identifier in the map for the channel event
-    const Identifier& GetChanID() const;
+    /** \return the timing information of the channel. It is computed from the
+     * trace the first time it is requested and shared by all processors */
+    const TimingInformation::TimingData& GetTimingData() const;
+
+    /** \return The identifier in the map for the channel event. It is looked
+     * up in the DetectorLibrary the first time it is requested unless it was
+     * already set with SetChanID() */
+    const Identifier& GetChanID() const {
+        if (!chanID)
+            chanID = &DetectorLibrary::get()->at(event->modNum, event->chanNum);
+        return *chanID;
+    }
+
+    /** Set the identifier of the channel, so that GetChanID() does not have
+     * to look it up. The identifier must stay in the DetectorLibrary for the
+     * lifetime of the event
+     * \param [in] id_ : the identifier of this channel */
+    void SetChanID(const Identifier *id_) {chanID = id_;}
     
     /** \return the channel id defined as pixie module # * 16 + channel number */
-    int GetID() const;
+    int GetID() const {
+        return DetectorLibrary::get()->GetIndex(event->modNum, event->chanNum);
+    }
 
 	/////////////////////////////////////////////////////////////////
 	// Gets/Sets for raw channel variables from PixieEvent class.
@@ -121,9 +154,11 @@ class ChanEvent{
 private:
     double calEnergy; /**< Calibrated channel energy. */
     double correctedTime; /**< Energy-walk corrected time. */
-	double hires_time; /**< timing resolution less than 1 adc size */
+	mutable double hires_time; /**< timing resolution less than 1 adc size */
 
     Trace *trace; /**< Channel trace if present */
+    mutable TimingInformation::TimingData *timing; /**< Cached timing information (NULL until requested) */
+    mutable const Identifier *chanID; /**< Identifier of the channel in the DetectorLibrary (NULL until requested) */
 
     void ZeroNums(void); /**< Zero members which do not have constructors associated with them */
 
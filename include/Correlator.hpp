@@ -7,6 +7,7 @@
 #ifndef __CORRELATOR_PROCESSOR_HPP_
 #define __CORRELATOR_PROCESSOR_HPP_
 
+#include <deque>
 #include <utility>
 #include <vector>
 
@@ -57,6 +58,7 @@ class CorrelationList : public std::vector<EventInfo>
 {
 private:
     bool flagged;
+    bool dropped; ///< the last event for this list was not stored because it was full
 public:
     CorrelationList();
     double GetDecayTime(void) const;
@@ -65,6 +67,11 @@ public:
     bool IsFlagged(void) const;
     // overide the vector clear function so that the flag is also removed
     void clear(void);
+    // remove everything but the implant and the flag
+    void Trim(void);
+    // mark whether the last event for this list was dropped
+    void SetDropped(bool a) {dropped = a;}
+    bool IsDropped(void) const {return dropped;}
     void PrintDecayList(void) const;
 };
 
@@ -79,6 +86,11 @@ public:
   correlator checks to make sure that the time between implants is
   sufficiently long and that the correlation time has not been exceeded
   before correlating an implant with a decay.
+
+  Pixels whose decay lists are not empty are kept in an index, as are the
+  live pixels whose implant is still inside the correlation window, so that
+  operations on the whole detector only visit those pixels. Once the window
+  has passed a list is trimmed back to its implant.
 */
 class Correlator
 {
@@ -90,6 +102,7 @@ public:
 		      BACK_TO_BACK_IMPLANT = 32,
 		      DECAY_TOO_LATE       = 48,
 		      IMPLANT_TOO_SOON     = 52,
+		      LIST_FULL            = 56,
 		      UNKNOWN_CONDITION    = 100};
     
     Correlator();
@@ -128,6 +141,26 @@ private:
     }
         
     static const size_t arraySize = 40; /**< Size of the 2D array to hold the decay lists */
+    static const size_t maxListSize = 1000; /**< Maximum number of events stored for one pixel */
+
+    /// set of pixels which allows constant time insertion and removal
+    class PixelIndex {
+    public:
+	PixelIndex();
+	void Add(unsigned int fch, unsigned int bch);
+	void Remove(unsigned int fch, unsigned int bch);
+	void Clear(void);
+	bool Has(unsigned int fch, unsigned int bch) const {
+	    return position[fch][bch] >= 0;
+	}
+	/// pixels in the set, encoded as fch * arraySize + bch
+	const std::vector<unsigned int>& GetPixels(void) const {
+	    return pixels;
+	}
+    private:
+	std::vector<unsigned int> pixels;
+	int position[arraySize][arraySize]; ///< index of each pixel in pixels, -1 if absent
+    };
 
     // in units of pixie clocks
     static const double minImpTime; /**< The minimum amount of time that must
@@ -143,6 +176,14 @@ private:
     
     EConditions condition;     ///< condition for last processed event
     CorrelationList decaylist[arraySize][arraySize]; ///< list of event data for a particular pixel since implant
+
+    PixelIndex occupied; ///< pixels with a non-empty decay list
+    PixelIndex live;     ///< pixels whose implant is inside the correlation window
+    std::deque< std::pair<double, unsigned int> > expiryQueue; ///< (implant time, pixel) in order of implantation
+    unsigned long droppedEvents; ///< events not stored because a decay list was full
+
+    void ClearPixel(unsigned int fch, unsigned int bch);
+    void Expire(double time);
 };
 
 #endif // __CORRELATOR_PROCESSOR_HPP_
@@ -35,6 +35,7 @@ namespace dammIds {
         const int DD_BUFFER_START_TIME = 1808;
         const int DD_RUNTIME_MSEC      = 1810;
         const int D_NUMBER_OF_EVENTS   = 1811;
+        const int DD_STAGE_LATENCY     = 1812; /**< Filled at the end of the run */
     }
 
     namespace mcp {	
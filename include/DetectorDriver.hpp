@@ -1,10 +1,11 @@
 /** \file DetectorDriver.hpp
  * \brief Header file for the detector driver program.
  *
- * Defines two classes, Calibration and DetectorDriver
+ * Defines three classes, Calibration, CalibrationTable and DetectorDriver
  * Calibration is resonsible for the calibration information
- * read into the analysis from the file cal.txt.  DetectorDriver
- * controls the flow of event processing.
+ * read into the analysis from the file cal.txt. CalibrationTable is a
+ * compact copy of all calibrations which is used for each event.
+ * DetectorDriver controls the flow of event processing.
  *
  * \author S. Liddick 
  * \date 02 July 07
@@ -26,14 +27,17 @@
 #include "Globals.hpp"
 #include "MapFile.hpp"
 #include "ChanEvent.hpp"
+#include "StageTimer.hpp"
 #include "VandleProcessor.hpp"
 
 // forward declarations
 class Calibration;
+class CalibrationTable;
 class RawEvent;
 class EventProcessor;
 class TraceAnalyzer;
 class OutputHisFile;
+class EventDumpWriter;
 
 using std::pair;
 using std::set;
@@ -69,6 +73,87 @@ struct ConfigArgs{
 	}
 };
 
+/**
+  \brief A set of root output files and trees which are filled together
+
+  The master tree holds the raw event and, unless the processors are split
+  into their own friend trees, all processor branches.
+*/
+struct RootOutput{
+	TFile *masterFile;
+	TTree *masterTree;
+	vector<TFile *> friendFiles; /**< per-processor output files (NULL if the tree lives in masterFile) */
+	vector<TTree *> friendTrees; /**< per-processor friend trees (NULL if not in use) */
+	
+	RootOutput(){ masterFile = NULL; masterTree = NULL; }
+	
+	// Return true if the files are open
+	bool IsOpen(){ return (masterFile != NULL); }
+	
+	// Fill the master tree and all friend trees
+	void Fill();
+	
+	// Write all trees and flush their files to disk
+	void Flush();
+	
+	// Return the size of the largest output file in bytes
+	Long64_t GetSize();
+	
+	// Write all trees to file and close all files. Return the number of bytes written
+	Long64_t Close();
+	
+	// Close all files and delete them from disk
+	void Discard();
+};
+
+/**
+  \brief compact table of all channel calibrations
+
+  The calibrations read from cal.txt are compiled into flat arrays of
+  thresholds and coefficients which are indexed by channel id. Polynomials
+  are evaluated with Horner's method and single range linear calibrations,
+  the most common case, skip the range search entirely.
+ */
+class CalibrationTable {
+ private:
+    struct Entry {
+	double low;          /**< the lowest calibration threshold */
+	double high;         /**< the upper limit of the calibration */
+	double offset;       /**< constant coefficient of a linear calibration */
+	double slope;        /**< linear coefficient of a linear calibration */
+	unsigned int firstThresh; /**< index of the first threshold of this channel */
+	unsigned int firstCoeff;  /**< index of the first coefficient of this channel */
+	unsigned int numCal; /**< the number of calibrations for this channel */
+	unsigned int order;  /**< the order of the calibration */
+	bool linear;         /**< true for a single linear calibration */
+    };
+
+    vector<Entry> entries;  /**< one entry per channel id */
+    vector<double> thresh;  /**< the numCal+1 thresholds of each channel, in order */
+    vector<double> coeffs;  /**< the numCal*(order+1) coefficients of each channel, in order */
+
+    double calibrate(const Entry &entry, double raw) const; /**< evaluate a multi range or higher order calibration */
+
+ public:
+    /** Compile the table from the calibration vector */
+    void Compile(const vector<Calibration> &cal);
+
+    /** Return the number of channels in the table */
+    size_t GetSize() const { return entries.size(); }
+    
+    /** Return a calibrated energy for raw value from channel id */
+    double Calibrate(size_t id, double raw) const {
+	const Entry &entry = entries[id];
+	if (raw < entry.low) { return 0; }
+	if (raw >= entry.high) { return entry.high - 1; }
+	if (entry.linear) { return entry.offset + entry.slope * raw; }
+	return calibrate(entry, raw);
+    }
+
+    /** Calibrate num raw values from channels ids in one pass. Results are written to calibrated */
+    void Calibrate(const unsigned int *ids, const double *raw, double *calibrated, size_t num) const;
+};
+
 /**
   \brief DetectorDriver controls event processing
 
@@ -79,6 +164,7 @@ struct ConfigArgs{
 class DetectorDriver {    
  private: 
     static DetectorDriver* instance;
+    static bool replay; /**< true if the events are replayed from a dump */
     
     // Variables related to the root output
     unsigned long long num_events;
@@ -88,17 +174,44 @@ class DetectorDriver {
     ConfigArgs config_args;
     std::string root_fname; 
 	OutputHisFile *his_file;
-    TFile *masterFile;
-    TTree *masterTree;
+    RootOutput output; /**< root files currently being filled */
+    RootOutput next_output; /**< root files pre-opened for the next rollover */
+    Long64_t max_file_size; /**< output size (in bytes) which triggers a rollover */
+    bool split_trees; /**< write each processor to its own friend tree */
+    bool split_files; /**< write each friend tree to its own file */
+    int root_compression; /**< compression settings for physics branches */
+    int wave_compression; /**< compression settings for waveform branches */
+    EventDumpWriter *dump_file; /**< columnar dump of built events (NULL if not in use) */
     bool is_init;
     bool write_raw;
     time_t start_time;
 
     vector<EventProcessor *> vecProcess; /**< vector of processors to handle each event */
     vector<TraceAnalyzer *> vecAnalyzer; /**< object which analyzes traces of channels to extract energy and time information */
+    vector<vector<TraceAnalyzer *> > analyzerChains; /**< analyzers which apply to the traces of each channel id, built at init */
+    vector<vector<TraceAnalyzer *> > deferredChains; /**< analyzers of each channel id which only run when a result is requested */
     set<string> knownDetectors; /**< list of valid detectors that can be used as detector types */
     pair<double, time_t> pixieToWallClock; /**< rough estimate of pixie to wall clock */ 
 
+    vector<ChanEvent*> calChans; /**< channels of the current event which need calibration */
+    vector<unsigned int> calIds; /**< ids of the channels in calChans */
+    vector<double> calRaw; /**< raw energies of the channels in calChans */
+    vector<double> calValues; /**< calibrated energies of the channels in calChans */
+    vector<unsigned long long> calKeys; /**< random number keys (timestamps) of the channels in calChans */
+    vector<double> calDither; /**< 1 if the raw energy of a channel in calChans is an integer which must be dithered */
+
+    unsigned long long random_seed; /**< run key of the random numbers used to dither energies */
+
+    StageTimer event_timer; /**< time spent in ProcessEvent */
+    StageTimer cal_timer; /**< time spent calibrating channels, including trace analysis */
+    StageTimer fill_timer; /**< time spent filling the root trees */
+
+    void PrintTiming(); /**< print the timing of every stage and fill the stage latency spectrum */
+    void BuildAnalyzerChains(); /**< select the analyzers for each channel from its type and subtype */
+
+    bool GetRawEnergy(ChanEvent *chan, double &energy, bool &dither); /**< analyze the trace and return the energy to be calibrated */
+    void AddToSummaries(ChanEvent *chan, RawEvent& rawev); /**< add a calibrated channel to its detector summaries */
+
     virtual void DeclareHistogram1D(int dammId, int xSize, const char* title) {
         histo.DeclareHistogram1D(dammId, xSize, title);
     }
@@ -114,7 +227,13 @@ class DetectorDriver {
     DetectorDriver& operator= (DetectorDriver const&);
   
     static DetectorDriver* get();
+    static DetectorDriver* get(const std::string &output_filename_);
+
+    /** Mark the scan as a replay of an event dump. No new dump is written, so
+     * the dump being read can not be overwritten. Call before the first get() */
+    static void SetReplay(bool state_){ replay = state_; }
     vector<Calibration> cal; /**<the calibration vector*/ 
+    CalibrationTable calTable; /**< compiled copy of the calibration vector used for each event */
 
     Plots histo;
     
@@ -126,6 +245,7 @@ class DetectorDriver {
 
     int ProcessEvent(RawEvent& rawev);
     int ThreshAndCal(ChanEvent *, RawEvent& rawev);
+    int ThreshAndCal(vector<ChanEvent*> &chans, RawEvent& rawev);
     bool Init(RawEvent& rawev);
     
     // Open the RootPixieScan configuration file
@@ -134,6 +254,9 @@ class DetectorDriver {
     // Close the current root file and open a new one with a new name
     bool OpenNewFile();
     
+    // Open the next set of root files and add all processor branches
+    bool OpenFiles(RootOutput &files);
+    
     int PlotRaw(const ChanEvent *);
     int PlotCal(const ChanEvent *);
 
@@ -182,6 +305,7 @@ class Calibration {
     Calibration();
 
     friend void DetectorDriver::ReadCal(void);
+    friend class CalibrationTable;
 };
 
 #endif // __DETECTORDRIVER_HPP_
@@ -11,7 +11,9 @@
 #include <vector>
 
 #include "ChanIdentifier.hpp"
-#include "RawEvent.hpp"
+#include "Globals.hpp"
+
+class RawEvent;
 
 class DetectorLibrary : public std::vector<Identifier>
 {
@@ -23,6 +25,12 @@ public:
     virtual reference at(size_type mod, size_type ch);
     virtual reference at(size_type idx);
 
+    /** Flat lookup of the identifier at idx, without the virtual call and the
+     * bounds check of at(). idx must be less than size() */
+    const_reference Lookup(size_type idx) const {return std::vector<Identifier>::operator[](idx);}
+    /** Flat lookup of the identifier of module mod, channel ch */
+    const_reference Lookup(int mod, int ch) const {return Lookup(GetIndex(mod, ch));}
+
     virtual void push_back(const Identifier &x);
     virtual ~DetectorLibrary();
 
@@ -31,7 +39,7 @@ public:
     int GetNextLocation(const Identifier &id) const;
     int GetNextLocation(const std::string &type, 
 			const std::string &subtype) const;
-    size_type GetIndex(int mod, int chan) const;
+    size_type GetIndex(int mod, int chan) const {return mod * pixie::numberOfChannels + chan;}
     int ModuleFromIndex(int index) const;
     int ChannelFromIndex(int index) const;
 
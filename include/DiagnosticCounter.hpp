@@ -0,0 +1,40 @@
+/** \file DiagnosticCounter.hpp
+ * \brief Count a recurring condition and limit how often it is reported
+ *
+ * Count() returns true for the 1st, 2nd, 4th, 8th, ... occurrence, so that
+ * a message printed only when it returns true costs nothing at high rates
+ * while still showing that the condition keeps happening.
+ */
+
+#ifndef __DIAGNOSTICCOUNTER_HPP_
+#define __DIAGNOSTICCOUNTER_HPP_
+
+#include <iostream>
+#include <string>
+
+class DiagnosticCounter{
+  private:
+	std::string name; /// Name printed by PrintTotal()
+	unsigned long long count; /// Number of calls to Count()
+	unsigned long long nextReport; /// Value of count at which Count() next returns true
+
+  public:
+	DiagnosticCounter(const std::string &name_) : name(name_), count(0), nextReport(1) {}
+
+	/// Count one occurrence, return true if it should be reported
+	bool Count(){
+		if(++count < nextReport){ return false; }
+		nextReport *= 2;
+		return true;
+	}
+
+	/// Return the number of occurrences so far
+	unsigned long long GetCount() const { return count; }
+
+	/// Print the total number of occurrences, if there were any
+	void PrintTotal(const std::string &prefix_) const {
+		if(count > 0){ std::cout << " " << prefix_ << ": " << count << " " << name << std::endl; }
+	}
+};
+
+#endif // __DIAGNOSTICCOUNTER_HPP_
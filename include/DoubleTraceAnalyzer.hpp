@@ -10,6 +10,7 @@
 #include <string>
 #include <sys/times.h>
 
+#include "DiagnosticCounter.hpp"
 #include "Trace.hpp"
 #include "TraceFilterer.hpp"
 
@@ -26,6 +27,11 @@ class DoubleTraceAnalyzer : public TraceFilterer
     double energy2;         ///< energy of second pulse
     
     int numDoubleTraces; ///< number of double traces found
+
+    TracePulses pulses; ///< pulses found in the current trace
+
+    DiagnosticCounter tripleTraces;  ///< traces with three or more pulses
+    DiagnosticCounter tooManyPulses; ///< traces with more than TracePulses::maxPulses pulses
  public:
     DoubleTraceAnalyzer();
     virtual ~DoubleTraceAnalyzer();
@@ -33,6 +39,7 @@ class DoubleTraceAnalyzer : public TraceFilterer
     virtual bool Init(void) {return TraceFilterer::Init();}
     virtual void DeclarePlots(void);
     virtual void Analyze(Trace &, const std::string &, const std::string &);
+    virtual bool AppliesTo(const std::string &type, const std::string &subtype) const;
 };
 
 #endif // __DOUBLETRACEANALYZER_HPP_
@@ -0,0 +1,191 @@
+/** \file EventDump.hpp
+ * \brief Columnar dump of built events for fast re-analysis
+ *
+ * Built events are written in chunks of up to EVENT_DUMP_CHUNK channels.
+ * Within a chunk, each channel variable is stored as a contiguous column so
+ * that the dump may be memory mapped and replayed without any unpacking.
+ *
+ * Dump file layout (.pxd):
+ *  EventDumpHeader
+ *  chunk 0 : EventDumpChunk, followed by the columns
+ *   double time[nchan]               raw pixie time
+ *   double energy[nchan]             raw pixie energy
+ *   u_long_long trace[nchan+1]       trace start offsets into the .pxt file (only if traces are stored)
+ *   u_int event[nevent+1]            index of the first channel of each event within the chunk
+ *   u_int id[nchan]                  channel id (module * 16 + channel)
+ *   u_int flags[nchan]               EVENT_DUMP_* flag bits
+ *   u_int trigTime[nchan]            channel trigger time
+ *   u_int eventTimeLo[nchan]         lower 32 bits of the event time
+ *   u_int eventTimeHi[nchan]         upper 32 bits of the event time
+ *   u_int qdc[nchan][EVENT_DUMP_QDCS] onboard QDC values of each channel
+ *   padding to a multiple of 8 bytes
+ *  chunk 1 ...
+ *
+ * Trace file layout (.pxt): 16-bit trace samples for all channels, back to back.
+ */
+
+#ifndef __EVENTDUMP_HPP_
+#define __EVENTDUMP_HPP_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class RawEvent;
+class PixieEvent;
+
+#define EVENT_DUMP_CHUNK 65536 // Maximum number of channels per chunk
+#define EVENT_DUMP_VERSION 2
+#define EVENT_DUMP_QDCS 8 // Onboard QDC values stored per channel
+
+// Channel flag bits
+#define EVENT_DUMP_PILEUP 0x1
+#define EVENT_DUMP_SATURATED 0x2
+#define EVENT_DUMP_CFD_FORCE 0x4
+#define EVENT_DUMP_CFD_SOURCE 0x8
+
+// Header flag bits
+#define EVENT_DUMP_HAS_TRACES 0x1
+
+/// Header at the start of every dump file (16 bytes)
+struct EventDumpHeader{
+	char magic[8]; /// "PXDUMP\0\0"
+	unsigned int version; /// Format version (EVENT_DUMP_VERSION)
+	unsigned int flags; /// EVENT_DUMP_HAS_TRACES if a .pxt trace file was written
+};
+
+/// Header at the start of every chunk (16 bytes)
+struct EventDumpChunk{
+	unsigned int magic; /// Chunk marker (0x4B4E4843, "CHNK")
+	unsigned int nevent; /// Number of events in the chunk
+	unsigned int nchan; /// Number of channels in the chunk
+	unsigned int size; /// Size of the columns following this header in bytes
+};
+
+/// Zero-copy view of a single event in a memory mapped dump
+struct EventDumpView{
+	unsigned int size; /// Number of channels in the event
+	const double *time; /// Raw pixie times
+	const double *energy; /// Raw pixie energies
+	const unsigned int *id; /// Channel ids (module * 16 + channel)
+	const unsigned int *flags; /// EVENT_DUMP_* flag bits
+	const unsigned int *trigTime; /// Channel trigger times
+	const unsigned int *eventTimeLo; /// Lower 32 bits of the event times
+	const unsigned int *eventTimeHi; /// Upper 32 bits of the event times
+	const unsigned int *qdc; /// Onboard QDC values (EVENT_DUMP_QDCS per channel)
+	const unsigned long long *trace; /// Trace start offsets (size+1 entries), NULL if no traces
+	const unsigned short *samples; /// Start of the trace sample file, NULL if no traces
+
+	EventDumpView(){
+		size = 0; time = NULL; energy = NULL; id = NULL; flags = NULL;
+		trigTime = NULL; eventTimeLo = NULL; eventTimeHi = NULL; qdc = NULL;
+		trace = NULL; samples = NULL;
+	}
+
+	/// Return a new PixieEvent filled with the values of channel index_. The caller takes ownership
+	PixieEvent *GetPixieEvent(unsigned int index_) const;
+};
+
+/// Writes built events to a columnar dump file
+class EventDumpWriter{
+  private:
+	std::ofstream dump_file;
+	std::ofstream trace_file;
+	bool write_traces;
+	bool init;
+
+	unsigned long long num_events; /// Total number of events written
+	unsigned long long num_samples; /// Total number of trace samples written
+
+	// Columns for the current chunk
+	std::vector<double> time;
+	std::vector<double> energy;
+	std::vector<unsigned long long> trace;
+	std::vector<unsigned int> event;
+	std::vector<unsigned int> id;
+	std::vector<unsigned int> flags;
+	std::vector<unsigned int> trigTime;
+	std::vector<unsigned int> eventTimeLo;
+	std::vector<unsigned int> eventTimeHi;
+	std::vector<unsigned int> qdc;
+	std::vector<unsigned short> samples;
+
+	/// Write the current chunk to disk and reset the columns
+	bool flush();
+
+  public:
+	EventDumpWriter(){ init = false; write_traces = false; num_events = 0; num_samples = 0; }
+
+	EventDumpWriter(const std::string &prefix_, bool write_traces_=false);
+
+	~EventDumpWriter(){ Close(); }
+
+	/// Open prefix_.pxd (and prefix_.pxt if write_traces_ is set) for writing
+	bool Open(const std::string &prefix_, bool write_traces_=false);
+
+	/// Return true if the dump file is open for writing
+	bool IsOpen(){ return init; }
+
+	/// Add all channels in a built event to the dump
+	bool Append(const RawEvent &event_);
+
+	/// Return the number of events written so far
+	unsigned long long GetNumEvents(){ return num_events; }
+
+	/// Flush the last chunk and close the output files
+	void Close();
+};
+
+/// Memory maps a columnar dump file and provides zero-copy access to its events
+class EventDumpReader{
+  private:
+	struct ChunkInfo{
+		const char *ptr; /// Start of the chunk columns
+		unsigned int nevent;
+		unsigned int nchan;
+		unsigned long long first_event; /// Index of the first event of this chunk in the file
+	};
+
+	const char *dump_map;
+	size_t dump_size;
+	const char *trace_map;
+	size_t trace_size;
+	bool has_traces;
+	bool init;
+
+	std::vector<ChunkInfo> chunks; /// Chunk index, built when the file is opened
+	size_t last_chunk; /// Chunk of the last event requested
+	unsigned long long num_events;
+	unsigned long long num_chans;
+
+	/// Map an entire file into memory. Return NULL on failure
+	static const char *map_file(const std::string &fname_, size_t &size_);
+
+  public:
+	EventDumpReader();
+
+	~EventDumpReader(){ Close(); }
+
+	/// Map fname_ (and its .pxt trace file if present) and build the chunk index
+	bool Open(const std::string &fname_);
+
+	/// Return true if a dump is mapped
+	bool IsOpen(){ return init; }
+
+	/// Return true if traces are available
+	bool HasTraces(){ return has_traces; }
+
+	/// Return the total number of events in the dump
+	unsigned long long GetNumEvents(){ return num_events; }
+
+	/// Return the total number of channels in the dump
+	unsigned long long GetNumChannels(){ return num_chans; }
+
+	/// Fill view_ with pointers to event number index_. Return false if index_ is out of range
+	bool GetEvent(unsigned long long index_, EventDumpView &view_);
+
+	/// Unmap the dump files
+	void Close();
+};
+
+#endif // __EVENTDUMP_HPP_
@@ -8,9 +8,9 @@
 #include <map>
 #include <set>
 #include <string>
-#include <time.h>
 
 #include "Plots.hpp"
+#include "StageTimer.hpp"
 
 #include "TreeCorrelator.hpp"
 #include "TimingInformation.hpp"
@@ -29,8 +29,7 @@ class EventProcessor : public TimingInformation{
     
  protected:
     // things associated with timing
-	long total_time;
-	clock_t start_time;
+    StageTimer timer;
 
     // define the associated detector types and only initialize if present
     std::string name;
@@ -50,6 +49,9 @@ class EventProcessor : public TimingInformation{
     virtual void plot(int dammId, double val1, double val2 = -1, double val3 = -1, const char* name="h") {
         histo.Plot(dammId, val1, val2, val3, name);
     }
+    virtual void plotRange(int dammId, int x, int y, int count, int weight = 1) {
+        histo.PlotRange(dammId, x, y, count, weight);
+    }
     virtual void DeclareHistogram1D(int dammId, int xSize, const char* title) {
         histo.DeclareHistogram1D(dammId, xSize, title);
     }
@@ -81,10 +83,20 @@ class EventProcessor : public TimingInformation{
     virtual bool Process(RawEvent &event); 
     
     // Start the process timer
-    void StartProcess(){ start_time = clock(); }
+    void StartProcess(){ timer.Start(); }
     
     // Update the amount of time taken by the processor
-    void EndProcess(void){ total_time += (clock() - start_time); }
+    void EndProcess(void){ timer.Stop(); }
+    
+    // Count the channels of the associated types in this event as handled by
+    // the processor. Called once per event, as PreProcess and Process are both timed
+    void CountChannels(void){ timer.AddChannels(GetMult()); }
+    
+    // Return the number of channels of the associated types in this event
+    unsigned int GetMult(void) const;
+    
+    // Return the timing information of the processor
+    const StageTimer& GetTimer(void) const { return timer; }
     
     std::string GetName(void) const {
       return name;
@@ -14,6 +14,8 @@ class FittingAnalyzer : public TraceAnalyzer, public TimingInformation
     FittingAnalyzer();
     virtual bool InitDamm();
     virtual void Analyze(Trace &, const std::string &, const std::string &);
+    virtual bool AppliesTo(const std::string &type, const std::string &subtype) const;
+    virtual bool CanDefer() const { return true; } ///< only timing information is extracted
     virtual ~FittingAnalyzer() {};
  
     struct FitData{
@@ -11,6 +11,8 @@
 #include "EventProcessor.hpp"
 #include "RawEvent.hpp"
 
+class Place;
+
 namespace dammIds {
     namespace ge {
         // clovers
@@ -114,12 +116,25 @@ class GeProcessor : public EventProcessor
 protected:
     static const unsigned int chansPerClover = 4; /*!< number of channels per clover */
     
-    std::map<int, int> leafToClover;   /*!< Translate a leaf location to a clover number */
+    std::vector<int> leafToClover;     /*!< Translate a leaf location to a clover number (0 if not a leaf) */
+    std::vector<ChanEvent*> lowByLocation; /*!< Low gain event of each location in the current event */
     std::vector<float> timeResolution; /*!< Contatin time resolutions used */
     unsigned int numClovers;           /*!< number of clovers in map */
+    bool tablesBuilt;                  /*!< leafToClover and lowByLocation are filled */
+
+    /** Fill leafToClover and lowByLocation from the map */
+    void BuildCloverTables(void);
 
     double WalkCorrection(double e);
 
+    /** Returns the clover number of a leaf location */
+    int CloverOf(int location) const {
+        return (location >= 0 && (unsigned int)location < leafToClover.size()) ? leafToClover[location] : 0;
+    }
+
+    /** Returns the place or NULL if it is not defined in the TreeCorrelator configuration */
+    static Place* FindPlace(const std::string &name);
+
     /** Returns lowest difference between gamma and beta times. Takes gTime in pixie clock units.
      * returns value in seconds. */
     double GammaBetaDtime(double gTime);
@@ -131,6 +146,9 @@ protected:
 
     vector<GGate> gGates;
     vector<ChanEvent*> geEvents_; /*!< Preprocessed good ge events, filled in PreProcess, removed in Process*/
+    vector<int> geClovers_;       /*!< Clover number of each event in geEvents_ */
+    vector<double> geBetaDtime_;  /*!< Gamma-beta time difference of each event in geEvents_ (s) */
+    vector<unsigned int> geAbove_; /*!< Indexes of the events in geEvents_ above gammaThreshold */
 
     void DeclareHistogramGranY(int dammId, int xsize, int ysize, 
 			       const char *title, int halfWordsPerChan,
@@ -147,9 +165,10 @@ protected:
 
 public:
     GeProcessor(); // no virtual c'tors
+    virtual bool Init(RawEvent &event);
+    virtual bool InitDamm(void);
     virtual bool PreProcess(RawEvent &event);
     virtual bool Process(RawEvent &event);
-    virtual void DeclarePlots(void);
 };
 
 #endif // __GEPROCESSOR_HPP_
@@ -3,6 +3,10 @@
 
 #include <fstream>
 #include <vector>
+#include <string>
+#include <utility>
+
+#include "StageTimer.hpp"
 
 class TH1I;
 class TH2I;
@@ -46,6 +50,9 @@ class HisData{
 	/// Read histogram data from an input histogram file
 	bool Read(std::ifstream *input_);
 	
+	/// Return the number of elements in the array
+	size_t GetSize(){ return size; }
+	
 	/// Return a pointer to the raw data array
 	unsigned int *GetData(){ return data; }
 	
@@ -144,14 +151,33 @@ struct fill_queue{
 	drr_entry *entry; /// .drr entry of the histogram to be filled
 	unsigned int byte; /// Offset of bin (in bytes)
 	unsigned int weight; /// Weight of fill
+	unsigned int count; /// Number of consecutive bins to fill
 	bool good; /// True if the histo array index is within range
 	
-	fill_queue(drr_entry *entry_, unsigned int bin_, unsigned int w_){
-		entry = entry_; byte = bin_ * entry->halfWords * 2; weight = w_; good = entry->check_bin(bin_);
+	fill_queue(drr_entry *entry_, unsigned int bin_, unsigned int w_, unsigned int count_=1){
+		entry = entry_; byte = bin_ * entry->halfWords * 2; weight = w_; count = count_; good = entry->check_bin(bin_);
 		if(byte < 0){ std::cout << " his id = " << entry_->hisID << " byte offset is less than zero (" << byte << ")!\n"; }
 	}
 };
 
+/** Zero-copy view of the cells of one histogram in a memory mapped .his file.
+  * Cells of 4 bytes may not be aligned, so they are always read with memcpy.
+  */
+struct HisView{
+	drr_entry *entry; /// The .drr entry of the histogram
+	const char *data; /// Start of the histogram in the .his file
+	bool use_int; /// True if the size of a cell is 4 bytes
+	size_t size; /// Number of cells
+	
+	HisView(){ entry = NULL; data = NULL; use_int = false; size = 0; }
+	
+	/// Return the value of a single cell. No range checking!
+	unsigned int Get(size_t bin_) const;
+	
+	/// Copy count_ cells starting at start_ into output_, widening 2 byte cells. No range checking!
+	void Copy(size_t start_, size_t count_, unsigned int *output_) const;
+};
+
 class HisFile{
   protected:
 	bool is_good; /// True if a valid drr file is open
@@ -159,6 +185,8 @@ class HisFile{
 	bool debug_mode; /// True if debug mode is set
 	std::ifstream drr; /// The input .drr file
 	std::ifstream his; /// The input .his file
+	const char *his_map; /// The memory mapped .his file (NULL if not mapped)
+	size_t his_map_size; /// Size of the memory mapped .his file in bytes
 	
 	int hists_processed; /// The number of histograms which have been processed
 	int err_flag; /// Integer value for storing error information
@@ -185,6 +213,12 @@ class HisFile{
 	/// Delete all drr entries and clear the entries vector
 	void clear_drr_entries();
 	
+	/// Map the .his file into memory. Return false if it could not be mapped
+	bool map_his(const std::string &fname_);
+	
+	/// Unmap the .his file
+	void unmap_his();
+	
 	/// Initialize all variables
 	void initialize();
 
@@ -259,6 +293,21 @@ class HisFile{
 	
 	/// Get a pointer to a root TH2I
 	TH2I *GetTH2(int hist_=-1);
+	
+	/** Get a zero-copy view of histogram id_ in the memory mapped .his file.
+	  * This does not change the current entry and may be called from several
+	  * threads at once. Return false if the histogram is not available.
+	  */
+	bool GetView(size_t id_, HisView &view_) const;
+	
+	/// Build a root TH1I from a histogram view
+	static TH1I *MakeTH1(const HisView &view_);
+	
+	/// Build a root TH2I from a histogram view
+	static TH2I *MakeTH2(const HisView &view_);
+
+	/// Return the number of histograms in the .drr file
+	size_t GetNumHistograms(){ return drr_entries.size(); }
 
 	/// Get a drr entry from the vector
 	void GetEntry(size_t id_);
@@ -292,6 +341,7 @@ class OutputHisFile : public HisFile{
 	std::vector<fill_queue*> fills_waiting; /// Vector containing list of histograms to be filled
 	std::vector<unsigned int> failed_fills; /// Vector containing list of histogram fills into an invalid his id
 	std::streampos total_his_size; /// Total size of .his file
+	StageTimer flush_timer; /// Time spent writing queued fills to the .his file (one channel per fill)
 
 	/// Find the specified .drr entry in the drr list using its histogram id
 	drr_entry *find_drr_in_list(unsigned int hisID_);
@@ -315,6 +365,12 @@ class OutputHisFile : public HisFile{
 	/// Set the number of fills to wait between file flushes
 	void SetFlushWait(unsigned int wait_){ flush_wait = wait_; }
 	
+	/// Write all queued fills to the .his file now
+	void Flush(){ flush(); }
+	
+	/// Return the timing information of the writes to the .his file
+	const StageTimer& GetFlushTimer() const { return flush_timer; }
+	
 	/* Push back with another histogram entry. This command will also
 	 * extend the length of the .his file (if possible). DO NOT delete
 	 * the passed drr_entry after calling. OutputHisFile will handle cleanup.
@@ -334,6 +390,12 @@ class OutputHisFile : public HisFile{
 	/// Increment a histogram at bin (x, y) by weight_
 	bool FillBin(unsigned int hisID_, unsigned int x_, unsigned int y_, unsigned int weight_=1);
 	
+	/** Increment count_ consecutive bins of a histogram by weight_, starting at bin (x, y).
+	  * The range continues on the next row at the end of a row of a 2d histogram and is
+	  * clipped at the end of the histogram. The whole range is a single queued fill.
+	  */
+	bool FillRange(unsigned int hisID_, unsigned int x_, unsigned int y_, unsigned int count_, unsigned int weight_=1);
+	
 	/// Zero the specified histogram 
 	bool Zero(unsigned int hisID_);
 	
@@ -346,4 +408,32 @@ class OutputHisFile : public HisFile{
 
 extern OutputHisFile *output_his; /// The global .his file handler
 
+/// Options for CombineHisFiles
+struct HisCombineOptions{
+	bool saturate; /// Clamp cells to the range of the cell size instead of letting them wrap around
+	unsigned int num_threads; /// Number of threads used to combine histograms
+	std::vector<std::pair<unsigned int, unsigned int> > id_ranges; /// Inclusive ranges of histogram ids to combine (all if empty)
+
+	HisCombineOptions(){ saturate = false; num_threads = 1; }
+	
+	/// Return true if histogram id_ should be combined
+	bool Selected(unsigned int id_) const;
+};
+
+/** Combine the .his files of several runs bin by bin as the weighted sum of
+  * weights_[i]*inputs_[i] and write the result to output_ (.his, .drr and .list
+  * if present). All inputs must have been written with the same .drr layout.
+  * Histograms which are not selected are copied from the first input. The
+  * number of cells which did not fit in their cell size (or were negative) is
+  * returned in overflows_. Return false on failure.
+  */
+bool CombineHisFiles(const std::vector<std::string> &inputs_, const std::vector<double> &weights_, const std::string &output_, const HisCombineOptions &options_, size_t &overflows_);
+
+/** Add the .his files of several runs bin by bin and write the result to
+  * output_. Cells wrap around exactly as they would have if all runs were
+  * filled into a single file; the number of cells which wrapped is returned in
+  * overflows_. Return false on failure.
+  */
+bool SumHisFiles(const std::vector<std::string> &inputs_, const std::string &output_, size_t &overflows_);
+
 #endif
@@ -8,6 +8,7 @@
 #include "EventProcessor.hpp"
 
 #include "Correlator.hpp"
+#include "DiagnosticCounter.hpp"
 
 // forward declarations
 class RawEvent;
@@ -28,11 +29,14 @@ class ImplantSsdProcessor : public EventProcessor
     unsigned int fastTracesWritten;
     unsigned int highTracesWritten;
 
+    DiagnosticCounter tripleEvents; ///< events with three or more pulses in the trace
+
     EventInfo::EEventTypes SetType(EventInfo &info) const;
     void PlotType(EventInfo &info, int loc, Correlator::EConditions cond);
     void Correlate(Correlator &corr, EventInfo &info, int location);
  public:
     ImplantSsdProcessor(); // no virtual c'tors
+    ~ImplantSsdProcessor();
     virtual void DeclarePlots(void);
     virtual bool Process(RawEvent &event);
 };
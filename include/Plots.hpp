@@ -42,6 +42,8 @@ public:
     
     bool Plot(int dammId, double val1, double val2 = -1, double val3 = -1, const char* name="h");
     bool Plot(const std::string &mne, double val1, double val2 = -1, double val3 = -1, const char* name="h");
+    /** Increment count consecutive bins starting at (x, y) by weight, wrapping onto the following rows */
+    bool PlotRange(int dammId, int x, int y, int count, int weight = 1);
 
     bool BananaTest(const int &id, const double &x, const double &y);
 
@@ -12,6 +12,7 @@
 #include "RawEvent.hpp"
 
 class ChanEvent;
+class Trace;
 
 class PositionProcessor : public EventProcessor
 {
@@ -29,18 +30,24 @@ private:
     float posScale;        //< an arbitrary scale for the position parameter to physical units
     std::vector<float> minNormQdc; //< the minimum normalized qdc observed for a location
     std::vector<float> maxNormQdc; //< the maximum normalized qdc observed for a location
-    
-    ChanEvent* FindMatchingEdge(ChanEvent *match,
-				std::vector<ChanEvent*>::const_iterator begin, 
-				std::vector<ChanEvent*>::const_iterator end) const;				
-    ChanEvent* FindMatchingEdge(ChanEvent *match,
-				std::vector<ChanEvent*>::const_reverse_iterator begin, 
-				std::vector<ChanEvent*>::const_reverse_iterator end) const;				
+
+    std::vector< std::vector<ChanEvent*> > topEdges;    //< top edge events of this event by location
+    std::vector< std::vector<ChanEvent*> > bottomEdges; //< bottom edge events of this event by location
+    std::vector<int> topPrefix;    //< prefix sum of the top trace, for QDCs missing onboard
+    std::vector<int> bottomPrefix; //< prefix sum of the bottom trace, for QDCs missing onboard
+
+    void FillEdges(const std::vector<ChanEvent*> &events,
+                   std::vector< std::vector<ChanEvent*> > &edges) const;
+    void ProcessSum(ChanEvent *sumchan);
+    ChanEvent* FindMatchingEdge(const ChanEvent *match,
+				const std::vector<ChanEvent*> &edges,
+				bool &multiple) const;
+    float TraceQdc(const Trace &trace, int i, std::vector<int> &prefix) const;
 public:
     PositionProcessor(); // no virtual c'tors
     virtual bool Init(RawEvent& rawev);
     virtual bool Process(RawEvent &event);
-    virtual void DeclarePlots(void);
+    virtual bool InitDamm(void);
 };
     
 #endif // __POSITIONPROCESSOR_HPP_
@@ -26,10 +26,38 @@
 #include <cmath>
 #include <string>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "Trace.hpp"
+
+/** Sample windows [low, high) used by PSD_Batch. The same windows are used
+ *  for every trace in the batch. */
+struct PSDGates {
+	unsigned int baselineLow, baselineHigh; ///< baseline window
+	unsigned int shortLow, shortHigh; ///< short (fast component) gate
+	unsigned int longLow, longHigh; ///< long (total) gate
+};
+
+/** PSD_Batch results for one trace */
+struct PSDResult {
+	double baseline; ///< average of the baseline window
+	double shortIntegral; ///< baseline subtracted integral of the short gate
+	double longIntegral; ///< baseline subtracted integral of the long gate
+	double ratio; ///< tail/total, (long - short)/long. -1 if the long integral is not positive
+};
 
 class PulseAnalysis {
     private:
+	/// Sum of n samples (SSE2 if available)
+	static unsigned long long WindowSum (const unsigned short *samples, unsigned int n);
+
+	/// Sum of n samples, one at a time
+	static unsigned long long WindowSumScalar (const unsigned short *samples, unsigned int n);
+
+	/// Fill the results of one trace from its window sums
+	static void FillResult (unsigned long long baseSum, unsigned long long shortSum, unsigned long long longSum, const PSDGates &gates, PSDResult &result);
 
     protected:
 	double deltaT;
@@ -40,6 +68,15 @@ public:
 	void GetVersion();	
 	bool PSD_Integration (Trace&, unsigned int, unsigned int, char, double&, double&);
 	bool Baseline_restore (Trace&, unsigned int, char);
+	
+	/// Return false if a gate is empty or does not fit in traces of this length
+	static bool CheckGates (const PSDGates &gates, unsigned int length);
+	
+	/// PSD of numTraces traces of length samples each, stored back to back (e.g. a .pxt file)
+	static bool PSD_Batch (const unsigned short *traces, size_t numTraces, unsigned int length, const PSDGates &gates, PSDResult *results);
+	
+	/// Same as PSD_Batch without SIMD. The results are identical
+	static bool PSD_BatchScalar (const unsigned short *traces, size_t numTraces, unsigned int length, const PSDGates &gates, PSDResult *results);
 };
 
 /** Constructor  */
@@ -278,3 +315,83 @@ bool PulseAnalysis::Baseline_restore (Trace &pulse, unsigned int iterations, cha
 	
 	return true;
 }
+
+/** ----------------------------------------------------  
+*	Batch PSD by charge integration
+*		- All window sums are exact integers, so the
+*		  SIMD and scalar versions give the same results.
+*		  The baseline is subtracted after summing.
+*
+*	Inputs:
+*			traces - numTraces*length samples
+*			gates - baseline, short and long windows
+*			results - numTraces results
+*	----------------------------------------------------
+*/
+bool PulseAnalysis::CheckGates (const PSDGates &gates, unsigned int length){
+	if(gates.baselineLow >= gates.baselineHigh || gates.baselineHigh > length){ return false; }
+	if(gates.shortLow >= gates.shortHigh || gates.shortHigh > length){ return false; }
+	if(gates.longLow >= gates.longHigh || gates.longHigh > length){ return false; }
+	return true;
+}
+
+unsigned long long PulseAnalysis::WindowSumScalar (const unsigned short *samples, unsigned int n){
+	unsigned long long sum = 0;
+	for(unsigned int i = 0; i < n; i++){ sum += samples[i]; }
+	return sum;
+}
+
+unsigned long long PulseAnalysis::WindowSum (const unsigned short *samples, unsigned int n){
+#ifdef __SSE2__
+	// Widen 8 samples at a time to 32-bit lanes. Each lane gets 2 samples per
+	// block, so flush the lanes to 64-bit every 32768 blocks to avoid overflow.
+	const __m128i zero = _mm_setzero_si128();
+	unsigned long long sum = 0;
+	unsigned int i = 0;
+	while(i + 8 <= n){
+		__m128i acc = zero;
+		unsigned int stop = (n - i)/8 > 32768 ? i + 8*32768 : n - (n - i) % 8;
+		for(; i < stop; i += 8){
+			__m128i block = _mm_loadu_si128((const __m128i*)(samples + i));
+			acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(block, zero));
+			acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(block, zero));
+		}
+		unsigned int lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		sum += (unsigned long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+	return sum + WindowSumScalar(samples + i, n - i);
+#else
+	return WindowSumScalar(samples, n);
+#endif
+}
+
+void PulseAnalysis::FillResult (unsigned long long baseSum, unsigned long long shortSum, unsigned long long longSum, const PSDGates &gates, PSDResult &result){
+	result.baseline = (double)baseSum/(gates.baselineHigh - gates.baselineLow);
+	result.shortIntegral = shortSum - result.baseline*(gates.shortHigh - gates.shortLow);
+	result.longIntegral = longSum - result.baseline*(gates.longHigh - gates.longLow);
+	if(result.longIntegral > 0.0){ result.ratio = (result.longIntegral - result.shortIntegral)/result.longIntegral; }
+	else{ result.ratio = -1.0; }
+}
+
+bool PulseAnalysis::PSD_Batch (const unsigned short *traces, size_t numTraces, unsigned int length, const PSDGates &gates, PSDResult *results){
+	if(!CheckGates(gates, length)){ return false; }
+	for(size_t t = 0; t < numTraces; t++){
+		const unsigned short *pulse = traces + t*length;
+		FillResult(WindowSum(pulse + gates.baselineLow, gates.baselineHigh - gates.baselineLow),
+		           WindowSum(pulse + gates.shortLow, gates.shortHigh - gates.shortLow),
+		           WindowSum(pulse + gates.longLow, gates.longHigh - gates.longLow), gates, results[t]);
+	}
+	return true;
+}
+
+bool PulseAnalysis::PSD_BatchScalar (const unsigned short *traces, size_t numTraces, unsigned int length, const PSDGates &gates, PSDResult *results){
+	if(!CheckGates(gates, length)){ return false; }
+	for(size_t t = 0; t < numTraces; t++){
+		const unsigned short *pulse = traces + t*length;
+		FillResult(WindowSumScalar(pulse + gates.baselineLow, gates.baselineHigh - gates.baselineLow),
+		           WindowSumScalar(pulse + gates.shortLow, gates.shortHigh - gates.shortLow),
+		           WindowSumScalar(pulse + gates.longLow, gates.longHigh - gates.longLow), gates, results[t]);
+	}
+	return true;
+}
@@ -2,6 +2,9 @@
  * \brief Holds a pre-generated pool of random numbers
  *
  * This generates a pool of random numbers using the Mersenne twister.
+ * RandomStream is a counter based generator which returns the same number
+ * for the same (run, event, channel) key no matter in which order, or on
+ * which thread, the numbers are requested.
  * \author David Miller 
  * \date 18 August 2010
  */
@@ -33,4 +36,36 @@ public:
     double Get(double range=1); 
 };
 
+/** 
+ *  \brief Counter based random numbers
+ *
+ *  Each number is a hash of its key computed with the splitmix64 finalizer,
+ *  so there is no state to share between threads. The run key is a seed for
+ *  the whole analysis, the event key identifies the event (e.g. the channel
+ *  timestamp) and the channel key is the channel id.
+ */
+class RandomStream {
+public:
+    /** Scramble a 64 bit value (splitmix64) */
+    static inline unsigned long long Mix(unsigned long long z) {
+        z += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /** Get a random number in the range [0,1) for a key */
+    static inline double Uniform(unsigned long long run, unsigned long long event, unsigned int channel) {
+        unsigned long long h = Mix(Mix(Mix(run) + event) + channel);
+        return (h >> 11) * (1.0 / 9007199254740992.0); // 53 random bits
+    }
+
+    /** Fill out with num random numbers in the range [0,1) for the keys (run, events[i], channels[i]) */
+    static void Fill(unsigned long long run, const unsigned long long *events, const unsigned int *channels, double *out, size_t num) {
+        unsigned long long key = Mix(run);
+        for (size_t i = 0; i < num; i++)
+            out[i] = (Mix(Mix(key + events[i]) + channels[i]) >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
 #endif // __RANDOMPOOL_HPP_
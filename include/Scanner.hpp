@@ -4,6 +4,7 @@
 #include <string>
 
 class ScanMain;
+class BenchDriver;
 
 class Scanner : public Unpacker{
 public:
@@ -28,9 +29,33 @@ public:
 	  * \return True if the command is valid and false otherwise.
 	  */
 	bool CommandControl(std::string cmd_, const std::vector<std::string> &args_);
+	
+	/** Process all events in a columnar event dump (.pxd) written by
+	  * DetectorDriver. The dump is memory mapped and no unpacking is done.
+	  * 
+	  * \return True if the dump was processed and false otherwise.
+	  */
+	bool ReplayDump(const std::string &fname_);
+	
+	/** Process the synthetic spills of a BenchDriver and time each call to
+	  * ProcessRawEvent(). DetectorDriver must already exist so that the
+	  * map file has been loaded.
+	  * 
+	  * \return True if the spills were processed and false otherwise.
+	  */
+	bool Bench(BenchDriver &bench_);
+	
+	/** Write the spills of an ldf or pld file selected by --spills, --skip or
+	  * --time to a new file (using the spill index of the file) and replace
+	  * filename_ with the name of the new file.
+	  * 
+	  * \return True if the spills were written and false otherwise.
+	  */
+	bool SelectSpills(std::string &filename_, const std::string &mode_, const std::string &range_);
     
 private:
 	std::string output_fname; /// The output histogram filename prefix.
+	std::string spill_fname; /// The temporary file holding the selected spills (if any).
 
 	unsigned int counter; /// The number of times ProcessRawEvent is called.
 
@@ -0,0 +1,131 @@
+/** \file SpillIndex.hpp
+ * \brief Index of the spills in an ldf or pld list mode file
+ *
+ * The index records where each spill starts in the file along with its size
+ * and the first and last pixie timestamps it contains. It is saved next to
+ * the data file as <filename>.idx so that it only has to be built once. The
+ * index may be used to write a new, valid data file containing only some of
+ * the spills (a time range, or everything but a bad region) or to split a
+ * large file into spill-aligned pieces which can be scanned in parallel.
+ *
+ * ldf files are a sequence of 8194 word buffers. Spills are split into chunks
+ * which each fit in one DATA buffer. Every chunk starts with its size in bytes,
+ * the total number of chunks in the spill and the chunk number. The last chunk
+ * of a spill is a 5 word footer. The unused end of a buffer is filled with
+ * 0xFFFFFFFF.
+ *
+ * pld files start with a header followed by one DATA record per spill
+ * ("DATA", spill size in words, spill data) and end with an "EOF " word.
+ */
+
+#ifndef __SPILLINDEX_HPP_
+#define __SPILLINDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#define SPILL_INDEX_VERSION 1
+
+/// Information about a single spill
+struct SpillInfo{
+	unsigned long long offset; /// ldf: byte offset of the buffer holding the first chunk. pld: byte offset of the DATA word
+	unsigned long long first_time; /// Earliest pixie timestamp in the spill (0 if there are no events)
+	unsigned long long last_time; /// Latest pixie timestamp in the spill
+	unsigned int position; /// ldf: word offset of the first chunk in its buffer. pld: always zero
+	unsigned int buffer; /// ldf: index of the buffer holding the first chunk. pld: always zero
+	unsigned int nWords; /// Number of data words in the spill
+	unsigned int nEvents; /// Number of pixie events in the spill
+	bool good; /// False if the spill was truncated or malformed
+
+	SpillInfo(){ offset = 0; first_time = 0; last_time = 0; position = 0; buffer = 0; nWords = 0; nEvents = 0; good = true; }
+};
+
+/// A range of spill indices (inclusive)
+typedef std::pair<size_t, size_t> SpillRange;
+
+class SpillIndex{
+  private:
+	std::string fname; /// The indexed data file
+	std::string extension; /// Extension of the data file (ldf or pld)
+	int format; /// 0 for ldf and 1 for pld files
+	unsigned long long file_size; /// Size of the data file when it was indexed
+	long long file_mtime; /// Modification time of the data file when it was indexed
+	unsigned long long header_size; /// Number of bytes before the first spill
+	std::vector<SpillInfo> spills; /// All spills in file order
+
+	const char *map; /// The memory mapped data file
+	size_t map_size; /// Size of the mapped data file in bytes
+
+	/// Map the data file into memory
+	bool map_file();
+
+	/// Unmap the data file
+	void unmap_file();
+
+	/// Fill the event count and time range of a spill from its data words
+	static void scan_spill(const std::vector<unsigned int> &data_, SpillInfo &info_);
+
+	/** Walk the chunks of an ldf spill starting at a given buffer and word. If
+	  * data_ is not NULL, the spill data are appended to it. If chunks_ is not
+	  * NULL, the (first word, number of words) of each chunk, footer included,
+	  * are appended to it. Return false if the spill is incomplete.
+	  */
+	bool walk_ldf_spill(const SpillInfo &info_, std::vector<unsigned int> *data_, std::vector<std::pair<const unsigned int*, unsigned int> > *chunks_);
+
+	/// Build the index of an ldf file
+	bool build_ldf();
+
+	/// Build the index of a pld file
+	bool build_pld();
+
+	/// Load the index from fname_. Return false if it is missing or out of date
+	bool load(const std::string &fname_);
+
+	/// Save the index to fname_
+	bool save(const std::string &fname_);
+
+  public:
+	SpillIndex();
+
+	~SpillIndex(){ unmap_file(); }
+
+	/** Open a data file and load its index from <filename>.idx, or build and
+	  * save the index if the sidecar is missing, out of date or rebuild_ is set.
+	  */
+	bool Open(const std::string &fname_, bool rebuild_=false);
+
+	/// Return the name of the indexed data file
+	std::string GetFilename(){ return fname; }
+
+	/// Return the extension of the indexed data file
+	std::string GetExtension(){ return extension; }
+
+	/// Return the number of spills in the file
+	size_t GetNumSpills(){ return spills.size(); }
+
+	/// Return the information about spill index_
+	const SpillInfo &GetSpill(size_t index_){ return spills.at(index_); }
+
+	/// Return the earliest timestamp in the file
+	unsigned long long GetFirstTime();
+
+	/// Return the spills overlapping a time range in seconds, relative to the first timestamp in the file
+	std::vector<SpillRange> FindTimeRange(double start_, double stop_);
+
+	/// Return the spills which are not in the range skip_
+	std::vector<SpillRange> Exclude(const SpillRange &skip_);
+
+	/// Write the spills in ranges_ to a new data file of the same format
+	bool Write(const std::string &output_, const std::vector<SpillRange> &ranges_);
+
+	/** Split the file into up to num_ spill-aligned pieces of roughly equal size.
+	  * The pieces are named <prefix>_sNN.<ext> and are returned in files_.
+	  */
+	bool Split(size_t num_, const std::string &prefix_, std::vector<std::string> &files_);
+
+	/// Print a summary of the file, and of every spill if verbose_ is set
+	void Print(bool verbose_=false);
+};
+
+#endif // __SPILLINDEX_HPP_
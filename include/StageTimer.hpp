@@ -0,0 +1,108 @@
+/** \file StageTimer.hpp
+ * \brief Wall clock timing and latency histogram of a single processing stage
+ *
+ * Each call to Start()/Stop() is timed with the monotonic clock and added to a
+ * latency histogram with STAGE_TIMER_SUBBINS bins per factor of two (1 ns to
+ * ~4 s). Each stage also counts the channels it handled with AddChannels(),
+ * so that stages called once per event and stages called once per trace can
+ * be compared in ns per channel. If hardware counters are enabled with
+ * SetPerfCounters(), the cpu cycles and cache misses of the calling thread are
+ * also counted (Linux perf_event only).
+ */
+
+#ifndef __STAGETIMER_HPP_
+#define __STAGETIMER_HPP_
+
+#include <string>
+
+#include <time.h>
+
+#define STAGE_TIMER_SUBBINS 4 // Latency bins per factor of two (Bin() assumes 4)
+#define STAGE_TIMER_BINS 128 // Number of latency bins
+
+class StageTimer{
+  private:
+	unsigned long long start_time; /// Time of the last call to Start() (ns)
+	unsigned long long total_time; /// Total time between Start() and Stop() (ns)
+	unsigned long long max_time; /// Longest single call (ns)
+	unsigned long long calls; /// Number of calls to Stop()
+	unsigned long long channels; /// Number of channels handled by the timed calls
+	unsigned long long histogram[STAGE_TIMER_BINS]; /// Latency histogram
+
+	int perf_fd; /// perf_event group leader (-1 if not in use, -2 if not opened yet)
+	unsigned long long perf_start[2]; /// Counter values at the last call to Start()
+	unsigned long long perf_total[2]; /// Total cycles and cache misses between Start() and Stop()
+
+	static bool use_perf; /// Open hardware counters for all timers
+
+	/// Open the cycles and cache miss counters of the calling thread
+	void open_perf();
+
+	/// Read the current counter values into values_
+	bool read_perf(unsigned long long *values_);
+
+  public:
+	StageTimer();
+
+	~StageTimer();
+
+	/// Return the current monotonic time in ns
+	static unsigned long long Now(){
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000000000ULL + now.tv_nsec;
+	}
+
+	/// Return the latency histogram bin of a time in ns
+	static unsigned int Bin(unsigned long long ns_);
+
+	/// Return the lower edge of a latency histogram bin in ns
+	static double BinLow(unsigned int bin_);
+
+	/// Enable or disable hardware counters for all timers started after this call
+	static void SetPerfCounters(bool state_){ use_perf = state_; }
+
+	/// Return true if hardware counters are enabled
+	static bool GetPerfCounters(){ return use_perf; }
+
+	/// Start timing a call
+	void Start(){
+		if(use_perf){
+			if(perf_fd == -2){ open_perf(); }
+			if(perf_fd >= 0){ read_perf(perf_start); }
+		}
+		start_time = Now();
+	}
+
+	/// Finish timing a call started with Start()
+	void Stop();
+
+	/// Count channels handled by this stage
+	void AddChannels(unsigned long long channels_){ channels += channels_; }
+
+	/// Reset all counters
+	void Zero();
+
+	/// Return the total time in seconds
+	double GetSeconds() const { return total_time * 1E-9; }
+
+	/// Return the number of timed calls
+	unsigned long long GetCalls() const { return calls; }
+
+	/// Return the number of channels handled by this stage
+	unsigned long long GetChannels() const { return channels; }
+
+	/// Return the latency histogram
+	const unsigned long long *GetHistogram() const { return histogram; }
+
+	/// Return an estimate of a latency quantile (0 to 1) in ns from the histogram
+	double GetQuantile(double quantile_) const;
+
+	/// Print the column titles used by Print()
+	static void PrintHeader();
+
+	/// Print one row of the timing table
+	void Print(const std::string &name_) const;
+};
+
+#endif // __STAGETIMER_HPP_
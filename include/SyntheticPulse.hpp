@@ -0,0 +1,91 @@
+/** \file SyntheticPulse.hpp
+ * \brief Random numbers and pulse shapes for synthetic Pixie16 events
+ *
+ * Used by the pixieGen tool, which writes synthetic events to an ldf file,
+ * and by the --bench mode of PixieLDF, which builds them in memory. Both
+ * therefore make the same traces for the same seed.
+ *
+ * This header has no dependencies so it may be included by the tools.
+ */
+
+#ifndef __SYNTHETICPULSE_HPP_
+#define __SYNTHETICPULSE_HPP_
+
+#include <string>
+#include <vector>
+#include <cmath>
+
+#define SYNTHETIC_ADC_MAX 4095 // 12-bit adc
+#define SYNTHETIC_BASELINE 400.0 // Trace baseline in adc channels
+
+enum PulseShape {NO_PULSE, FAST_PULSE, SLOW_PULSE};
+
+/// Small, fast, seedable generator (xorshift64*)
+class GenRandom{
+  private:
+	unsigned long long state;
+
+  public:
+	GenRandom(unsigned long long seed_){ state = (seed_ ? seed_ : 0x9E3779B97F4A7C15ULL); }
+
+	unsigned long long Next(){
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 2685821657736338717ULL;
+	}
+
+	/// Uniform on [0, 1)
+	double Uniform(){ return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+	/// Exponentially distributed with a given mean
+	double Exponential(double mean_){ return -mean_ * std::log(1.0 - Uniform()); }
+
+	/// Standard normal (Box-Muller)
+	double Gauss(){
+		double u1 = 1.0 - Uniform();
+		return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * Uniform());
+	}
+
+	/// Poisson distributed with a given mean (Knuth, fine for small means)
+	unsigned int Poisson(double mean_){
+		double limit = std::exp(-mean_), prod = Uniform();
+		unsigned int count = 0;
+		while(prod > limit){
+			prod *= Uniform();
+			count++;
+		}
+		return count;
+	}
+};
+
+/// Return the pulse shape used for a detector type from the map file
+inline PulseShape shape_for_type(const std::string &type_){
+	if(type_ == "ignore" || type_ == "logic" || type_ == "timeclass"){ return NO_PULSE; }
+	if(type_.find("vandle") != std::string::npos || type_ == "scint" || type_ == "liquid" || type_ == "beta" || type_ == "mcp"){ return FAST_PULSE; }
+	return SLOW_PULSE;
+}
+
+/// Fill a trace with a pulse of a given amplitude on a noisy baseline
+inline void make_trace(PulseShape shape_, double amplitude_, double noise_, GenRandom &rand_, std::vector<unsigned int> &trace_){
+	double start = trace_.size() / 4 + rand_.Uniform(); // Sub-sample trigger phase
+	double rise = (shape_ == FAST_PULSE ? 0.8 : 10.0);
+	double decay = (shape_ == FAST_PULSE ? 4.0 : 250.0);
+	double norm = 1.0;
+
+	if(shape_ != NO_PULSE){ // Normalize the bi-exponential to a peak height of 1
+		double tmax = rise * decay / (decay - rise) * std::log(decay / rise);
+		norm = 1.0 / (std::exp(-tmax / decay) - std::exp(-tmax / rise));
+	}
+
+	for(size_t i = 0; i < trace_.size(); i++){
+		double value = SYNTHETIC_BASELINE + noise_ * rand_.Gauss();
+		double t = i - start;
+		if(shape_ != NO_PULSE && t > 0.0){ value += amplitude_ * norm * (std::exp(-t / decay) - std::exp(-t / rise)); }
+		if(value < 0.0){ value = 0.0; }
+		else if(value > SYNTHETIC_ADC_MAX){ value = SYNTHETIC_ADC_MAX; }
+		trace_[i] = (unsigned int)value;
+	}
+}
+
+#endif // __SYNTHETICPULSE_HPP_
@@ -6,20 +6,53 @@
 #define __TAUANALYZER_HPP_
 
 #include <string>
+#include <vector>
 
 #include "TraceAnalyzer.hpp"
 
 class TauAnalyzer : public TraceAnalyzer
 {
   private:
+  /** Running decay constant of one channel. The mean and variance are
+   * exponentially weighted over the last estimateWindow fits */
+  struct TauEstimate {
+      unsigned long long traces; ///< traces seen
+      unsigned long long fits;   ///< traces which were fitted
+      double mean;               ///< running tau (s)
+      double var;                ///< running variance of the single trace tau (s^2)
+      bool converged;            ///< per trace fits are being skipped
+
+      TauEstimate() : traces(0), fits(0), mean(0), var(0), converged(false) {};
+  };
+
+  static const unsigned int estimateWindow = 256; ///< fits in the running estimate
+  static const unsigned int checkInterval = 16;   ///< fit every Nth trace once converged
+  static const double tolerance;                  ///< relative error of the running tau to converge
+
   std::string type;
   std::string subtype;
+  std::vector<TauEstimate> estimates; ///< indexed by channel id
+
+  /// Fit the tail of the trace, return false if there is no usable tail
+  bool FitTau(const Trace &trace, double &tau) const;
+
+  /// Add a single trace tau to the running estimate
+  void UpdateEstimate(TauEstimate &est, double tau);
+
   public:
     TauAnalyzer();
     TauAnalyzer(const std::string &aType, const std::string &aSubtype);
 
     ~TauAnalyzer();
     virtual void Analyze(Trace &trace, const std::string &aType, const std::string &aSubtype);
+    virtual bool AppliesTo(const std::string &aType, const std::string &aSubtype) const;
+
+    /** Sums of log(y[i]) and i*log(y[i]) over n samples of y = samples - baseline.
+     * All samples must be above the baseline */
+    static void LogSums(const int *samples, unsigned int n, double baseline, double &sumLog, double &sumXLog);
+
+    /// Same as LogSums without SIMD
+    static void LogSumsScalar(const int *samples, unsigned int n, double baseline, double &sumLog, double &sumXLog);
 };
 
 #endif // __TAUANALYZER_HPP_
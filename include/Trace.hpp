@@ -25,12 +25,71 @@
 #endif
 
 class TrapezoidalFilterParameters;
+class TraceAnalyzer;
 
 // use an alias in this file to make things a bit more readable
 namespace {
     typedef class TrapezoidalFilterParameters TFP;
 }
 
+/** Sample ranges used by Trace::ExtractFeatures(), in samples */
+struct TraceFeatureParameters
+{
+    unsigned int searchLow;    ///< first sample of the maximum search
+    unsigned int searchHigh;   ///< end (exclusive) of the maximum search
+    unsigned int waveformLow;  ///< samples before the maximum in the waveform window
+    unsigned int waveformHigh; ///< samples after the maximum in the waveform window
+    unsigned int discrimLow;   ///< start of the tail integral, relative to the maximum
+    bool doDiscrim;            ///< compute the tail integral
+
+    TraceFeatureParameters() : searchLow(0), searchHigh(0), waveformLow(0), waveformHigh(0), discrimLow(0), doDiscrim(false) {};
+};
+
+/** Waveform features filled by Trace::ExtractFeatures() */
+struct TraceFeatures
+{
+    bool valid;           ///< all features below were computed
+    bool saturated;       ///< the maximum reached the ADC limit
+    unsigned int maxPos;  ///< position of the maximum
+    double maxVal;        ///< baseline subtracted maximum
+    double baseline;      ///< mean of the samples before the waveform window
+    double sigmaBaseline; ///< standard deviation of the baseline samples
+    double qdc;           ///< baseline subtracted integral of the waveform window
+    double fullQdc;       ///< baseline subtracted integral of the whole trace
+    double discrim;       ///< baseline subtracted tail integral (NAN if not computed)
+    double qdcToMax;      ///< qdc / maxVal
+
+    TraceFeatures() { Zero(); };
+    void Zero() {
+	valid = saturated = false;
+	maxPos = 0;
+	maxVal = baseline = sigmaBaseline = qdc = fullQdc = discrim = qdcToMax = NAN;
+    }
+};
+
+/** Pulses found in a trace by the TraceFilterer (the first pulse) and the
+ * DoubleTraceAnalyzer (any later ones), in order of time */
+struct TracePulses
+{
+    static const unsigned int maxPulses = 50; ///< most pulses stored for one trace
+
+    unsigned int num;           ///< number of pulses found
+    int time[maxPulses];        ///< fast filter crossing of each pulse, in samples
+    double energy[maxPulses];   ///< energy filter value of each pulse
+
+    TracePulses() { Zero(); };
+    void Zero() {num = 0;}
+
+    /** Add a pulse, return false if there is no room left for it */
+    bool Add(int time_, double energy_) {
+	if (num >= maxPulses)
+	    return false;
+	time[num] = time_;
+	energy[num++] = energy_;
+	return true;
+    }
+};
+
 /**
    Store the information for a trace
  */
@@ -41,22 +100,62 @@ class Trace : public std::vector<int>
     unsigned int baselineLow; 
     unsigned int baselineHigh;
 
+    int channelId; ///< id of the channel the trace belongs to (-1 if not known)
+
     std::map<std::string, double> doubleTraceData;
     std::map<std::string, int> intTraceData;
 
+    TraceFeatures features;
+    TracePulses pulses;
+
+    /** Analyzers which have not been run on this trace yet, and the type and
+     * subtype to run them with (NULL if there are none, see SetPendingAnalysis) */
+    const std::vector<TraceAnalyzer *> *pendingAnalyzers;
+    const std::string *pendingType;
+    const std::string *pendingSubtype;
+
     /** This field is static so all instances of Trace class have access to 
      * the same plots and plots range. */
     static Plots histo; 
 
+    /// Run and clear the deferred analyzers
+    void RunPending() const;
+
  public:
     std::vector<double> waveform;
     
-    Trace() : std::vector<int>() {baselineLow = baselineHigh = U_DELIMITER; };
+    Trace() : std::vector<int>() {baselineLow = baselineHigh = U_DELIMITER; channelId = -1; pendingAnalyzers = NULL; };
     // an automatic conversion
     Trace(const std::vector<int> &x) : std::vector<int>(x) {
         baselineLow = baselineHigh = U_DELIMITER;
+        channelId = -1;
+        pendingAnalyzers = NULL;
+    }
+
+    /** Set the channel the trace belongs to, for analyzers which keep
+     * per channel information */
+    void SetChannelId(int id) {channelId = id;}
+    int GetChannelId() const {return channelId;}
+
+    /** Defer the analyzers in chain until a result is requested through
+     * HasValue, GetValue, GetFeatures or GetWaveform. The chain and the strings
+     * must outlive the trace */
+    void SetPendingAnalysis(const std::vector<TraceAnalyzer *> *chain, const std::string &type, const std::string &subtype) {
+        pendingAnalyzers = (chain && !chain->empty() ? chain : NULL);
+        pendingType = &type;
+        pendingSubtype = &subtype;
+    }
+
+    bool HasPendingAnalysis() const {return pendingAnalyzers != NULL;}
+
+    /** Run the deferred analyzers (if any) now. Each one runs at most once */
+    void RunPendingAnalysis() const {
+        if (pendingAnalyzers) RunPending();
     }
 
+    /** Forget the deferred analyzers without running them */
+    void ClearPendingAnalysis() {pendingAnalyzers = NULL;}
+
     void TrapezoidalFilter(Trace &filter, const TFP &parms, unsigned int lo = 0) const {
         TrapezoidalFilter( filter, parms, lo, size() );
     }
@@ -85,11 +184,13 @@ class Trace : public std::vector<int>
     }
 
     bool HasValue(std::string name) const {
+        RunPendingAnalysis();
         return (doubleTraceData.count(name) > 0 ||
             intTraceData.count(name) > 0);
     }
 
     double GetValue(std::string name) const {
+        RunPendingAnalysis();
         if (doubleTraceData.count(name) > 0)
             return (*doubleTraceData.find(name)).second;
         if (intTraceData.count(name) > 0)
@@ -97,7 +198,7 @@ class Trace : public std::vector<int>
         return NAN;
     }
 
-    std::vector<double> GetWaveform(){return waveform;}; 
+    std::vector<double> GetWaveform(){RunPendingAnalysis(); return waveform;}; 
 
     //To allow access to the variables related to timing
     //This is needed in order to calculate the baseline over the 
@@ -110,6 +211,18 @@ class Trace : public std::vector<int>
     
     unsigned int FindMaxInfo(std::string);
 
+    /** Find the maximum and compute the baseline, waveform window, QDC and
+     * tail integrals in one pass over the trace. The baseline subtracted
+     * window is also copied into waveform. */
+    const TraceFeatures& ExtractFeatures(const TraceFeatureParameters &parms);
+    const TraceFeatures& GetFeatures() const {RunPendingAnalysis(); return features;}
+
+    /** Add a pulse found by a filter analyzer, return false if the trace
+     * already has TracePulses::maxPulses pulses */
+    bool AddPulse(int time, double energy) {return pulses.Add(time, energy);}
+    void ClearPulses() {pulses.Zero();}
+    const TracePulses& GetPulses() const {RunPendingAnalysis(); return pulses;}
+
     void Plot(int id);           //< plot trace into a 1D histogram
     void Plot(int id, int row);  //< plot trace into row of a 2D histogram
     void ScalePlot(int id, double scale); //< plot trace absolute value and scaled into a 1D histogram
@@ -8,9 +8,9 @@
 #define __TRACEANALYZER_HPP_
 
 #include <string>
-#include <time.h>
 
 #include "Plots.hpp"
+#include "StageTimer.hpp"
 
 class Trace;
 
@@ -22,8 +22,8 @@ class Trace;
 class TraceAnalyzer {
  private:
     // things associated with timing
-	long total_time;
-	clock_t start_time;
+    StageTimer timer;
+    int timerDepth; ///< number of StartAnalyze() calls not yet ended
     
     void _initialize();
 
@@ -57,13 +57,31 @@ class TraceAnalyzer {
     virtual bool CheckInit();
     virtual bool InitDamm();
     virtual void Analyze(Trace &trace, const std::string &type, const std::string &subtype);
+
+    /** Return true if traces of this type:subtype need this analyzer. Called once
+     * per channel when DetectorDriver builds the analyzer chains */
+    virtual bool AppliesTo(const std::string &type, const std::string &subtype) const { return true; }
+
+    /** Return true if the analysis may be put off until a processor asks the
+     * trace for a result. Analyzers which provide the channel energy must not */
+    virtual bool CanDefer() const { return false; }
     
-    // Start the analysis timer
-    void StartAnalyze(){ start_time = clock(); }
+    // Start the analysis timer. Nested calls, e.g. from the Analyze() of a
+    // parent class, are timed as part of the outermost one
+    void StartAnalyze(){ if (timerDepth++ == 0) timer.Start(); }
     
-	// Finish analysis updating the analyzer timing information
+	// Finish analysis updating the analyzer timing information. Each outermost
+	// StartAnalyze()/EndAnalyze() pair handles one channel's trace
     void EndAnalyze(Trace &trace);
-    void EndAnalyze(void){ total_time += (clock() - start_time); }
+    void EndAnalyze(void){
+        if (timerDepth > 0 && --timerDepth == 0) {
+            timer.Stop();
+            timer.AddChannels(1);
+        }
+    }
+
+    // Return the timing information of the analyzer
+    const StageTimer& GetTimer(void) const { return timer; }
 
     void SetLevel(int i) {level=i;}
     int GetLevel() {return level;}
@@ -0,0 +1,136 @@
+/** \file TraceCodec.hpp
+ * \brief Lossless packing of Pixie16 ADC traces
+ *
+ * Traces are stored as the first sample (the baseline reference) followed
+ * by the zigzag encoded sample-to-sample differences. Differences are
+ * bit-packed in blocks of TRACE_CODEC_BLOCK samples, each block using the
+ * smallest bit width which holds all of its values. A 14-bit ADC trace
+ * typically packs into 4-6 bits per sample instead of 32.
+ *
+ * Encoded trace layout (32-bit words):
+ *  word 0 : number of samples N
+ *  word 1 : first sample
+ *  word 2+: bitstream of (N-1) differences, LSB first. Each block begins with
+ *           a 6-bit width followed by up to TRACE_CODEC_BLOCK values of that width.
+ * Each trace is padded to a whole word, so several traces may be appended
+ * to the same vector and decoded back in sequence.
+ *
+ * This header has no dependencies so it may be included by the tools and by
+ * root macros to decode the packed *_wave branches.
+ */
+
+#ifndef __TRACECODEC_HPP_
+#define __TRACECODEC_HPP_
+
+#include <vector>
+#include <cstddef>
+
+#define TRACE_CODEC_BLOCK 16 // Number of samples sharing a bit width
+#define TRACE_CODEC_WIDTH_BITS 6 // Number of bits used to store each block width
+
+class TraceCodec{
+  private:
+	/// Map a signed difference onto an unsigned value (0,-1,1,-2,... -> 0,1,2,3,...)
+	static unsigned int zigzag(int value_){ return ((unsigned int)value_ << 1) ^ (unsigned int)(value_ >> 31); }
+
+	/// Inverse of zigzag()
+	static int unzigzag(unsigned int value_){ return (int)(value_ >> 1) ^ -(int)(value_ & 1); }
+
+	/// Return the number of bits needed to hold value_
+	static unsigned int bit_width(unsigned int value_){
+		unsigned int width = 0;
+		while(value_){ width++; value_ >>= 1; }
+		return width;
+	}
+
+  public:
+	/// Append an encoded trace to output_. Return the number of words written
+	static size_t Encode(const int *trace_, const size_t &size_, std::vector<unsigned int> &output_){
+		size_t start = output_.size();
+		output_.push_back((unsigned int)size_);
+		if(size_ == 0){ return 1; }
+		output_.push_back((unsigned int)trace_[0]);
+
+		unsigned long long buffer = 0;
+		unsigned int nbits = 0;
+		unsigned int values[TRACE_CODEC_BLOCK];
+		for(size_t block = 1; block < size_; block += TRACE_CODEC_BLOCK){
+			size_t block_size = (size_ - block < TRACE_CODEC_BLOCK) ? size_ - block : TRACE_CODEC_BLOCK;
+
+			// Find the bit width of this block
+			unsigned int mask = 0;
+			for(size_t i = 0; i < block_size; i++){
+				values[i] = zigzag((int)((unsigned int)trace_[block+i] - (unsigned int)trace_[block+i-1]));
+				mask |= values[i];
+			}
+			unsigned int width = bit_width(mask);
+
+			// Write the width followed by the values
+			buffer |= (unsigned long long)width << nbits;
+			nbits += TRACE_CODEC_WIDTH_BITS;
+			for(size_t i = 0; i <= block_size; i++){
+				while(nbits >= 32){
+					output_.push_back((unsigned int)buffer);
+					buffer >>= 32;
+					nbits -= 32;
+				}
+				if(i == block_size || width == 0){ break; }
+				buffer |= (unsigned long long)values[i] << nbits;
+				nbits += width;
+			}
+		}
+		if(nbits > 0){ output_.push_back((unsigned int)buffer); }
+
+		return output_.size() - start;
+	}
+
+	/// Append an encoded trace to output_. Return the number of words written
+	static size_t Encode(const std::vector<int> &trace_, std::vector<unsigned int> &output_){
+		if(trace_.empty()){ return Encode(NULL, 0, output_); }
+		return Encode(&trace_[0], trace_.size(), output_);
+	}
+
+	/// Decode all traces in input_ and append their samples to output_. Return false if input_ is malformed
+	static bool Decode(const std::vector<unsigned int> &input_, std::vector<int> &output_){
+		size_t pos = 0;
+		while(pos < input_.size()){
+			size_t size = input_[pos++];
+			if(size == 0){ continue; }
+			if(pos >= input_.size()){ return false; }
+
+			int sample = (int)input_[pos++];
+			output_.reserve(output_.size() + size);
+			output_.push_back(sample);
+
+			unsigned long long buffer = 0;
+			unsigned int nbits = 0;
+			unsigned int width = 0;
+			for(size_t i = 1; i < size; i++){
+				if((i - 1) % TRACE_CODEC_BLOCK == 0){ // Start of a new block, read its width
+					if(nbits < TRACE_CODEC_WIDTH_BITS){
+						if(pos >= input_.size()){ return false; }
+						buffer |= (unsigned long long)input_[pos++] << nbits;
+						nbits += 32;
+					}
+					width = (unsigned int)(buffer & ((1 << TRACE_CODEC_WIDTH_BITS) - 1));
+					buffer >>= TRACE_CODEC_WIDTH_BITS;
+					nbits -= TRACE_CODEC_WIDTH_BITS;
+					if(width > 32){ return false; }
+				}
+				if(nbits < width){
+					if(pos >= input_.size()){ return false; }
+					buffer |= (unsigned long long)input_[pos++] << nbits;
+					nbits += 32;
+				}
+				unsigned int value = (unsigned int)(buffer & ((1ull << width) - 1));
+				buffer >>= width;
+				nbits -= width;
+				sample = (int)((unsigned int)sample + (unsigned int)unzigzag(value));
+				output_.push_back(sample);
+			}
+		}
+		return true;
+	}
+};
+
+#endif // __TRACECODEC_HPP_
@@ -26,6 +26,7 @@ class TraceExtractor : public TraceAnalyzer {
 
     virtual void DeclarePlots(void);
     virtual void Analyze(Trace &trace, const std::string &type, const std::string &subtype);
+    virtual bool AppliesTo(const std::string &aType, const std::string &aSubtype) const;
 };
 
 #endif // __TRACEEXTRACTOR_HPP_
@@ -10,10 +10,24 @@
 
 class WaveformAnalyzer : public TraceAnalyzer, public TimingInformation
 {
+ private:
+    bool haveParameters; ///< the timing constants have been converted to sample ranges
+    TraceFeatureParameters vandleParms; ///< sample ranges for VANDLE and other scintillators
+    TraceFeatureParameters liquidParms; ///< sample ranges for liquid scintillators
+
+    /** Convert the timing constants to sample ranges. The constants are not
+     * available until the timing files have been read. */
+    void LoadParameters();
+
  public:
     WaveformAnalyzer(); 
     virtual bool InitDamm();
     virtual void Analyze(Trace &, const std::string &, const std::string &);
+    virtual bool AppliesTo(const std::string &type, const std::string &subtype) const;
+    virtual bool CanDefer() const { return true; } ///< only timing information is extracted
+
+    /** Return true for the detector types whose trace features are extracted */
+    static bool IsWaveformType(const std::string &type);
     virtual ~WaveformAnalyzer() {};
 };
 #endif // __WAVEFORMANALYZER_HPP_
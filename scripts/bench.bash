@@ -0,0 +1,41 @@
+#!/bin/bash
+# Time the analysis on synthetic events built in memory by PixieLDF --bench and
+# report the events/s and ns/channel of each stage.
+# Run from the top level directory. Any arguments are passed on to PixieLDF --bench.
+# e.g. ./scripts/bench.bash --spills 50 --trace 124 --mult 3
+
+set -o pipefail
+
+if [[ ! -x ./PixieLDF ]]; then
+    echo "Build PixieLDF first (make)"
+    exit 1
+fi
+
+BENCHSRC="scripts/bench"
+
+# The scan reads its setup from ./setup, so run it in a scratch directory holding
+# the default configuration with the bench map, config and timing calibration on top
+rm -rf ${BENCHDIR:="bench"}
+mkdir -p $BENCHDIR
+tar xf config.tar -C $BENCHDIR || exit 1
+cp $BENCHSRC/default.config $BENCHSRC/map2.txt $BENCHSRC/timingCal.txt $BENCHDIR/config/default/ || exit 1
+ln -s config/default $BENCHDIR/setup
+TOP=$(pwd)
+
+(cd $BENCHDIR && $TOP/PixieLDF --bench "$@" bench) > $BENCHDIR/bench.out 2>&1 || {
+    echo "PixieLDF --bench failed, see $BENCHDIR/bench.out"
+    exit 1
+}
+
+# The histograms are only written so that the .his file writes are timed
+rm -f $BENCHDIR/bench.his
+
+# Print the stage timing tables of BenchDriver and DetectorDriver with the events/s
+# of each stage. ns/chan is divided by the channels each stage handled
+awk '
+    /BenchDriver: Generated/ { events = $3; channels = substr($5, 2) }
+    /Stage timing/ { table = 1; next }
+    table && /^  Stage/ { if(!header++){ printf "%s%12s\n", $0, "Events/s" }; next }
+    table && /^  / { printf "%s%12.0f\n", $0, ($3 > 0 ? events/$3 : 0); next }
+    { table = 0 }
+    END { printf "\n %d events (%d channels)\n", events, channels }' $BENCHDIR/bench.out
@@ -0,0 +1,60 @@
+#!/bin/bash
+# Scan a fixed-seed synthetic clover run (built in memory by PixieLDF --bench)
+# through GeProcessor and compare the total counts and a checksum of the bins of
+# each of its spectra (singles, addback, gamma-gamma, ...) with the reference
+# values in scripts/clovercheck/reference.txt.
+# Run from the top level directory. Use --update to record new reference values
+# after an intended change to GeProcessor or the synthetic events.
+
+set -o pipefail
+
+if [[ ! -x ./PixieLDF || ! -x ./tools/hisReader ]]; then
+    echo "Build PixieLDF and hisReader first (make && make tools)"
+    exit 1
+fi
+
+CHECKSRC="scripts/clovercheck"
+REFFILE="$CHECKSRC/reference.txt"
+BENCH_OPTS="--spills 5 --events 2000 --mult 3 --trace 0 --seed 1"
+
+# The scan reads its setup from ./setup, so run it in a scratch directory holding
+# the default configuration with the clover map and config on top
+rm -rf ${CHECKDIR:="clovercheck"}
+mkdir -p $CHECKDIR
+tar xf config.tar -C $CHECKDIR || exit 1
+cp $CHECKSRC/default.config $CHECKSRC/map2.txt $CHECKDIR/config/default/ || exit 1
+ln -s config/default $CHECKDIR/setup
+TOP=$(pwd)
+
+(cd $CHECKDIR && $TOP/PixieLDF --bench $BENCH_OPTS clover) > $CHECKDIR/scan.out 2>&1 || {
+    echo "PixieLDF failed, see $CHECKDIR/scan.out"
+    exit 1
+}
+
+# GeProcessor spectra are 2500-2999
+./tools/hisReader $CHECKDIR/clover --counts | awk '$1 >= 2500 && $1 < 3000' > $CHECKDIR/counts.txt || exit 1
+if [[ ! -s $CHECKDIR/counts.txt ]]; then
+    echo "No GeProcessor spectra were written, see $CHECKDIR/scan.out"
+    exit 1
+fi
+
+if [[ $1 == "--update" ]]; then
+    cp $CHECKDIR/counts.txt $REFFILE
+    echo "Recorded the counts of $(wc -l < $REFFILE) spectra in $REFFILE"
+    exit 0
+fi
+
+if [[ ! -s $REFFILE ]]; then
+    echo "No reference counts in $REFFILE, record them with $0 --update"
+    exit 1
+fi
+
+if diff $REFFILE $CHECKDIR/counts.txt > $CHECKDIR/counts.diff; then
+    echo "GeProcessor spectra match the reference ($(wc -l < $REFFILE) spectra)"
+    exit 0
+fi
+
+echo "GeProcessor spectra differ from the reference (2500 = singles, 2550 = addback)"
+echo " < reference, > this scan (id, total counts, bin checksum)"
+grep '^[<>]' $CHECKDIR/counts.diff
+exit 1
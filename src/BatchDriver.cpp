@@ -0,0 +1,373 @@
+/** \file BatchDriver.cpp
+ * \brief Process several input files in parallel and merge the results
+ */
+
+#include <iostream>
+#include <sstream>
+#include <set>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TList.h"
+#include "TFileMerger.h"
+#include "TFriendElement.h"
+
+#include "BatchDriver.hpp"
+#include "HisFile.h"
+#include "SpillIndex.hpp"
+
+/// Return the suffix DetectorDriver adds to the name of rollover file index_
+static std::string GetFileSuffix(unsigned int index_){
+	if(index_ == 0){ return ""; }
+	std::stringstream stream;
+	stream << (index_ < 10 ? "_0" : "_") << index_;
+	return stream.str();
+}
+
+/// Return true if a file exists
+static bool FileExists(const std::string &fname_){
+	return (access(fname_.c_str(), F_OK) == 0);
+}
+
+/// Return true if str_ is not empty and contains only digits
+static bool IsNumber(const std::string &str_){
+	if(str_.empty()){ return false; }
+	for(std::string::const_iterator iter = str_.begin(); iter != str_.end(); iter++){
+		if(*iter < '0' || *iter > '9'){ return false; }
+	}
+	return true;
+}
+
+/// Merge the trees of all input files, in order, into output_
+static bool MergeRootFiles(const std::vector<std::string> &inputs_, const std::string &output_){
+	// Keep the compression settings of the worker files so baskets may be copied without recompression
+	int compression = 1;
+	TFile *first = TFile::Open(inputs_.front().c_str(), "READ");
+	if(first && !first->IsZombie()){ compression = first->GetCompressionSettings(); }
+	delete first;
+
+	TFileMerger merger(false);
+	if(!merger.OutputFile(output_.c_str(), "RECREATE", compression)){
+		std::cout << "BatchDriver: Error! Failed to open '" << output_ << "' for writing\n";
+		return false;
+	}
+	for(std::vector<std::string>::const_iterator iter = inputs_.begin(); iter != inputs_.end(); iter++){
+		if(!merger.AddFile(iter->c_str(), false)){
+			std::cout << "BatchDriver: Error! Failed to open '" << *iter << "'\n";
+			return false;
+		}
+	}
+	return merger.Merge();
+}
+
+std::string BatchDriver::get_worker_prefix(size_t index_){
+	std::stringstream stream;
+	stream << output_prefix << "_w" << index_;
+	return stream.str();
+}
+
+bool BatchDriver::split_inputs(){
+	std::vector<std::string> pieces;
+	for(size_t i = 0; i < input_files.size(); i++){
+		std::stringstream prefix;
+		prefix << output_prefix << "_f" << i;
+
+		SpillIndex spill_index;
+		std::vector<std::string> files;
+		if(!spill_index.Open(input_files.at(i)) || !spill_index.Split(num_pieces, prefix.str(), files)){
+			std::cout << "BatchDriver: Error! Failed to split '" << input_files.at(i) << "'\n";
+			return false;
+		}
+		std::cout << "BatchDriver: Split '" << input_files.at(i) << "' into " << files.size() << " pieces\n";
+
+		pieces.insert(pieces.end(), files.begin(), files.end());
+		piece_files.insert(piece_files.end(), files.begin(), files.end());
+		for(std::vector<std::string>::iterator iter = files.begin(); iter != files.end(); iter++){
+			piece_files.push_back(*iter + ".idx");
+		}
+	}
+	input_files = pieces;
+	return true;
+}
+
+int BatchDriver::start_worker(size_t index_){
+	std::string log_fname = get_worker_prefix(index_) + ".out";
+
+	// Worker command line: <program> <input-fname> <options> <output-prefix>
+	std::vector<std::string> args;
+	args.push_back(exe_name);
+	args.push_back(input_files.at(index_));
+	args.insert(args.end(), worker_args.begin(), worker_args.end());
+	args.push_back(get_worker_prefix(index_));
+
+	std::vector<char*> argv;
+	for(std::vector<std::string>::iterator iter = args.begin(); iter != args.end(); iter++){
+		argv.push_back(const_cast<char*>(iter->c_str()));
+	}
+	argv.push_back(NULL);
+
+	pid_t pid = fork();
+	if(pid != 0){ return (int)pid; }
+
+	// Worker process. Send all output to the log file and detach from the terminal input
+	int log_fd = open(log_fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(log_fd >= 0){
+		dup2(log_fd, STDOUT_FILENO);
+		dup2(log_fd, STDERR_FILENO);
+		close(log_fd);
+	}
+	int null_fd = open("/dev/null", O_RDONLY);
+	if(null_fd >= 0){
+		dup2(null_fd, STDIN_FILENO);
+		close(null_fd);
+	}
+
+	execv("/proc/self/exe", &argv[0]);
+	execvp(exe_name.c_str(), &argv[0]); // Fall back on the name we were called with
+	std::cout << "BatchDriver: Error! Failed to start '" << exe_name << "'\n";
+	_exit(127);
+}
+
+std::vector<std::string> BatchDriver::get_root_files(const std::string &prefix_, const std::string &tree_){
+	std::string base = (tree_.empty() ? prefix_ : prefix_ + "_" + tree_);
+	std::vector<std::string> output;
+	for(unsigned int i = 0; FileExists(base + GetFileSuffix(i) + ".root"); i++){
+		output.push_back(base + GetFileSuffix(i) + ".root");
+	}
+	return output;
+}
+
+std::vector<std::string> BatchDriver::get_friend_trees(){
+	std::string prefix = get_worker_prefix(0);
+	std::string dir_name = ".";
+	std::string base = prefix + "_";
+	size_t index = prefix.find_last_of('/');
+	if(index != std::string::npos){
+		dir_name = prefix.substr(0, index+1);
+		base = prefix.substr(index+1) + "_";
+	}
+
+	// Per-processor files are named <prefix>_<processor>[_NN].root
+	std::set<std::string> trees;
+	DIR *dir = opendir(dir_name.c_str());
+	if(!dir){ return std::vector<std::string>(); }
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL){
+		std::string fname(entry->d_name);
+		if(fname.size() <= base.size() + 5 || fname.compare(0, base.size(), base) != 0 || fname.compare(fname.size()-5, 5, ".root") != 0){ continue; }
+		std::string tree = fname.substr(base.size(), fname.size() - base.size() - 5);
+		if(IsNumber(tree)){ continue; } // Rollover of the master file
+		index = tree.find_last_of('_');
+		if(index != std::string::npos && IsNumber(tree.substr(index+1))){ tree.erase(index); }
+		trees.insert(tree);
+	}
+	closedir(dir);
+
+	return std::vector<std::string>(trees.begin(), trees.end());
+}
+
+bool BatchDriver::merge_his(){
+	std::vector<std::string> inputs;
+	for(size_t i = 0; i < input_files.size(); i++){
+		if(FileExists(get_worker_prefix(i) + ".drr")){ inputs.push_back(get_worker_prefix(i)); }
+	}
+	if(inputs.empty()){ return true; } // Damm output is not in use
+	else if(inputs.size() != input_files.size()){
+		std::cout << "BatchDriver: Error! Only " << inputs.size() << " of " << input_files.size() << " workers wrote a .drr file\n";
+		return false;
+	}
+
+	std::cout << "BatchDriver: Summing " << inputs.size() << " .his files into '" << output_prefix << ".his'\n";
+	size_t overflows = 0;
+	if(!SumHisFiles(inputs, output_prefix, overflows)){ return false; }
+	if(overflows > 0){ std::cout << "BatchDriver: Warning! " << overflows << " histogram cells overflowed\n"; }
+
+	for(std::vector<std::string>::iterator iter = inputs.begin(); iter != inputs.end(); iter++){
+		merged_files.push_back(*iter + ".his");
+		merged_files.push_back(*iter + ".drr");
+		merged_files.push_back(*iter + ".list");
+		merged_files.push_back(*iter + ".log");
+	}
+
+	return true;
+}
+
+bool BatchDriver::merge_root(){
+	std::vector<std::string> trees = get_friend_trees();
+	trees.insert(trees.begin(), ""); // The master tree
+
+	for(std::vector<std::string>::iterator tree = trees.begin(); tree != trees.end(); tree++){
+		std::vector<std::string> inputs;
+		for(size_t i = 0; i < input_files.size(); i++){
+			std::vector<std::string> files = get_root_files(get_worker_prefix(i), *tree);
+			inputs.insert(inputs.end(), files.begin(), files.end());
+		}
+		if(inputs.empty()){ continue; }
+
+		std::string output = (tree->empty() ? output_prefix : output_prefix + "_" + *tree) + ".root";
+		std::cout << "BatchDriver: Merging " << inputs.size() << " root files into '" << output << "'\n";
+		if(!MergeRootFiles(inputs, output)){ return false; }
+		merged_files.insert(merged_files.end(), inputs.begin(), inputs.end());
+	}
+
+	if(!FileExists(output_prefix + ".root")){ return true; } // Root output is not in use
+
+	// The merged master tree still refers to the friend files of the first worker
+	TFile *file = new TFile((output_prefix + ".root").c_str(), "UPDATE");
+	if(file->IsZombie()){
+		std::cout << "BatchDriver: Error! Failed to open '" << output_prefix << ".root'\n";
+		delete file;
+		return false;
+	}
+	TTree *tree = (TTree*)file->Get("Pixie16");
+	if(tree && tree->GetListOfFriends() && tree->GetListOfFriends()->GetSize() > 0){
+		std::vector<std::pair<std::string, bool> > friends;
+		TIter next(tree->GetListOfFriends());
+		TFriendElement *element;
+		while((element = (TFriendElement*)next())){
+			friends.push_back(std::make_pair(std::string(element->GetTreeName()), std::string(element->GetTitle()).empty()));
+		}
+		tree->GetListOfFriends()->Delete();
+		for(std::vector<std::pair<std::string, bool> >::iterator iter = friends.begin(); iter != friends.end(); iter++){
+			if(iter->second){ tree->AddFriend(iter->first.c_str()); } // Friend tree in the same file
+			else{ tree->AddFriend(iter->first.c_str(), (output_prefix + "_" + iter->first + ".root").c_str()); }
+		}
+		file->cd();
+		tree->Write("", TObject::kOverwrite);
+	}
+	file->Close();
+	delete file;
+
+	return true;
+}
+
+BatchDriver::BatchDriver(){
+	exe_name = "PixieLDF";
+	num_workers = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_workers == 0){ num_workers = 1; }
+	keep_files = false;
+	num_pieces = 0;
+}
+
+void BatchDriver::Help(){
+	std::cout << "SYNTAX: " << exe_name << " --batch [options] <output-prefix> <input-fname> [input-fname ...] [-- worker options]\n";
+	std::cout << " Available options:\n";
+	std::cout << "  -j <N>      | Run at most N files at once (default = number of cpus)\n";
+	std::cout << "  --keep      | Do not delete the output of each worker after merging\n";
+	std::cout << "  --split <N> | Split each ldf/pld file into N spill-aligned pieces\n";
+	std::cout << " Worker options default to '--batch'\n";
+}
+
+bool BatchDriver::SetArgs(int argc, char *argv[]){
+	exe_name = argv[0];
+
+	bool user_args = false;
+	for(int i = 2; i < argc; i++){
+		std::string arg(argv[i]);
+		if(user_args){ worker_args.push_back(arg); }
+		else if(arg == "--"){ user_args = true; }
+		else if(arg == "-j"){
+			if(++i >= argc || atoi(argv[i]) <= 0){
+				std::cout << "BatchDriver: Error! -j requires a positive number of workers\n";
+				return false;
+			}
+			num_workers = atoi(argv[i]);
+		}
+		else if(arg == "--keep"){ keep_files = true; }
+		else if(arg == "--split"){
+			if(++i >= argc || atoi(argv[i]) <= 0){
+				std::cout << "BatchDriver: Error! --split requires a positive number of pieces\n";
+				return false;
+			}
+			num_pieces = atoi(argv[i]);
+		}
+		else if(output_prefix.empty()){ output_prefix = arg; }
+		else{ input_files.push_back(arg); }
+	}
+	if(!user_args){ worker_args.push_back("--batch"); }
+
+	if(output_prefix.empty() || input_files.empty()){
+		std::cout << "BatchDriver: Error! An output prefix and at least one input file are required\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool BatchDriver::Run(){
+	if(num_pieces > 0 && !split_inputs()){ return false; }
+
+	std::vector<int> pids(input_files.size(), -1);
+	size_t next_file = 0;
+	unsigned int running = 0;
+	unsigned int failed = 0;
+
+	std::cout << "BatchDriver: Processing " << input_files.size() << " files with up to " << num_workers << " workers\n";
+	while(next_file < input_files.size() || running > 0){
+		// Keep the maximum number of workers busy
+		while(running < num_workers && next_file < input_files.size()){
+			pids.at(next_file) = start_worker(next_file);
+			if(pids.at(next_file) < 0){
+				std::cout << "BatchDriver: Error! Failed to start worker for '" << input_files.at(next_file) << "'\n";
+				failed++;
+			}
+			else{
+				std::cout << "BatchDriver: Started worker " << next_file << " for '" << input_files.at(next_file) << "'\n";
+				running++;
+			}
+			next_file++;
+		}
+		if(running == 0){ break; }
+
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if(pid < 0){ break; }
+
+		size_t index = 0;
+		while(index < pids.size() && pids.at(index) != (int)pid){ index++; }
+		if(index == pids.size()){ continue; } // Not one of our workers
+		running--;
+
+		if(WIFEXITED(status) && WEXITSTATUS(status) == 0){
+			std::cout << "BatchDriver: Worker " << index << " finished '" << input_files.at(index) << "'\n";
+		}
+		else{
+			std::cout << "BatchDriver: Error! Worker " << index << " failed on '" << input_files.at(index) << "', see '" << get_worker_prefix(index) << ".out'\n";
+			failed++;
+		}
+	}
+
+	// The pieces of split files are copies of the input and are no longer needed
+	for(std::vector<std::string>::iterator iter = piece_files.begin(); iter != piece_files.end(); iter++){
+		remove(iter->c_str());
+	}
+
+	if(failed > 0){
+		std::cout << "BatchDriver: " << failed << " workers failed. Output was not merged\n";
+		return false;
+	}
+
+	if(!merge_his() || !merge_root()){
+		std::cout << "BatchDriver: Error! Failed to merge worker output. Worker files were kept\n";
+		return false;
+	}
+
+	if(!keep_files){
+		for(size_t i = 0; i < input_files.size(); i++){ merged_files.push_back(get_worker_prefix(i) + ".out"); }
+		for(std::vector<std::string>::iterator iter = merged_files.begin(); iter != merged_files.end(); iter++){
+			remove(iter->c_str());
+		}
+	}
+
+	std::cout << "BatchDriver: Done\n";
+	return true;
+}
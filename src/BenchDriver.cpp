@@ -0,0 +1,155 @@
+/** \file BenchDriver.cpp
+ * \brief Build synthetic events in memory to time the analysis stages
+ */
+
+#include <iostream>
+#include <algorithm>
+
+#include <cstdlib>
+
+#include "PixieEvent.hpp"
+
+#include "BenchDriver.hpp"
+#include "DetectorLibrary.hpp"
+#include "Globals.hpp"
+
+/// Order the channels of an event by time
+static bool EarlierEvent(const PixieEvent *lhs_, const PixieEvent *rhs_){
+	return lhs_->time < rhs_->time;
+}
+
+BenchDriver::BenchDriver() : rand(1){
+	num_spills = 20;
+	events_per_spill = 1000;
+	multiplicity = 2.0;
+	trace_len = 250;
+	noise = 3.0;
+	seed = 1;
+	event_time = 0.0;
+	spill = 0;
+	num_events = 0;
+	num_channels = 0;
+}
+
+PixieEvent *BenchDriver::make_event(unsigned int index_, double time_, unsigned int energy_){
+	PixieEvent *event = new PixieEvent();
+	unsigned long long ticks = (unsigned long long)time_;
+	event->modNum = channels[index_] / pixie::numberOfChannels;
+	event->chanNum = channels[index_] % pixie::numberOfChannels;
+	event->time = time_;
+	event->eventTime = time_;
+	event->eventTimeLo = ticks & 0xFFFFFFFF;
+	event->eventTimeHi = ticks >> 32;
+	event->energy = energy_;
+	if(trace_len > 0){
+		make_trace(shapes[index_], energy_ / 8.0, noise, rand, samples);
+		event->adcTrace.assign(samples.begin(), samples.end());
+	}
+	return event;
+}
+
+void BenchDriver::Help(){
+	std::cout << "SYNTAX: " << exe_name << " --bench [options] <output-prefix>\n";
+	std::cout << " Available options:\n";
+	std::cout << "  --spills <N> | Number of spills (default = 20)\n";
+	std::cout << "  --events <N> | Events per spill (default = 1000)\n";
+	std::cout << "  --mult <M>   | Mean number of channels per event (default = 2)\n";
+	std::cout << "  --trace <N>  | Trace length in samples, 0 for no traces (default = 250)\n";
+	std::cout << "  --noise <S>  | Trace noise in adc channels (default = 3)\n";
+	std::cout << "  --seed <N>   | Random number seed (default = 1)\n";
+	std::cout << " Events are generated for every channel of ./setup/map2.txt, which is\n";
+	std::cout << " only loaded when DAMM output is on in ./setup/default.config\n";
+}
+
+bool BenchDriver::SetArgs(int argc, char *argv[]){
+	exe_name = argv[0];
+
+	for(int i = 2; i < argc; i++){
+		std::string arg(argv[i]);
+		if(arg == "--spills" || arg == "--events" || arg == "--mult" || arg == "--trace" || arg == "--noise" || arg == "--seed"){
+			if(++i >= argc){
+				std::cout << "BenchDriver: Error! " << arg << " requires a value\n";
+				return false;
+			}
+			if(arg == "--spills"){ num_spills = atoi(argv[i]); }
+			else if(arg == "--events"){ events_per_spill = atoi(argv[i]); }
+			else if(arg == "--mult"){ multiplicity = strtod(argv[i], NULL); }
+			else if(arg == "--trace"){ trace_len = atoi(argv[i]); }
+			else if(arg == "--noise"){ noise = strtod(argv[i], NULL); }
+			else{ seed = strtoull(argv[i], NULL, 0); }
+		}
+		else if(output_prefix.empty()){ output_prefix = arg; }
+		else{
+			std::cout << "BenchDriver: Error! Unexpected argument '" << arg << "'\n";
+			return false;
+		}
+	}
+
+	if(output_prefix.empty()){
+		std::cout << "BenchDriver: Error! An output prefix is required\n";
+		return false;
+	}
+	if(num_spills == 0 || events_per_spill == 0 || multiplicity < 1.0){
+		std::cout << "BenchDriver: Error! At least one spill and one event per spill, with a multiplicity of at least 1, are required\n";
+		return false;
+	}
+
+	rand = GenRandom(seed);
+	samples.resize(trace_len);
+	return true;
+}
+
+bool BenchDriver::Init(){
+	DetectorLibrary *modChan = DetectorLibrary::get();
+	for(DetectorLibrary::size_type i = 0; i < modChan->size(); i++){
+		if(!modChan->HasValue(i) || modChan->at(i).GetType() == "ignore"){ continue; }
+		channels.push_back(i);
+		shapes.push_back(shape_for_type(modChan->at(i).GetType()));
+	}
+
+	if(channels.empty()){
+		std::cout << "BenchDriver: Error! No channels were loaded from the map file, check that DAMM output is on\n";
+		return false;
+	}
+	std::cout << "BenchDriver: Generating " << num_spills << " spills of " << events_per_spill << " events for " << channels.size() << " channels\n";
+	return true;
+}
+
+size_t BenchDriver::NextSpill(std::deque<PixieEvent*> &events_){
+	if(spill >= num_spills){ return 0; }
+
+	// Events are further apart than the event width, the channels of an event are within half of it
+	const double gap = 4.0 * pixie::eventWidth;
+	const unsigned int window = pixie::eventWidth / 2;
+	size_t added = 0;
+	std::vector<PixieEvent*> hits;
+	for(unsigned int i = 0; i < events_per_spill; i++){
+		event_time += gap + rand.Exponential(gap);
+		unsigned int mult = 1 + rand.Poisson(multiplicity - 1.0);
+		for(unsigned int m = 0; m < mult; m++){
+			unsigned int index = rand.Next() % channels.size();
+			double hit_time = event_time + (m > 0 ? rand.Next() % (window + 1) : 0);
+			unsigned int energy = 10 + (unsigned int)rand.Exponential(4000.0);
+			hits.push_back(make_event(index, hit_time, energy));
+		}
+		std::sort(hits.begin(), hits.end(), EarlierEvent);
+		events_.insert(events_.end(), hits.begin(), hits.end());
+		added += hits.size();
+		hits.clear();
+	}
+
+	spill++;
+	num_events += events_per_spill;
+	num_channels += added;
+	return added;
+}
+
+void BenchDriver::Print(const StageTimer &scan_timer_) const {
+	std::cout << "BenchDriver: Generated " << num_events << " events (" << num_channels << " channels) in " << spill << " spills\n";
+	std::cout << "BenchDriver: Stage timing (wall clock)\n";
+	StageTimer::PrintHeader();
+	scan_timer_.Print("ProcessRawEvent");
+	if(scan_timer_.GetSeconds() > 0.0){
+		std::cout << "BenchDriver: " << (unsigned long long)(num_events / scan_timer_.GetSeconds()) << " events/s\n";
+	}
+}
@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "CfdAnalyzer.hpp"
+#include "WaveformAnalyzer.hpp"
 
 using namespace std;
 
@@ -38,19 +39,25 @@ bool CfdAnalyzer::InitDamm()
 }
 
 //********** Analyze **********
+/** Only traces analyzed by the WaveformAnalyzer have the features used here */
+bool CfdAnalyzer::AppliesTo(const string &detType, const string &detSubtype) const
+{
+	return WaveformAnalyzer::IsWaveformType(detType);
+}
+
 void CfdAnalyzer::Analyze(Trace &trace, const string &detType, const string &detSubtype)
 {
 	StartAnalyze();
 	TraceAnalyzer::Analyze(trace, detType, detSubtype);
 	
-	unsigned int saturation = (unsigned int)trace.GetValue("saturation");
-	if(saturation > 0) {
+	const TraceFeatures &features = trace.GetFeatures();
+	if(!features.valid) {
 		EndAnalyze();
 		return;
 	}
 	
-	double aveBaseline = trace.GetValue("baseline");
-	unsigned int maxPos = (unsigned int)trace.GetValue("maxpos");
+	double aveBaseline = features.baseline;
+	unsigned int maxPos = features.maxPos;
 	
 	unsigned int waveformLow = (unsigned int)TimingInformation::GetConstant("waveformLow");
 	unsigned int waveformHigh = (unsigned int)TimingInformation::GetConstant("waveformHigh");
@@ -16,15 +16,20 @@ void ChanEvent::ZeroNums() {
 	calEnergy = -1;
 	correctedTime = -1;
 	hires_time = -1;
+	chanID = NULL;
 	event->clear();
 }
 
-const Identifier& ChanEvent::GetChanID() const {
-    return DetectorLibrary::get()->at(event->modNum, event->chanNum);
+const TimingInformation::TimingData& ChanEvent::GetTimingData() const {
+    if (!timing)
+        timing = new TimingInformation::TimingData(const_cast<ChanEvent*>(this));
+    return *timing;
 }
 
-int ChanEvent::GetID() const {
-    return DetectorLibrary::get()->GetIndex(event->modNum, event->chanNum);
+void ChanEvent::UpdateHighResTime() const {
+    trace->RunPendingAnalysis();
+    if (trace->HasValue("phase"))
+        hires_time = trace->GetValue("phase") * pixie::adcClockInSeconds + GetTrigTime() * pixie::filterClockInSeconds;
 }
 
 /** \return The Onboard QDC value at i
@@ -37,5 +42,8 @@ unsigned long ChanEvent::GetQdcValue(int i) const {
 void ChanEvent::ZeroVar() {
     ZeroNums();
     trace->clear();
+    trace->ClearPendingAnalysis();
+    delete timing;
+    timing = NULL;
 }
 //! [Zero Channel]
@@ -44,10 +44,46 @@ const double Correlator::minImpTime = 5e-3;
 const double Correlator::corrTime   = 60; // used to be 3300
 const double Correlator::fastTime   = 40e-6;
 
-Correlator::Correlator() : histo(OFFSET, RANGE), lastImplant(NULL), lastDecay(NULL), condition(UNKNOWN_CONDITION)
+Correlator::Correlator() : histo(OFFSET, RANGE), lastImplant(NULL), lastDecay(NULL), condition(UNKNOWN_CONDITION), droppedEvents(0)
 {
 }
 
+Correlator::PixelIndex::PixelIndex()
+{
+    for (unsigned int i=0; i < arraySize; i++) {
+	for (unsigned int j=0; j < arraySize; j++)
+	    position[i][j] = -1;
+    }
+}
+
+void Correlator::PixelIndex::Add(unsigned int fch, unsigned int bch)
+{
+    if (position[fch][bch] >= 0)
+	return;
+    position[fch][bch] = pixels.size();
+    pixels.push_back(fch * arraySize + bch);
+}
+
+void Correlator::PixelIndex::Remove(unsigned int fch, unsigned int bch)
+{
+    int index = position[fch][bch];
+    if (index < 0)
+	return;
+    // move the last pixel into the hole
+    unsigned int last = pixels.back();
+    pixels[index] = last;
+    position[last / arraySize][last % arraySize] = index;
+    pixels.pop_back();
+    position[fch][bch] = -1;
+}
+
+void Correlator::PixelIndex::Clear(void)
+{
+    for (vector<unsigned int>::const_iterator it = pixels.begin(); it != pixels.end(); it++)
+	position[*it / arraySize][*it % arraySize] = -1;
+    pixels.clear();
+}
+
 EventInfo::EventInfo()
 {
     flagged = false;
@@ -69,11 +105,12 @@ EventInfo::EventInfo()
 CorrelationList::CorrelationList() : std::vector<EventInfo>()
 {
     flagged = false;
+    dropped = false;
 }
 
 double CorrelationList::GetDecayTime() const
 {
-    if (empty() || back().type == EventInfo::IMPLANT_EVENT) {
+    if (empty() || dropped || back().type == EventInfo::IMPLANT_EVENT) {
 	return NAN;
     } else {
 	return back().dtime;
@@ -89,9 +126,10 @@ double CorrelationList::GetImplantTime() const
     }
 }
 
+/** If the last event was dropped, only the list is flagged */
 void CorrelationList::Flag() 
 {
-    if (!empty())
+    if (!empty() && !dropped)
 	back().flagged = true;
     flagged = true;
 }
@@ -104,9 +142,18 @@ bool CorrelationList::IsFlagged() const
 void CorrelationList::clear()
 {
     flagged = false;
+    dropped = false;
     vector<EventInfo>::clear();
 }
 
+void CorrelationList::Trim()
+{
+    flagged = false;
+    dropped = false;
+    if (size() > 1)
+	erase(begin() + 1, end());
+}
+
 void CorrelationList::PrintDecayList() const
 {
     ofstream fullLog("HIS/full_decays.txt", ios::app);
@@ -188,12 +235,51 @@ void Correlator::Init(RawEvent& rawev)
 Correlator::~Correlator()
 {
     // dump any flagged decay lists which have not been output
-    for (unsigned int i=0; i < arraySize; i++) {
-	for (unsigned int j=0; j < arraySize; j++) {
-	    if (IsFlagged(i,j))
-		PrintDecayList(i,j);
-	}
-    }    
+    const vector<unsigned int> &pixels = occupied.GetPixels();
+    for (vector<unsigned int>::const_iterator it = pixels.begin(); it != pixels.end(); it++) {
+	if (IsFlagged(*it / arraySize, *it % arraySize))
+	    PrintDecayList(*it / arraySize, *it % arraySize);
+    }
+    if (droppedEvents > 0)
+	cout << "Correlator: " << droppedEvents << " events were not stored because a decay list was full" << endl;
+}
+
+/**
+ *  Empty the decay list of a pixel and remove it from the indices
+ */
+void Correlator::ClearPixel(unsigned int fch, unsigned int bch)
+{
+    decaylist[fch][bch].clear();
+    occupied.Remove(fch, bch);
+    live.Remove(fch, bch);
+}
+
+/**
+ *  Trim the decay lists of the pixels whose implant is older than the
+ *    correlation time. Any decay in those pixels would be too late, so
+ *    only the implant is kept to detect back-to-back implants. Flagged
+ *    lists are printed first
+ */
+void Correlator::Expire(double time)
+{
+    const double window = corrTime / pixie::clockInSeconds;
+
+    while (!expiryQueue.empty() && time - expiryQueue.front().first >= window) {
+	double implantTime = expiryQueue.front().first;
+	unsigned int fch = expiryQueue.front().second / arraySize;
+	unsigned int bch = expiryQueue.front().second % arraySize;
+	expiryQueue.pop_front();
+
+	// skip pixels which were cleared or implanted again since
+	CorrelationList &theList = decaylist[fch][bch];
+	if (theList.empty() || theList.GetImplantTime() != implantTime)
+	    continue;
+
+	if (theList.IsFlagged())
+	    PrintDecayList(fch, bch);
+	theList.Trim();
+	live.Remove(fch, bch);
+    }
 }
 
 void Correlator::DeclarePlots()
@@ -221,6 +307,8 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
 	return;
     }
 
+    Expire(event.time);
+
     CorrelationList &theList = decaylist[fch][bch];
     
     double lastTime = NAN;
@@ -249,6 +337,10 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
 	    theList.push_back(event);
 	    lastImplant = &theList.back();
 
+	    occupied.Add(fch, bch);
+	    live.Add(fch, bch);
+	    expiryQueue.push_back(make_pair(event.time, fch * arraySize + bch));
+
 	    break;
 	default:	    
  	    if ( theList.empty() ) {
@@ -275,14 +367,17 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
 			 << "\n  DT: " << dt << endl;
 		    // PIXIE's clock has most likely been zeroed due to a file marker
 		    //   no chance of doing correlations
-		    for (unsigned int i=0; i < arraySize; i++) {
-			for (unsigned int j=0; j < arraySize; j++) {
-			    if (IsFlagged(i,j)) {
-				PrintDecayList(i, j);
-			    }
-			    decaylist[i][j].clear();
+		    const vector<unsigned int> &pixels = occupied.GetPixels();
+		    for (vector<unsigned int>::const_iterator it = pixels.begin(); it != pixels.end(); it++) {
+			unsigned int i = *it / arraySize, j = *it % arraySize;
+			if (IsFlagged(i,j)) {
+			    PrintDecayList(i, j);
 			}
+			decaylist[i][j].clear();
 		    }
+		    occupied.Clear();
+		    live.Clear();
+		    expiryQueue.clear();
 		} else if (event.type != EventInfo::GAMMA_EVENT) {
 		    // since gammas are processed at a different time than everything else
 		    cout << "negative correlation time, DECAY: " << event.time
@@ -311,7 +406,21 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
 	    if (condition == VALID_DECAY) {
 		event.generation = theList.back().generation + 1;
 	    }
+	    if (condition == DECAY_TOO_LATE) {
+		ClearPixel(fch, bch);
+		break;
+	    }
+	    if (theList.size() >= maxListSize) {
+		// keep the memory used by a pixel bounded, and make sure the
+		//   dropped event is not confused with the last one stored
+		droppedEvents++;
+		theList.SetDropped(true);
+		lastDecay = NULL;
+		condition = LIST_FULL;
+		break;
+	    }
 	    theList.push_back(event);
+	    theList.SetDropped(false);
 	    if (event.energy == 0 && std::isnan(event.time))
 		cout << " Adding zero decay event " << endl;
 
@@ -320,8 +429,6 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
 
 	    if (condition == VALID_DECAY) {
 		lastDecay = &theList.back();
-	    } else if (condition == DECAY_TOO_LATE) {
-		theList.clear();
 	    }
 
 	    break;
@@ -337,21 +444,30 @@ void Correlator::Correlate(EventInfo &event, unsigned int fch, unsigned int bch)
  */
 void Correlator::CorrelateAll(EventInfo &event)
 {
-    for (unsigned int fch=0; fch < arraySize; fch++) {
-	for (unsigned int bch=0; bch < arraySize; bch++) {
-	    if (decaylist[fch][bch].size() == 0)
-		continue;
-	    if (event.time - decaylist[fch][bch].back().time < 10e-6 / pixie::clockInSeconds) {
-		// only correlate fast events for now
-		Correlate(event, fch, bch);
-	    }
+    Expire(event.time);
+
+    // only live pixels can have an event within the last 10 us, 
+    //   correlating may change the index so work on a copy
+    vector<unsigned int> pixels(live.GetPixels());
+    for (vector<unsigned int>::const_iterator it = pixels.begin(); it != pixels.end(); it++) {
+	unsigned int fch = *it / arraySize, bch = *it % arraySize;
+	if (decaylist[fch][bch].size() == 0)
+	    continue;
+	if (event.time - decaylist[fch][bch].back().time < 10e-6 / pixie::clockInSeconds) {
+	    // only correlate fast events for now
+	    Correlate(event, fch, bch);
 	}
     }
 }
 
+/**
+ *  Only implants change an empty pixel, so other events skip those pixels
+ */
 void Correlator::CorrelateAllX(EventInfo &event, unsigned int bch)
 {
     for (unsigned int fch = 0; fch < arraySize; fch++) {
+	if (event.type != EventInfo::IMPLANT_EVENT && bch < arraySize && !occupied.Has(fch, bch))
+	    continue;
 	Correlate(event, fch, bch);
     }
 }
@@ -359,6 +475,8 @@ void Correlator::CorrelateAllX(EventInfo &event, unsigned int bch)
 void Correlator::CorrelateAllY(EventInfo &event, unsigned int fch)
 {
     for (unsigned int bch = 0; bch < arraySize; bch++) {
+	if (event.type != EventInfo::IMPLANT_EVENT && fch < arraySize && !occupied.Has(fch, bch))
+	    continue;
 	Correlate(event, fch, bch);
     }
 }
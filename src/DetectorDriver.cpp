@@ -23,6 +23,7 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -32,12 +33,23 @@
 #include "Exceptions.hpp"
 #include "DetectorDriver.hpp"
 #include "DetectorLibrary.hpp"
+#include "EventDump.hpp"
 #include "MapFile.hpp"
 #include "RandomPool.hpp"
 #include "RawEvent.hpp"
 #include "TimingInformation.hpp"
 #include "TreeCorrelator.hpp"
 
+#include "RVersion.h"
+#include "TObjArray.h"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+#include <thread>
+#include "TROOT.h"
+
+// Thread used to write and close root files after a rollover
+static std::thread close_thread;
+#endif
+
 #include "TriggerProcessor.hpp"
 #include "DssdProcessor.hpp"
 #include "GeProcessor.hpp"
@@ -70,8 +82,9 @@ using namespace dammIds::raw;
 
 using namespace std;
 
-#define MAX_FILE_SIZE 4294967296ll // 4 GB. Maximum allowable .root file size in bytes
-#define EVENTS_FILL_WAIT 10000 // Number of events to wait between tree fills
+#define MAX_FILE_SIZE 4294967296ll // 4 GB. Default maximum allowable .root file size in bytes
+#define EVENTS_FILL_WAIT 10000 // Number of tree fills to wait between file flushes
+#define ROLLOVER_PREOPEN 0.9 // Fraction of the maximum file size at which the next file is opened
 
 // Convert a time in seconds to a time string with format hh:mm:ss
 std::string ConvTime(int myTime){ 
@@ -91,6 +104,35 @@ std::string ConvTime(int myTime){
 	return output.str();
 }
 
+// Convert a compression algorithm name and level to ROOT compression settings (100*algorithm + level)
+static int GetCompressionSettings(const std::string &algo, int level){
+	int algorithm;
+	if(algo == "zlib" || algo == "ZLIB"){ algorithm = 1; }
+	else if(algo == "lzma" || algo == "LZMA"){ algorithm = 2; }
+	else if(algo == "lz4" || algo == "LZ4"){ algorithm = 4; }
+	else if(algo == "zstd" || algo == "ZSTD"){ algorithm = 5; }
+	else{ algorithm = atoi(algo.c_str()); } // Numerical ROOT algorithm code
+	
+	if(level < 0){ level = 0; }
+	else if(level > 9){ level = 9; }
+	return 100*algorithm + level;
+}
+
+// Set the compression of all branches in a tree. Branches whose name ends in "Wave"
+// use the waveform settings. A negative value leaves the ROOT default untouched
+static void SetTreeCompression(TTree *tree, int settings, int wave_settings){
+	if(!tree){ return; }
+	TObjArray *branches = tree->GetListOfBranches();
+	for(int i = 0; i < branches->GetEntriesFast(); i++){
+		TBranch *branch = (TBranch*)branches->At(i);
+		std::string bname = branch->GetName();
+		if(bname.size() > 4 && bname.substr(bname.size()-4) == "Wave"){ 
+			if(wave_settings >= 0){ branch->SetCompressionSettings(wave_settings); }
+		}
+		else if(settings >= 0){ branch->SetCompressionSettings(settings); }
+	}
+}
+
 // The global .his file handler
 OutputHisFile *output_his;
 
@@ -100,6 +142,7 @@ OutputHisFile *output_his;
   Creates instances of all event processors
 */
 DetectorDriver* DetectorDriver::instance = NULL;
+bool DetectorDriver::replay = false;
 
 /** Instance is created upon first call */
 DetectorDriver* DetectorDriver::get() {
@@ -109,12 +152,27 @@ DetectorDriver* DetectorDriver::get() {
 	return instance;
 }
 
+/** Create the instance with the given output prefix if it does not exist yet */
+DetectorDriver* DetectorDriver::get(const std::string &output_filename_) {
+	if (!instance) {
+		instance = new DetectorDriver(output_filename_);
+	}
+	return instance;
+}
+
 DetectorDriver::DetectorDriver(std::string output_filename/*="output"*/, bool debug_/*=false*/) : histo(OFFSET, RANGE) 
 {
 	time(&start_time); // Start the master timer
 	is_init = false;
 	root_fname = output_filename;
 	num_files = 0;
+	max_file_size = MAX_FILE_SIZE;
+	split_trees = false;
+	split_files = false;
+	root_compression = -1;
+	wave_compression = -1;
+	dump_file = NULL;
+	random_seed = 0;
 	
 	// Load the configuration file
 	if(!LoadConfigFile()){
@@ -129,6 +187,15 @@ DetectorDriver::DetectorDriver(std::string output_filename/*="output"*/, bool de
 	
 	if(config_args.HasName("PULSEFIT", arg_value) && arg_value == "1"){ use_pfit = true; } // Use pulse fitting
 	if(config_args.HasName("DCFD", arg_value) && arg_value == "1"){ use_dcfd = true; } // Use cfd analyzer
+	if(config_args.HasName("RANDOM_SEED", arg_value)){ random_seed = strtoull(arg_value.c_str(), NULL, 0); } // Seed for energy dithering
+	if(config_args.HasName("PERF_COUNTERS", arg_value) && arg_value == "1"){ StageTimer::SetPerfCounters(true); } // Count cycles and cache misses of each stage
+	if(config_args.HasName("TAU", arg_value) && arg_value != "0"){ // Decay constant of preamp traces
+		size_t colon = arg_value.find(':');
+		if(arg_value == "1"){ vecAnalyzer.push_back(new TauAnalyzer()); }
+		else if(colon != std::string::npos){ vecAnalyzer.push_back(new TauAnalyzer(arg_value.substr(0, colon), arg_value.substr(colon+1))); }
+		if(arg_value == "1" || colon != std::string::npos){ std::cout << "DetectorDriver: TauAnalyzer is active (" << arg_value << ")\n"; }
+		else{ std::cout << "DetectorDriver: Warning! Expected TAU 1 or TAU type:subtype, not '" << arg_value << "'\n"; }
+	}
 	
 	if(use_pfit || use_dcfd){
 		vecAnalyzer.push_back(new WaveformAnalyzer());
@@ -164,6 +231,8 @@ DetectorDriver::DetectorDriver(std::string output_filename/*="output"*/, bool de
 		if(config_args.HasName("IONCHAMBER_WAVE", arg_value) && arg_value == "1"){ vecProcess.push_back(new IonChamberProcessor(true)); }
 		else{ vecProcess.push_back(new IonChamberProcessor(false)); }
 	}
+	if(config_args.HasName("GE", arg_value) && arg_value == "1"){ vecProcess.push_back(new GeProcessor()); } // GeProcessor (clovers)
+	if(config_args.HasName("POSITION", arg_value) && arg_value == "1"){ vecProcess.push_back(new PositionProcessor()); } // PositionProcessor (ssd strips)
 
 	// ROOT output is ON by default!
 	write_raw = false;
@@ -176,6 +245,48 @@ DetectorDriver::DetectorDriver(std::string output_filename/*="output"*/, bool de
 			write_raw = true; // Write raw module data to the root file
 		}
 		
+		// Processor output layout and compression
+		if(config_args.HasName("SPLIT_TREES", arg_value) && arg_value == "1"){ split_trees = true; }
+		if(config_args.HasName("SPLIT_FILES", arg_value) && arg_value == "1"){ split_trees = true; split_files = true; }
+		if(split_files){ std::cout << "DetectorDriver: Writing each processor to a separate friend tree and file\n"; }
+		else if(split_trees){ std::cout << "DetectorDriver: Writing each processor to a separate friend tree\n"; }
+		
+		std::string compress_algo = "zlib";
+		int compress_level = 1;
+		bool set_compression = false;
+		if(config_args.HasName("COMPRESS_ALGO", arg_value)){ compress_algo = arg_value; set_compression = true; }
+		if(config_args.HasName("COMPRESS_LEVEL", arg_value)){ compress_level = atoi(arg_value.c_str()); set_compression = true; }
+		if(set_compression){ root_compression = GetCompressionSettings(compress_algo, compress_level); }
+		
+		// Waveform branches use the same settings as physics branches unless told otherwise
+		if(config_args.HasName("WAVE_COMPRESS_ALGO", arg_value)){ compress_algo = arg_value; set_compression = true; }
+		if(config_args.HasName("WAVE_COMPRESS_LEVEL", arg_value)){ compress_level = atoi(arg_value.c_str()); set_compression = true; }
+		if(set_compression){ wave_compression = GetCompressionSettings(compress_algo, compress_level); }
+		
+		if(root_compression >= 0){ std::cout << "DetectorDriver: Using root compression settings " << root_compression << "\n"; }
+		if(wave_compression >= 0 && wave_compression != root_compression){ 
+			std::cout << "DetectorDriver: Using root compression settings " << wave_compression << " for waveforms\n"; 
+		}
+		
+		// Maximum output file size in MB before rolling over to a new file
+		if(config_args.HasName("ROOT_MAX_SIZE", arg_value) && atoll(arg_value.c_str()) > 0){
+			max_file_size = atoll(arg_value.c_str()) * 1048576ll;
+			std::cout << "DetectorDriver: Rolling over to a new root file every " << arg_value << " MB\n";
+		}
+		
+		// Compress branch baskets in parallel
+		if(config_args.HasName("ROOT_THREADS", arg_value) && atoi(arg_value.c_str()) > 0){
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+			ROOT::EnableImplicitMT(atoi(arg_value.c_str()));
+			std::cout << "DetectorDriver: Compressing root output with " << arg_value << " threads\n";
+#else
+			std::cout << "DetectorDriver: Warning! ROOT_THREADS requires ROOT 6.08 or newer, compression will be serial\n";
+#endif
+		}
+		
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+		ROOT::EnableThreadSafety(); // Old files are closed in the background after a rollover
+#endif
 		OpenNewFile();
 	}
 	else{ use_root = false; }
@@ -197,7 +308,25 @@ DetectorDriver::DetectorDriver(std::string output_filename/*="output"*/, bool de
 	}
 	else{ use_damm = false; }
 
-	if(!use_root && !use_damm){ std::cout << "DetectorDriver: Warning! Neither output method is turned on\n"; }
+	// Columnar event dump is OFF by default!
+	if(config_args.HasName("DUMP", arg_value) && arg_value == "1" && replay){
+		std::cout << "DetectorDriver: Not writing an event dump while replaying one\n";
+	}
+	else if(config_args.HasName("DUMP", arg_value) && arg_value == "1"){
+		bool dump_traces = (config_args.HasName("DUMP_TRACES", arg_value) && arg_value == "1");
+		dump_file = new EventDumpWriter(root_fname, dump_traces);
+		if(dump_file->IsOpen()){ 
+			std::cout << "DetectorDriver: Writing built events to '" << root_fname << ".pxd'\n"; 
+			if(dump_traces){ std::cout << "DetectorDriver: Writing traces to '" << root_fname << ".pxt'\n"; }
+		}
+		else{
+			std::cout << "DetectorDriver: Failed to create event dump file!\n";
+			delete dump_file;
+			dump_file = NULL;
+		}
+	}
+
+	if(!use_root && !use_damm && !dump_file){ std::cout << "DetectorDriver: Warning! Neither output method is turned on\n"; }
 
 	num_events = 0;
 	num_fills = 0;
@@ -217,6 +346,13 @@ DetectorDriver::~DetectorDriver()
 
 bool DetectorDriver::Delete()
 {
+	// Print the stage timing while the .his file is still open. Write the queued
+	// fills first so that the last .his file writes are timed as well
+	if(is_init){ 
+		if(use_damm){ output_his->Flush(); }
+		PrintTiming(); 
+	}
+
 	// Finalize the .his and .drr files
 	if(use_damm){
 		output_his->Close();
@@ -228,17 +364,21 @@ bool DetectorDriver::Delete()
 	}
 	
 	// Write root tree to file
-	if(use_root){
-		std::cout << "DetectorDriver: Writing TTree to file with " << masterTree->GetEntries() << " entries...";
-		masterFile->cd();
-		masterTree->Write();
-		
-		unsigned int filesize = masterFile->GetSize();
-		masterFile->Close();
-		delete masterFile;
-		std::cout << " done\n";
-		std::cout << "DetectorDriver: Wrote " << filesize << " bytes to file\n";
-	}	
+	if(use_root){ 
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+		if(close_thread.joinable()){ close_thread.join(); } // Wait for the previous file to close
+#endif
+		next_output.Discard(); // Remove pre-opened files which were never used
+		output.Close(); 
+	}
+	
+	// Flush the event dump
+	if(dump_file){
+		std::cout << "DetectorDriver: Wrote " << dump_file->GetNumEvents() << " events to dump file\n";
+		dump_file->Close();
+		delete dump_file;
+		dump_file = NULL;
+	}
 	
 	std::cout << "DetectorDriver: Cleaning up\n";
 	std::cout << "DetectorDriver: Found " << num_events << " total events\n";
@@ -267,7 +407,7 @@ bool DetectorDriver::Delete()
 	vecAnalyzer.clear();
 	
 	double total_real_time = difftime(time(NULL), start_time);
-	std::cout << "DetectorDriver: Total CPU Time = " << total_cpu_time << " seconds (" << ConvTime((int)total_cpu_time) << ")\n";
+	std::cout << "DetectorDriver: Total time in processors and analyzers = " << total_cpu_time << " seconds (" << ConvTime((int)total_cpu_time) << ")\n";
 	std::cout << "DetectorDriver: Total time taken = " << total_real_time << " seconds (" << ConvTime((int)total_real_time) << ")\n";
 	std::cout << "DetectorDriver: Done! Cleanup was successful!\n";
 	
@@ -293,6 +433,8 @@ bool DetectorDriver::Init(RawEvent& rawev)
 		(*it)->SetLevel(20); //! Plot traces
 	}
 
+	BuildAnalyzerChains();
+
 	// initialize processors in the event processing vector
 	for (vector<EventProcessor *>::iterator it = vecProcess.begin(); it != vecProcess.end(); it++) {
 		(*it)->Init(rawev); // Initialize EventProcessor	
@@ -365,69 +507,194 @@ bool DetectorDriver::OpenNewFile(){
 		return false;
 	}
 
+	// Use the pre-opened files if they are available
+	if(!next_output.IsOpen() && !OpenFiles(next_output)){ return false; }
+	
+	RootOutput old_output = output;
+	output = next_output;
+	next_output = RootOutput();
+	
+	// If there is already a file open, it needs to be closed.
+	if(old_output.IsOpen()){
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+		// Write and close the old files on a separate thread so that event processing can continue
+		if(close_thread.joinable()){ close_thread.join(); }
+		close_thread = std::thread(&RootOutput::Close, old_output);
+#else
+		old_output.Close();
+#endif
+	}
+	
+	return true;
+}
+
+bool DetectorDriver::OpenFiles(RootOutput &files){
 	// Get the new file name
-	std::string current_fname = "";
-	if(num_files == 0){ current_fname = root_fname + ".root"; } // root_fname.root
-	else{
+	std::string file_suffix = "";
+	if(num_files > 0){
 		std::stringstream str_num_files;
 		str_num_files << num_files;
-		if(num_files < 10){ current_fname = root_fname + "_0" + str_num_files.str() + ".root"; } // root_fname_01.root
-		else{ current_fname = root_fname + "_" + str_num_files.str() + ".root"; } // root_fname_10.root
-		
-		// Since num_files > 0, there is already a file open. It needs to be closed.
-		std::cout << "DetectorDriver: Writing TTree to file with " << masterTree->GetEntries() << " entries...";
-		masterFile->cd();
-		masterTree->Write();
-		
-		unsigned int filesize = masterFile->GetSize();		
-		masterFile->Close();
-		delete masterFile; // Also deleting masterTree will cause a segfault!
-		std::cout << " done\n";
-		std::cout << "DetectorDriver: Wrote " << filesize << " bytes to file\n";
+		if(num_files < 10){ file_suffix = "_0" + str_num_files.str(); } // root_fname_01.root
+		else{ file_suffix = "_" + str_num_files.str(); } // root_fname_10.root
 	}
+	std::string current_fname = root_fname + file_suffix + ".root";
 	
 	// Open the new file and create the tree
 	std::cout << "DetectorDriver: Opening file '" << current_fname << "'\n";
-	masterFile = new TFile(current_fname.c_str(), "RECREATE"); // Will overwrite the file!
-	masterTree = new TTree("Pixie16","Pixie analysis tree");
+	files.masterFile = new TFile(current_fname.c_str(), "RECREATE"); // Will overwrite the file!
+	if(!files.masterFile || files.masterFile->IsZombie()){
+		std::cout << "DetectorDriver: Error! Failed to open file '" << current_fname << "'\n";
+		delete files.masterFile;
+		files.masterFile = NULL;
+		return false;
+	}
+	files.masterTree = new TTree("Pixie16","Pixie analysis tree");
 	
 	if(write_raw){
 		/*unsigned int num_modules = DetectorLibrary::get()->GetPhysicalModules();
 		std::cout << "DetectorDriver: Setting up raw event data structure with " << num_modules << " modules\n";
 		if(!structure){ structure = new RawEventStructure(num_modules); }*/
-		masterTree->Branch("RawEvent", &structure);
+		files.masterTree->Branch("RawEvent", &structure);
 	}
 
-	if(num_files == 0){
-		// Add analyzer branches to root tree
-		/*for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {
-			std::cout << " " << (*it)->GetName() << "Analyzer: Initializing root output\n";
-			if(!(*it)->InitRoot(masterTree)){ std::cout << " " << (*it)->GetName() << "Analyzer: Warning! Failed to add branch\n"; }
-		}*/
+	// Add analyzer branches to root tree
+	/*for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {
+		std::cout << " " << (*it)->GetName() << "Analyzer: Initializing root output\n";
+		if(!(*it)->InitRoot(files.masterTree)){ std::cout << " " << (*it)->GetName() << "Analyzer: Warning! Failed to add branch\n"; }
+	}*/
 
-		// Add processor branches to root tree
-		for (vector<EventProcessor *>::iterator it = vecProcess.begin(); it != vecProcess.end(); it++) {
-			std::cout << " " << (*it)->GetName() << "Processor: Initializing root output\n";
-			if(!(*it)->InitRoot(masterTree)){ std::cout << " " << (*it)->GetName() << "Processor: Warning! Failed to add branch\n"; }
+	// Add processor branches to root tree. In split mode, each processor gets its own
+	// tree (and optionally its own file) which is linked to the master tree as a friend
+	for (vector<EventProcessor *>::iterator it = vecProcess.begin(); it != vecProcess.end(); it++) {
+		std::string proc_name = (*it)->GetName();
+		TFile *proc_file = NULL;
+		TTree *proc_tree = files.masterTree;
+		if(num_files == 0){ std::cout << " " << proc_name << "Processor: Initializing root output\n"; }
+		if(split_trees){
+			if(split_files){ // Creating the file also makes it the current directory
+				std::string proc_fname = root_fname + "_" + proc_name + file_suffix + ".root";
+				std::cout << " " << proc_name << "Processor: Opening file '" << proc_fname << "'\n";
+				proc_file = new TFile(proc_fname.c_str(), "RECREATE");
+			}
+			else{ files.masterFile->cd(); }
+			proc_tree = new TTree(proc_name.c_str(), (proc_name + " processor tree").c_str());
 		}
-	}
-	else{
-		// Add analyzer branches to root tree
-		/*for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {
-			(*it)->InitRoot(masterTree)
-		}*/
-
-		// Add processor branches to root tree
-		for (vector<EventProcessor *>::iterator it = vecProcess.begin(); it != vecProcess.end(); it++) {
-			(*it)->InitRoot(masterTree);
+		
+		if(!(*it)->InitRoot(proc_tree)){ 
+			if(num_files == 0){ std::cout << " " << proc_name << "Processor: Warning! Failed to add branch\n"; }
+			if(split_trees){ // Do not keep an empty tree around
+				if(proc_file){ 
+					proc_file->Close(); 
+					delete proc_file; // Also deletes proc_tree
+				}
+				else{ delete proc_tree; }
+				proc_file = NULL;
+				proc_tree = NULL;
+			}
+		}
+		else if(split_trees){
+			SetTreeCompression(proc_tree, root_compression, wave_compression);
+			files.masterTree->AddFriend(proc_tree);
 		}
-	}	
+		
+		if(split_trees){
+			files.friendFiles.push_back(proc_file);
+			files.friendTrees.push_back(proc_tree);
+		}
+	}
+	
+	files.masterFile->cd();
+	SetTreeCompression(files.masterTree, root_compression, wave_compression);
 	
 	num_files++;
-	if(!masterFile){ return false; }
 	return true;
 }
 
+void RootOutput::Fill(){
+	masterTree->Fill(); 
+	for(vector<TTree *>::iterator it = friendTrees.begin(); it != friendTrees.end(); it++){
+		if(*it){ (*it)->Fill(); }
+	}
+}
+
+void RootOutput::Flush(){
+	masterFile->Write(0,TObject::kWriteDelete);
+	masterFile->Flush();
+	for(vector<TFile *>::iterator it = friendFiles.begin(); it != friendFiles.end(); it++){
+		if(!*it){ continue; }
+		(*it)->Write(0,TObject::kWriteDelete);
+		(*it)->Flush();
+	}
+}
+
+Long64_t RootOutput::GetSize(){
+	Long64_t size = masterFile->GetSize();
+	for(vector<TFile *>::iterator it = friendFiles.begin(); it != friendFiles.end(); it++){
+		if(*it && (*it)->GetSize() > size){ size = (*it)->GetSize(); }
+	}
+	return size;
+}
+
+Long64_t RootOutput::Close(){
+	if(!masterFile){ return 0; }
+	
+	std::string fname = masterFile->GetName();
+	Long64_t entries = masterTree->GetEntries();
+	
+	// Friend trees stored in the master file must be written before it is closed
+	masterFile->cd();
+	for(unsigned int i = 0; i < friendTrees.size(); i++){
+		if(friendTrees[i] && !friendFiles[i]){ friendTrees[i]->Write(); }
+	}
+	masterTree->Write();
+	
+	Long64_t filesize = masterFile->GetSize();
+	masterFile->Close();
+	delete masterFile; // Also deleting masterTree will cause a segfault!
+	masterFile = NULL;
+	masterTree = NULL;
+	
+	// Write and close the separate processor files
+	for(unsigned int i = 0; i < friendFiles.size(); i++){
+		if(!friendFiles[i]){ continue; }
+		friendFiles[i]->cd();
+		friendTrees[i]->Write();
+		filesize += friendFiles[i]->GetSize();
+		friendFiles[i]->Close();
+		delete friendFiles[i];
+	}
+	friendFiles.clear();
+	friendTrees.clear();
+	
+	std::cout << "DetectorDriver: Wrote TTree with " << entries << " entries (" << filesize << " bytes) to '" << fname << "'\n";
+	
+	return filesize;
+}
+
+void RootOutput::Discard(){
+	if(!masterFile){ return; }
+	
+	std::vector<std::string> fnames;
+	fnames.push_back(masterFile->GetName());
+	masterFile->Close();
+	delete masterFile;
+	masterFile = NULL;
+	masterTree = NULL;
+	
+	for(unsigned int i = 0; i < friendFiles.size(); i++){
+		if(!friendFiles[i]){ continue; }
+		fnames.push_back(friendFiles[i]->GetName());
+		friendFiles[i]->Close();
+		delete friendFiles[i];
+	}
+	friendFiles.clear();
+	friendTrees.clear();
+	
+	for(std::vector<std::string>::iterator it = fnames.begin(); it != fnames.end(); it++){
+		remove(it->c_str());
+	}
+}
+
 /*!
   \brief controls event processing
 
@@ -446,19 +713,32 @@ int DetectorDriver::ProcessEvent(RawEvent& rawev){
 	  Begin the event processing looping over all the channels
 	  that fired in this particular event.
 	*/
+	event_timer.Start();
 	plot(dammIds::raw::D_NUMBER_OF_EVENTS, dammIds::GENERIC_CHANNEL);
 	num_events++; // Count the number of raw events
 	
 	// Zero the raw event structure before beginning
 	if(write_raw){ structure.Zero(); }
 	
+	// Dump the uncalibrated event so that it may be replayed later
+	if(dump_file){ dump_file->Append(rawev); }
+	
 	bool has_event = false;
-	for (vector<ChanEvent*>::const_iterator it = rawev.GetEventList().begin(); it != rawev.GetEventList().end(); ++it) {
+	const vector<ChanEvent*> &eventList = rawev.GetEventList();
+	vector<ChanEvent*> chans;
+	chans.reserve(eventList.size());
+	for (vector<ChanEvent*>::const_iterator it = eventList.begin(); it != eventList.end(); ++it) {
+		if ((*it)->GetChanID().GetPlaceName() != "__-1") // skip empty channels
+			chans.push_back(*it);
+	}
+
+	cal_timer.Start();
+	ThreshAndCal(chans, rawev); // check thresholds and calibrate all channels
+	cal_timer.Stop();
+	cal_timer.AddChannels(chans.size());
+	
+	for (vector<ChanEvent*>::const_iterator it = chans.begin(); it != chans.end(); ++it) {
 		string place = (*it)->GetChanID().GetPlaceName();
-		if (place == "__-1") // empty channel
-			continue;
-		
-		ThreshAndCal((*it), rawev); // check threshold and calibrate
 		if(use_damm && write_raw){ 
 			PlotRaw((*it));
 			PlotCal((*it));
@@ -484,6 +764,7 @@ int DetectorDriver::ProcessEvent(RawEvent& rawev){
 	for (vector<EventProcessor*>::iterator iProc = vecProcess.begin(); iProc != vecProcess.end(); iProc++) {
 		if(use_root){ (*iProc)->Zero(); } // Zero the structure in preparation for processing, mark entry as invalid (valid=false)
 		if ( (*iProc)->HasEvent() ) { 
+			(*iProc)->CountChannels();
 			if((*iProc)->PreProcess(rawev) && !has_event){ has_event = true; }
 		}
 	}
@@ -496,23 +777,96 @@ int DetectorDriver::ProcessEvent(RawEvent& rawev){
 	}
 	
 	// Fill all processor branches for each event (even if they are invalid)
+	// Friend trees are always filled together with the master tree to keep entries aligned
 	if(use_root && has_event){ 
-		masterTree->Fill(); 
-		if(num_events % EVENTS_FILL_WAIT == 0){
-			masterFile->Write(0,TObject::kWriteDelete);
-			masterFile->Flush();
-		}
+		fill_timer.Start();
+		output.Fill();
 		num_fills++; // Count the number of tree fills
-
-		// Limit root file size to roughly 4 GB
-		if(masterFile->GetSize() >= MAX_FILE_SIZE){ 
-			OpenNewFile(); 
+		
+		// The file size only changes when baskets are written, so only check it after a flush
+		if(num_fills % EVENTS_FILL_WAIT == 0){
+			output.Flush();
+			
+			// Limit root file size. Open the next file early so the rollover itself is quick
+			Long64_t size = output.GetSize();
+			if(size >= max_file_size){ OpenNewFile(); }
+			else if(size >= ROLLOVER_PREOPEN*max_file_size && !next_output.IsOpen()){ OpenFiles(next_output); }
 		}
+		fill_timer.Stop();
 	} 
 
+	event_timer.Stop();
+	event_timer.AddChannels(eventList.size());
 	return 0;   
 }
 
+/** Build the list of trace analyzers for every channel in the map so that each
+  * trace only goes through the analyzers which apply to its type and subtype.
+  * The analyzers at the end of a channel's list which can be deferred are moved
+  * to a second list, which is only run when a processor asks for the results.
+  */
+void DetectorDriver::BuildAnalyzerChains(){
+	DetectorLibrary* modChan = DetectorLibrary::get();
+	map<string, string> summary;
+	
+	analyzerChains.assign(modChan->size(), vector<TraceAnalyzer *>());
+	deferredChains.assign(modChan->size(), vector<TraceAnalyzer *>());
+	for (DetectorLibrary::size_type i = 0; i < modChan->size(); i++) {
+		if (!modChan->HasValue(i)) { continue; }
+		const string &type = modChan->at(i).GetType();
+		const string &subtype = modChan->at(i).GetSubtype();
+		if (type == "ignore" || type == "") { continue; }
+		
+		vector<TraceAnalyzer *> &chain = analyzerChains[i];
+		for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {
+			if ((*it)->AppliesTo(type, subtype)) { chain.push_back(*it); }
+		}
+		
+		// Only a trailing run of deferrable analyzers may be put off, so the order is kept
+		vector<TraceAnalyzer *>::iterator first = chain.end();
+		while (first != chain.begin() && (*(first - 1))->CanDefer()) { first--; }
+		deferredChains[i].assign(first, chain.end());
+		chain.erase(first, chain.end());
+		
+		string names;
+		for (vector<TraceAnalyzer *>::iterator it = chain.begin(); it != chain.end(); it++) { names += " " + (*it)->GetName(); }
+		for (vector<TraceAnalyzer *>::iterator it = deferredChains[i].begin(); it != deferredChains[i].end(); it++) { names += " " + (*it)->GetName() + "*"; }
+		summary[type + ":" + subtype] = names;
+	}
+	
+	if (vecAnalyzer.empty()) { return; }
+	std::cout << "DetectorDriver: Trace analyzers for each detector type (* = run on demand)\n";
+	for (map<string, string>::iterator it = summary.begin(); it != summary.end(); it++) {
+		std::cout << "  " << it->first << " :" << (it->second.empty() ? " none" : it->second) << std::endl;
+	}
+}
+
+/// Print the wall clock time of each stage and fill one row of the stage latency spectrum per stage
+void DetectorDriver::PrintTiming(){
+	vector<pair<string, const StageTimer*> > stages;
+	stages.push_back(make_pair(string("Event"), &event_timer));
+	stages.push_back(make_pair(string("ThreshAndCal"), &cal_timer));
+	for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {
+		stages.push_back(make_pair((*it)->GetName() + "Analyzer", &(*it)->GetTimer()));
+	}
+	for (vector<EventProcessor *>::iterator it = vecProcess.begin(); it != vecProcess.end(); it++) {
+		stages.push_back(make_pair((*it)->GetName() + "Processor", &(*it)->GetTimer()));
+	}
+	if(use_root){ stages.push_back(make_pair(string("RootFill"), &fill_timer)); }
+	if(use_damm){ stages.push_back(make_pair(string("HisFlush"), &output_his->GetFlushTimer())); }
+
+	std::cout << "DetectorDriver: Stage timing (wall clock)\n";
+	StageTimer::PrintHeader();
+	for (size_t i = 0; i < stages.size(); i++) {
+		stages[i].second->Print(stages[i].first);
+		if(!use_damm || i >= S6){ continue; }
+		const unsigned long long *histogram = stages[i].second->GetHistogram();
+		for (unsigned int bin = 0; bin < STAGE_TIMER_BINS; bin++) {
+			if(histogram[bin] > 0){ plot(DD_STAGE_LATENCY, bin, i, std::min(histogram[bin], 0x7FFFFFFFULL)); }
+		}
+	}
+}
+
 // declare plots for all the event processors
 void DetectorDriver::DeclarePlots(MapFile& theMapFile){
 	DetectorLibrary* modChan = DetectorLibrary::get();
@@ -534,6 +888,7 @@ void DetectorDriver::DeclarePlots(MapFile& theMapFile){
 		DeclareHistogram2D(DD_RUNTIME_MSEC, SE, S7, "run time - ms");
 		DeclareHistogram1D(D_NUMBER_OF_EVENTS, S4, "event counter");
 		DeclareHistogram1D(D_HAS_TRACE, S7, "channels with traces");
+		histo.DeclareHistogram2D(DD_STAGE_LATENCY, S7, S6, "stage latency, 4 bins per octave", 2);
 	}
 
 	for (DetectorLibrary::size_type i = 0; i < maxChan; i++) {	 
@@ -579,27 +934,93 @@ bool DetectorDriver::SanityCheck(void) const
 */
 
 int DetectorDriver::ThreshAndCal(ChanEvent *chan, RawEvent& rawev)
-{   
+{
+	double energy;
+	bool dither;
+	if (!GetRawEnergy(chan, energy, dither)) { return 0; }
+	if (dither) { energy += RandomStream::Uniform(random_seed, (unsigned long long)chan->GetTime(), chan->GetID()); }
+
+	/*
+	  Set the calibrated energy for this channel
+	*/
+	chan->SetCalEnergy( calTable.Calibrate(chan->GetID(), energy) );
+	AddToSummaries(chan, rawev);
+
+	return 1;
+}
+
+/*!
+  \brief check threshold and calibrate a list of channels.
+
+  Same as ThreshAndCal() for a single channel, but the traces of all channels
+  are analyzed first and the raw energies are then calibrated in one pass
+  over the calibration table. Return the number of calibrated channels.
+*/
+int DetectorDriver::ThreshAndCal(vector<ChanEvent*> &chans, RawEvent& rawev)
+{
+	calChans.clear();
+	calIds.clear();
+	calRaw.clear();
+	calKeys.clear();
+	calDither.clear();
+
+	double energy;
+	bool dither;
+	for (vector<ChanEvent*>::iterator it = chans.begin(); it != chans.end(); it++) {
+		if (!GetRawEnergy(*it, energy, dither)) { continue; }
+		calChans.push_back(*it);
+		calIds.push_back((*it)->GetID());
+		calRaw.push_back(energy);
+		calKeys.push_back((unsigned long long)(*it)->GetTime());
+		calDither.push_back(dither ? 1.0 : 0.0);
+	}
+	if (calChans.empty()) { return 0; }
+
+	// Dither the integer energies. The numbers depend only on the seed, timestamp and channel id
+	calValues.resize(calChans.size());
+	RandomStream::Fill(random_seed, &calKeys[0], &calIds[0], &calValues[0], calChans.size());
+	for (size_t i = 0; i < calChans.size(); i++) { calRaw[i] += calDither[i] * calValues[i]; }
+
+	calTable.Calibrate(&calIds[0], &calRaw[0], &calValues[0], calChans.size());
+
+	for (size_t i = 0; i < calChans.size(); i++) {
+		calChans[i]->SetCalEnergy(calValues[i]);
+		AddToSummaries(calChans[i], rawev);
+	}
+
+	return calChans.size();
+}
+
+/*!
+  Analyze the trace of a channel, if it has one, and return the energy which
+  is to be calibrated. dither is set if the energy is an integer to which a
+  uniform random number must be added. Return false if the channel should be
+  ignored.
+*/
+bool DetectorDriver::GetRawEnergy(ChanEvent *chan, double &energy, bool &dither)
+{
 	// retrieve information about the channel
-	Identifier chanId = chan->GetChanID();
-	int id = chan->GetID();
-	string type = chanId.GetType();
-	string subtype = chanId.GetSubtype();
-	bool hasStartTag = chanId.HasTag("start");
+	const Identifier &chanId = chan->GetChanID();
+	const string &type = chanId.GetType();
 	Trace &trace = chan->GetTrace();
 
-	RandomPool* randoms = RandomPool::get();
+	energy = 0.;
+	dither = false;
 
-	double energy = 0.;
-
-	if (type == "ignore" || type == "") { return 0; }
+	if (type == "ignore" || type == "") { return false; }
 	/*
 	  If the channel has a trace get it, analyze it and set the energy.
 	*/
 	if ( !trace.empty() ) {
+		int id = chan->GetID();
+		const string &subtype = chanId.GetSubtype();
 		if(use_damm){ plot(D_HAS_TRACE, id); }
-		for (vector<TraceAnalyzer *>::iterator it = vecAnalyzer.begin(); it != vecAnalyzer.end(); it++) {	
+		trace.SetChannelId(id);
+		if ((unsigned int)id < analyzerChains.size()) {
+			const vector<TraceAnalyzer *> &chain = analyzerChains[id];
+			for (vector<TraceAnalyzer *>::const_iterator it = chain.begin(); it != chain.end(); it++) {	
 				(*it)->Analyze(trace, type, subtype);
+			}
 		}
 
 		if (trace.HasValue("filterEnergy") ) {	 
@@ -614,39 +1035,45 @@ int DetectorDriver::ThreshAndCal(ChanEvent *chan, RawEvent& rawev)
 			chan->SetEnergy(energy);
 		} 
 		else if (!trace.HasValue("filterEnergy")) {
-			energy = chan->GetEnergy() + randoms->Get();
+			energy = chan->GetEnergy();
+			dither = true;
 		}
-		if (trace.HasValue("phase") ) {
-			double phase = trace.GetValue("phase");
-			chan->SetHighResTime( phase * pixie::adcClockInSeconds + chan->GetTrigTime() * pixie::filterClockInSeconds);
+		
+		// The remaining analyzers only run if a processor asks for their results
+		if ((unsigned int)id < deferredChains.size()) {
+			trace.SetPendingAnalysis(&deferredChains[id], type, subtype);
 		}
 	} 
 	else {
 		// otherwise, use the Pixie on-board calculated energy
 		// add a random number to convert an integer value to a 
 		//   uniformly distributed floating point
-		energy = chan->GetEnergy() + randoms->Get();
+		energy = chan->GetEnergy();
+		dither = true;
 	}
-	/*
-	  Set the calibrated energy for this channel
-	*/
-	chan->SetCalEnergy( cal[id].Calibrate(energy) );
 
-	/*
-	  update the detector summary
-	*/
+	return true;
+}
+
+/*!
+  Update the detector summaries with a calibrated channel
+*/
+void DetectorDriver::AddToSummaries(ChanEvent *chan, RawEvent& rawev)
+{
+	const Identifier &chanId = chan->GetChanID();
+	const string &type = chanId.GetType();
+	const string &subtype = chanId.GetSubtype();
+
 	rawev.GetSummary(type)->AddEvent(chan);
 	DetectorSummary *summary;
 	
 	summary = rawev.GetSummary(type + ':' + subtype, false);
 	if (summary != NULL){ summary->AddEvent(chan); }
 
-	if(hasStartTag) { 
+	if(chanId.HasTag("start")) { 
 		summary = rawev.GetSummary(type + ':' + subtype + ':' + "start", false);
 		if (summary != NULL){ summary->AddEvent(chan); }
 	}
-	
-	return 1;
 }
 
 /*!
@@ -841,6 +1268,9 @@ void DetectorDriver::ReadCal()
 			cout << endl;
 		}
 	}
+
+	// Compile the calibrations into the table used for each event
+	calTable.Compile(cal);
 }
 
 /*!
@@ -865,7 +1295,6 @@ double Calibration::Calibrate(double raw)
 	if(raw < thresh[0]) { return 0; } 
 	if(raw >= thresh[numCal]) { return thresh[numCal] - 1; }
 
-	double calVal = 0;
 	/*
 	  Begin threshold check and calibration, first
 	  loop over the number of calibrations
@@ -873,11 +1302,77 @@ double Calibration::Calibrate(double raw)
 	for(unsigned int a = 0; a < numCal; a++) {
 		//check to see if energy falls in this calibration range
 		if (raw >= thresh[a] && raw < thresh[a+1]) {
-			//loop over the polynomial order
-			for(unsigned int b = 0; b < polyOrder+1; b++) { calVal += pow(raw,(double)b) * val[a*(polyOrder+1) + b]; }
-			break;
+			//evaluate the polynomial using Horner's method
+			const float *coeff = &val[a*(polyOrder+1)];
+			double calVal = coeff[polyOrder];
+			for(unsigned int b = polyOrder; b > 0; b--) { calVal = calVal * raw + coeff[b-1]; }
+			return calVal;
 		}
 	}
 
-	return calVal;
+	return 0;
+}
+
+/*!
+  Copy the thresholds and coefficients of every channel into flat arrays
+*/
+void CalibrationTable::Compile(const vector<Calibration> &cal)
+{
+	entries.clear();
+	thresh.clear();
+	coeffs.clear();
+	entries.reserve(cal.size());
+
+	for(vector<Calibration>::const_iterator it = cal.begin(); it != cal.end(); it++) {
+		Entry entry;
+		entry.firstThresh = thresh.size();
+		entry.firstCoeff = coeffs.size();
+		entry.numCal = it->numCal;
+		entry.order = it->polyOrder;
+		entry.low = it->thresh[0];
+		entry.high = it->thresh[it->numCal];
+		entry.linear = (it->numCal == 1 && it->polyOrder <= 1);
+		entry.offset = it->val[0];
+		entry.slope = (it->polyOrder >= 1 ? it->val[1] : 0.0);
+
+		thresh.insert(thresh.end(), it->thresh.begin(), it->thresh.begin() + it->numCal + 1);
+		coeffs.insert(coeffs.end(), it->val.begin(), it->val.begin() + it->numCal*(it->polyOrder+1));
+
+		entries.push_back(entry);
+	}
+}
+
+/*!
+  Evaluate a multi range or higher order calibration. The raw value is
+  already known to lie between the lowest and highest thresholds.
+*/
+double CalibrationTable::calibrate(const Entry &entry, double raw) const
+{
+	const double *th = &thresh[entry.firstThresh];
+	for(unsigned int a = 0; a < entry.numCal; a++) {
+		if (raw >= th[a] && raw < th[a+1]) {
+			const double *coeff = &coeffs[entry.firstCoeff + a*(entry.order+1)];
+			double calVal = coeff[entry.order];
+			for(unsigned int b = entry.order; b > 0; b--) { calVal = calVal * raw + coeff[b-1]; }
+			return calVal;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+  Calibrate a list of raw values. Channels with a single linear calibration
+  are handled inline without a function call
+*/
+void CalibrationTable::Calibrate(const unsigned int *ids, const double *raw, double *calibrated, size_t num) const
+{
+	for(size_t i = 0; i < num; i++) {
+		const Entry &entry = entries[ids[i]];
+		double value = raw[i];
+		if (value < entry.low) { calibrated[i] = 0; }
+		else if (value >= entry.high) { calibrated[i] = entry.high - 1; }
+		else if (entry.linear) { calibrated[i] = entry.offset + entry.slope * value; }
+		else { calibrated[i] = calibrate(entry, value); }
+	}
 }
@@ -113,11 +113,6 @@ int DetectorLibrary::GetNextLocation(const string &type,
     }
 }
 
-DetectorLibrary::size_type DetectorLibrary::GetIndex(int mod, int chan) const
-{
-  return mod * pixie::numberOfChannels + chan;
-}
-
 bool DetectorLibrary::HasValue(int mod, int chan) const
 {
     return HasValue(GetIndex(mod,chan));
@@ -13,7 +13,6 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <numeric>
 
 #include <cstdlib>
@@ -30,7 +29,8 @@ using namespace dammIds::trace;
  * Set default values for time and energy
  */
 DoubleTraceAnalyzer::DoubleTraceAnalyzer() : 
-    TraceFilterer(doubletrace::OFFSET, doubletrace::RANGE)
+    TraceFilterer(doubletrace::OFFSET, doubletrace::RANGE),
+    tripleTraces("triple traces"), tooManyPulses("traces with too many pulses")
 {
     time2 = 0;
     energy2 = 0.;
@@ -40,7 +40,8 @@ DoubleTraceAnalyzer::DoubleTraceAnalyzer() :
 
 DoubleTraceAnalyzer::~DoubleTraceAnalyzer() 
 {
-    // do nothing
+    tripleTraces.PrintTotal("DoubleTraceAnalyzer");
+    tooManyPulses.PrintTotal("DoubleTraceAnalyzer");
 }
 
 void DoubleTraceAnalyzer::DeclarePlots()
@@ -68,6 +69,12 @@ void DoubleTraceAnalyzer::DeclarePlots()
 		       "interesting traces (3rd filter)");
 }
 
+/** Top and bottom (position sensitive) channels are not checked for pile-up */
+bool DoubleTraceAnalyzer::AppliesTo(const string &type, const string &subtype) const
+{
+    return (subtype != "top" && subtype != "bottom");
+}
+
 /**
  *   Detect a second crossing of the fast filter corresponding to a piled-up
  *     trace and deduce its energy
@@ -78,6 +85,7 @@ void DoubleTraceAnalyzer::Analyze(Trace &trace,
     if (subtype == "top" || subtype == "bottom")
 	return;
 
+    StartAnalyze();
     TraceFilterer::Analyze(trace, type, subtype);
     // class to see when the fast filter falls below threshold
     static binder2nd< less<Trace::value_type> > recrossesThreshold
@@ -90,10 +98,9 @@ void DoubleTraceAnalyzer::Analyze(Trace &trace,
 	Trace::iterator iThr = fastFilter.begin() + pulse.time;
 	Trace::iterator iHigh = fastFilter.end();
 
-	vector<PulseInfo> pulseVec;
-	// put the original pulse in the vector
-	pulseVec.push_back(pulse);
-	const size_t pulseLimit = 50; // maximum number of pulses to find
+	// put the original pulse in the list
+	pulses.Zero();
+	pulses.Add(pulse.time, pulse.energy);
 
 	while (iThr < iHigh) {
 	    // find the trailing edge (use rise samples?)
@@ -103,42 +110,40 @@ void DoubleTraceAnalyzer::Analyze(Trace &trace,
 	    advance(iThr, fastParms.GetRiseSamples());
 
 	    FindPulse(iThr, iHigh);
-	    if (pulse.isFound) {
-		pulseVec.push_back(pulse);
-		iThr = fastFilter.begin() + pulse.time;
-	    } else break;
-	    if (pulseVec.size() > pulseLimit) {
-		cout << "Too many pulses, limit = " << pulseLimit << ", breaking out." << endl;
+	    if (!pulse.isFound)
+		break;
+	    if (!pulses.Add(pulse.time, pulse.energy)) {
+		if (tooManyPulses.Count())
+		    cout << "Too many pulses, limit = " << TracePulses::maxPulses 
+			 << ", breaking out (" << tooManyPulses.GetCount() << " traces so far)" << endl;
 		EndAnalyze(); // update timing
 		return;
 	    }
+	    iThr = fastFilter.begin() + pulse.time;
 	} // while searching for multiple traces
 	
-	trace.SetValue("numPulses", (int)pulseVec.size());
+	trace.SetValue("numPulses", (int)pulses.num);
 
 	// now plot stuff
-	if ( pulseVec.size() > 1 ) {
+	if ( pulses.num > 1 ) {
 	    using namespace dammIds::trace;
 
 	    // fill the trace info
-	    // first pulse info is set in TraceFilterer
-	    for (Trace::size_type i=1; i < pulseVec.size(); i++) {
-		stringstream str;
-		// the first pulse in the vector is the SECOND pulse in the trace
-		str << "filterEnergy" << i+1;
-		trace.SetValue(str.str(), pulseVec[i].energy);
-		str.str(""); // clear the string
-		str << "filterTime" << i+1;
-		trace.SetValue(str.str(), (int)pulseVec[i].time);
-	    }
+	    // first pulse values are set in TraceFilterer
+	    trace.ClearPulses();
+	    for (unsigned int i=0; i < pulses.num; i++)
+		trace.AddPulse(pulses.time[i], pulses.energy[i]);
+	    trace.SetValue("filterEnergy2", pulses.energy[1]);
+	    trace.SetValue("filterTime2", pulses.time[1]);
 	    
 	    // plot the double pulse stuff
 	    trace.Plot(DD_DOUBLE_TRACE, numDoubleTraces);
-	    if (pulseVec.size() > 2) {
+	    if (pulses.num > 2) {
 		static int numTripleTraces = 0;
-		cout << "Found triple trace " << numTripleTraces 
-		     << ", num pulses = " << pulseVec.size()
-		     << ", sigma baseline = " << trace.GetValue("sigmaBaseline") << endl;
+		if (tripleTraces.Count())
+		    cout << "Found triple trace " << numTripleTraces 
+			 << ", num pulses = " << pulses.num
+			 << ", sigma baseline = " << trace.GetValue("sigmaBaseline") << endl;
 		trace.Plot(DD_TRIPLE_TRACE, numTripleTraces);
 		fastFilter.ScalePlot(DD_TRIPLE_TRACE_FILTER1, numTripleTraces, fastParms.GetRiseSamples());
 		energyFilter.ScalePlot(DD_TRIPLE_TRACE_FILTER2, numTripleTraces, energyParms.GetRiseSamples());
@@ -147,9 +152,9 @@ void DoubleTraceAnalyzer::Analyze(Trace &trace,
 		numTripleTraces++;
 	    }
 
-	    plot(D_ENERGY2, pulseVec[1].energy);
-	    plot(DD_ENERGY2__TDIFF, pulseVec[1].energy, pulseVec[1].time - pulseVec[0].time);
-	    plot(DD_ENERGY2__ENERGY1, pulseVec[1].energy, pulseVec[0].energy);
+	    plot(D_ENERGY2, pulses.energy[1]);
+	    plot(DD_ENERGY2__TDIFF, pulses.energy[1], pulses.time[1] - pulses.time[0]);
+	    plot(DD_ENERGY2__ENERGY1, pulses.energy[1], pulses.energy[0]);
 
 	    numDoubleTraces++;
 	} // if found double trace
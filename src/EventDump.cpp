@@ -0,0 +1,368 @@
+/** \file EventDump.cpp
+ * \brief Columnar dump of built events for fast re-analysis
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "PixieEvent.hpp"
+
+#include "EventDump.hpp"
+#include "RawEvent.hpp"
+
+#define EVENT_DUMP_MAGIC "PXDUMP"
+#define EVENT_DUMP_CHUNK_MAGIC 0x4B4E4843 // "CHNK"
+
+// Return the number of padding bytes needed to align size_ to 8 bytes
+static size_t pad8(size_t size_){ return (8 - (size_ % 8)) % 8; }
+
+// Return the size of the columns of a chunk in bytes (including padding)
+static size_t chunk_size(unsigned int nevent_, unsigned int nchan_, bool traces_){
+	size_t size = 2*sizeof(double)*nchan_;
+	if(traces_){ size += sizeof(unsigned long long)*(nchan_ + 1); }
+	size += sizeof(unsigned int)*(nevent_ + 1) + (5 + EVENT_DUMP_QDCS)*sizeof(unsigned int)*nchan_;
+	return size + pad8(size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EventDumpView
+///////////////////////////////////////////////////////////////////////////////
+
+PixieEvent *EventDumpView::GetPixieEvent(unsigned int index_) const {
+	PixieEvent *output = new PixieEvent();
+	output->modNum = id[index_] / 16;
+	output->chanNum = id[index_] % 16;
+	output->time = time[index_];
+	output->eventTime = time[index_];
+	output->trigTime = trigTime[index_];
+	output->eventTimeLo = eventTimeLo[index_];
+	output->eventTimeHi = eventTimeHi[index_];
+	output->energy = energy[index_];
+	std::copy(qdc + EVENT_DUMP_QDCS*index_, qdc + EVENT_DUMP_QDCS*(index_ + 1), output->qdcValue);
+	output->pileupBit = (flags[index_] & EVENT_DUMP_PILEUP) != 0;
+	output->saturatedBit = (flags[index_] & EVENT_DUMP_SATURATED) != 0;
+	output->cfdForceTrig = (flags[index_] & EVENT_DUMP_CFD_FORCE) != 0;
+	output->cfdTrigSource = (flags[index_] & EVENT_DUMP_CFD_SOURCE) != 0;
+	if(trace){ output->adcTrace.assign(samples + trace[index_], samples + trace[index_+1]); }
+	return output;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EventDumpWriter
+///////////////////////////////////////////////////////////////////////////////
+
+EventDumpWriter::EventDumpWriter(const std::string &prefix_, bool write_traces_/*=false*/){
+	init = false;
+	num_events = 0;
+	num_samples = 0;
+	Open(prefix_, write_traces_);
+}
+
+bool EventDumpWriter::Open(const std::string &prefix_, bool write_traces_/*=false*/){
+	if(init){ return false; }
+
+	dump_file.open((prefix_ + ".pxd").c_str(), std::ios::binary);
+	if(!dump_file.good()){ return false; }
+
+	write_traces = write_traces_;
+	if(write_traces){
+		trace_file.open((prefix_ + ".pxt").c_str(), std::ios::binary);
+		if(!trace_file.good()){
+			dump_file.close();
+			return false;
+		}
+	}
+
+	EventDumpHeader header;
+	memset(header.magic, 0, 8);
+	memcpy(header.magic, EVENT_DUMP_MAGIC, strlen(EVENT_DUMP_MAGIC));
+	header.version = EVENT_DUMP_VERSION;
+	header.flags = (write_traces ? EVENT_DUMP_HAS_TRACES : 0);
+	dump_file.write((char*)&header, sizeof(EventDumpHeader));
+
+	num_events = 0;
+	num_samples = 0;
+	time.reserve(EVENT_DUMP_CHUNK);
+	energy.reserve(EVENT_DUMP_CHUNK);
+	id.reserve(EVENT_DUMP_CHUNK);
+	flags.reserve(EVENT_DUMP_CHUNK);
+	trigTime.reserve(EVENT_DUMP_CHUNK);
+	eventTimeLo.reserve(EVENT_DUMP_CHUNK);
+	eventTimeHi.reserve(EVENT_DUMP_CHUNK);
+	qdc.reserve(EVENT_DUMP_QDCS*EVENT_DUMP_CHUNK);
+	event.push_back(0);
+	if(write_traces){ trace.push_back(num_samples); }
+
+	return (init = true);
+}
+
+bool EventDumpWriter::Append(const RawEvent &event_){
+	if(!init){ return false; }
+
+	const std::vector<ChanEvent*> &chans = event_.GetEventList();
+	for(std::vector<ChanEvent*>::const_iterator it = chans.begin(); it != chans.end(); it++){
+		time.push_back((*it)->GetTime());
+		energy.push_back((*it)->GetEnergy());
+		id.push_back((*it)->GetID());
+
+		unsigned int chan_flags = 0;
+		if((*it)->IsPileup()){ chan_flags |= EVENT_DUMP_PILEUP; }
+		if((*it)->IsSaturated()){ chan_flags |= EVENT_DUMP_SATURATED; }
+		if((*it)->CfdForceTrig()){ chan_flags |= EVENT_DUMP_CFD_FORCE; }
+		if((*it)->GetCfdSourceBit()){ chan_flags |= EVENT_DUMP_CFD_SOURCE; }
+		flags.push_back(chan_flags);
+
+		trigTime.push_back((*it)->GetTrigTime());
+		eventTimeLo.push_back((*it)->GetEventTimeLo());
+		eventTimeHi.push_back((*it)->GetEventTimeHi());
+		for(int i = 0; i < EVENT_DUMP_QDCS; i++){ qdc.push_back((*it)->GetQdcValue(i)); }
+
+		if(write_traces){
+			const Trace &chan_trace = (*it)->GetTrace();
+			for(Trace::const_iterator iter = chan_trace.begin(); iter != chan_trace.end(); iter++){
+				samples.push_back((unsigned short)(*iter));
+			}
+			num_samples += chan_trace.size();
+			trace.push_back(num_samples);
+		}
+	}
+	event.push_back(time.size());
+	num_events++;
+
+	// Events are never split across chunks
+	if(time.size() >= EVENT_DUMP_CHUNK){ return flush(); }
+	return true;
+}
+
+bool EventDumpWriter::flush(){
+	if(event.size() <= 1){ return true; } // Nothing to write
+
+	EventDumpChunk chunk;
+	chunk.magic = EVENT_DUMP_CHUNK_MAGIC;
+	chunk.nevent = event.size() - 1;
+	chunk.nchan = time.size();
+	chunk.size = chunk_size(chunk.nevent, chunk.nchan, write_traces);
+	dump_file.write((char*)&chunk, sizeof(EventDumpChunk));
+
+	size_t written = 0;
+	if(chunk.nchan > 0){
+		dump_file.write((char*)&time[0], sizeof(double)*time.size());
+		dump_file.write((char*)&energy[0], sizeof(double)*energy.size());
+		written += sizeof(double)*(time.size() + energy.size());
+	}
+	if(write_traces){
+		dump_file.write((char*)&trace[0], sizeof(unsigned long long)*trace.size());
+		written += sizeof(unsigned long long)*trace.size();
+	}
+	dump_file.write((char*)&event[0], sizeof(unsigned int)*event.size());
+	written += sizeof(unsigned int)*event.size();
+	if(chunk.nchan > 0){
+		dump_file.write((char*)&id[0], sizeof(unsigned int)*id.size());
+		dump_file.write((char*)&flags[0], sizeof(unsigned int)*flags.size());
+		dump_file.write((char*)&trigTime[0], sizeof(unsigned int)*trigTime.size());
+		dump_file.write((char*)&eventTimeLo[0], sizeof(unsigned int)*eventTimeLo.size());
+		dump_file.write((char*)&eventTimeHi[0], sizeof(unsigned int)*eventTimeHi.size());
+		dump_file.write((char*)&qdc[0], sizeof(unsigned int)*qdc.size());
+		written += sizeof(unsigned int)*(id.size() + flags.size() + trigTime.size() + eventTimeLo.size() + eventTimeHi.size() + qdc.size());
+	}
+	const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	dump_file.write(padding, pad8(written));
+
+	if(write_traces && !samples.empty()){
+		trace_file.write((char*)&samples[0], sizeof(unsigned short)*samples.size());
+	}
+
+	time.clear();
+	energy.clear();
+	id.clear();
+	flags.clear();
+	trigTime.clear();
+	eventTimeLo.clear();
+	eventTimeHi.clear();
+	qdc.clear();
+	samples.clear();
+	event.clear();
+	event.push_back(0);
+	if(write_traces){
+		trace.clear();
+		trace.push_back(num_samples);
+	}
+
+	return dump_file.good();
+}
+
+void EventDumpWriter::Close(){
+	if(!init){ return; }
+	flush();
+	dump_file.close();
+	if(write_traces){ trace_file.close(); }
+	init = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// EventDumpReader
+///////////////////////////////////////////////////////////////////////////////
+
+EventDumpReader::EventDumpReader(){
+	dump_map = NULL; dump_size = 0;
+	trace_map = NULL; trace_size = 0;
+	has_traces = false;
+	init = false;
+	num_events = 0;
+	num_chans = 0;
+	last_chunk = 0;
+}
+
+const char *EventDumpReader::map_file(const std::string &fname_, size_t &size_){
+	int fd = open(fname_.c_str(), O_RDONLY);
+	if(fd < 0){ return NULL; }
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0){
+		close(fd);
+		return NULL;
+	}
+	size_ = info.st_size;
+
+	void *ptr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping remains valid after the descriptor is closed
+	if(ptr == MAP_FAILED){ return NULL; }
+
+	madvise(ptr, size_, MADV_SEQUENTIAL);
+	return (const char*)ptr;
+}
+
+bool EventDumpReader::Open(const std::string &fname_){
+	if(init){ return false; }
+
+	dump_map = map_file(fname_, dump_size);
+	if(!dump_map){
+		std::cout << " EventDumpReader: Error! Failed to map file '" << fname_ << "'\n";
+		return false;
+	}
+
+	const EventDumpHeader *header = (const EventDumpHeader*)dump_map;
+	if(dump_size < sizeof(EventDumpHeader) || strncmp(header->magic, EVENT_DUMP_MAGIC, strlen(EVENT_DUMP_MAGIC)) != 0){
+		std::cout << " EventDumpReader: Error! '" << fname_ << "' is not an event dump file\n";
+		Close();
+		return false;
+	}
+	if(header->version != EVENT_DUMP_VERSION){
+		std::cout << " EventDumpReader: Error! Unsupported dump version " << header->version << "\n";
+		Close();
+		return false;
+	}
+
+	// Map the trace file
+	has_traces = (header->flags & EVENT_DUMP_HAS_TRACES) != 0;
+	if(has_traces){
+		std::string trace_fname = fname_;
+		size_t index = trace_fname.find_last_of('.');
+		if(index != std::string::npos){ trace_fname = trace_fname.substr(0, index); }
+		trace_fname += ".pxt";
+		trace_map = map_file(trace_fname, trace_size);
+		if(!trace_map){
+			std::cout << " EventDumpReader: Warning! Failed to map trace file '" << trace_fname << "', traces will not be available\n";
+			has_traces = false;
+		}
+	}
+
+	// Build the chunk index
+	size_t offset = sizeof(EventDumpHeader);
+	bool header_traces = (header->flags & EVENT_DUMP_HAS_TRACES) != 0;
+	while(offset + sizeof(EventDumpChunk) <= dump_size){
+		const EventDumpChunk *chunk = (const EventDumpChunk*)(dump_map + offset);
+		if(chunk->magic != EVENT_DUMP_CHUNK_MAGIC || chunk->size != chunk_size(chunk->nevent, chunk->nchan, header_traces) ||
+		   offset + sizeof(EventDumpChunk) + chunk->size > dump_size){
+			std::cout << " EventDumpReader: Warning! Encountered bad chunk at byte " << offset << ", ignoring the rest of the file\n";
+			break;
+		}
+
+		ChunkInfo info;
+		info.ptr = dump_map + offset + sizeof(EventDumpChunk);
+		info.nevent = chunk->nevent;
+		info.nchan = chunk->nchan;
+		info.first_event = num_events;
+		chunks.push_back(info);
+
+		num_events += chunk->nevent;
+		num_chans += chunk->nchan;
+		offset += sizeof(EventDumpChunk) + chunk->size;
+	}
+
+	return (init = true);
+}
+
+bool EventDumpReader::GetEvent(unsigned long long index_, EventDumpView &view_){
+	if(!init || index_ >= num_events){ return false; }
+
+	// Events are usually read in order, so check the last chunk first
+	if(last_chunk >= chunks.size() || index_ < chunks[last_chunk].first_event ||
+	   index_ >= chunks[last_chunk].first_event + chunks[last_chunk].nevent){
+		size_t low = 0, high = chunks.size();
+		while(high - low > 1){
+			size_t mid = (low + high) / 2;
+			if(chunks[mid].first_event <= index_){ low = mid; }
+			else{ high = mid; }
+		}
+		last_chunk = low;
+	}
+
+	const ChunkInfo &chunk = chunks[last_chunk];
+	const char *ptr = chunk.ptr;
+	const double *time = (const double*)ptr; ptr += sizeof(double)*chunk.nchan;
+	const double *energy = (const double*)ptr; ptr += sizeof(double)*chunk.nchan;
+	const unsigned long long *trace = NULL;
+	if(((const EventDumpHeader*)dump_map)->flags & EVENT_DUMP_HAS_TRACES){
+		trace = (const unsigned long long*)ptr;
+		ptr += sizeof(unsigned long long)*(chunk.nchan + 1);
+	}
+	const unsigned int *event = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*(chunk.nevent + 1);
+	const unsigned int *id = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*chunk.nchan;
+	const unsigned int *flags = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*chunk.nchan;
+	const unsigned int *trigTime = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*chunk.nchan;
+	const unsigned int *eventTimeLo = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*chunk.nchan;
+	const unsigned int *eventTimeHi = (const unsigned int*)ptr; ptr += sizeof(unsigned int)*chunk.nchan;
+	const unsigned int *qdc = (const unsigned int*)ptr;
+
+	unsigned int local = index_ - chunk.first_event;
+	unsigned int first = event[local];
+	view_.size = event[local+1] - first;
+	view_.time = time + first;
+	view_.energy = energy + first;
+	view_.id = id + first;
+	view_.flags = flags + first;
+	view_.trigTime = trigTime + first;
+	view_.eventTimeLo = eventTimeLo + first;
+	view_.eventTimeHi = eventTimeHi + first;
+	view_.qdc = qdc + EVENT_DUMP_QDCS*first;
+	if(has_traces && trace[chunk.nchan] <= trace_size/sizeof(unsigned short)){
+		view_.trace = trace + first;
+		view_.samples = (const unsigned short*)trace_map;
+	}
+	else{
+		view_.trace = NULL;
+		view_.samples = NULL;
+	}
+
+	return true;
+}
+
+void EventDumpReader::Close(){
+	if(dump_map){ munmap((void*)dump_map, dump_size); }
+	if(trace_map){ munmap((void*)trace_map, trace_size); }
+	dump_map = NULL; dump_size = 0;
+	trace_map = NULL; trace_size = 0;
+	chunks.clear();
+	num_events = 0;
+	num_chans = 0;
+	last_chunk = 0;
+	has_traces = false;
+	init = false;
+}
@@ -32,10 +32,6 @@ void EventProcessor::_initialize(){
 	
 	// root TTree
 	local_branch = NULL; 
-	
-	// time of initialization
-	total_time = 0;
-	start_time = clock();
 }
 
 EventProcessor::EventProcessor() : histo(0, 0){
@@ -65,8 +61,8 @@ float EventProcessor::Status(unsigned int total_events)
 	float time_taken = 0.0;
 	if (initDone) {
 		// output the time usage and the number of valid events
-		time_taken = ((float)total_time)/CLOCKS_PER_SEC;
-		cout << " " << name << "Processor: Used " << time_taken << " seconds of CPU time\n";
+		time_taken = timer.GetSeconds();
+		cout << " " << name << "Processor: Used " << time_taken << " seconds\n";
 		if(total_events > 0){ cout << " " << name << "Processor: " << count << " Valid Events (" << 100.0*count/total_events << "%)\n"; }
 	}
 	return time_taken;
@@ -93,6 +89,16 @@ bool EventProcessor::HasEvent(void) const
 	return false;
 }
 
+/** Sum the multiplicity of the detectors of interest */
+unsigned int EventProcessor::GetMult(void) const
+{
+	unsigned int mult = 0;
+	for (map<string, const DetectorSummary*>::const_iterator it = sumMap.begin(); it != sumMap.end(); it++) {
+		mult += it->second->GetMult();
+	}
+	return mult;
+}
+
 /** Initialize the processor if the detectors that require it are used in the analysis
  */
 bool EventProcessor::Init(RawEvent& rawev) 
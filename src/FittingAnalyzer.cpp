@@ -15,6 +15,7 @@
 
 #include "DammPlotIds.hpp"
 #include "FittingAnalyzer.hpp"
+#include "WaveformAnalyzer.hpp"
 
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_errno.h>
@@ -78,29 +79,36 @@ bool FittingAnalyzer::InitDamm(){
 }
 
 //********** Analyze **********
+/** Only traces analyzed by the WaveformAnalyzer have the features used here */
+bool FittingAnalyzer::AppliesTo(const string &detType, const string &detSubtype) const
+{
+	return WaveformAnalyzer::IsWaveformType(detType);
+}
+
 void FittingAnalyzer::Analyze(Trace &trace, const string &detType, const string &detSubtype)
 {
 	StartAnalyze();
 	TraceAnalyzer::Analyze(trace, detType, detSubtype);
-	if(trace.HasValue("saturation") || trace.empty()) {
+	const TraceFeatures &features = trace.GetFeatures();
+	if(features.saturated || trace.empty()) {
 		if(use_damm){ plot(D_SAT,2); }
 		EndAnalyze();
 	 	return;
 	}
 	
-	const double sigmaBaseline = trace.GetValue("sigmaBaseline");
-	const double maxVal = trace.GetValue("maxval");
-	const double qdc = trace.GetValue("tqdc");
-	const unsigned int maxPos = (unsigned int)trace.GetValue("maxpos");
-	const vector<double> waveform = trace.GetWaveform();
+	const double sigmaBaseline = features.sigmaBaseline;
+	const double maxVal = features.maxVal;
+	const double qdc = features.qdc;
+	const unsigned int maxPos = features.maxPos;
+	const vector<double> &waveform = trace.waveform;
 	
-	if(waveform.size() == 0) {
+	if(!features.valid || waveform.size() == 0) {
 		EndAnalyze();
 		return;
 	}
 
 	static int counter = 0;
-	const double qdcToMax = trace.GetValue("qdcToMax");
+	const double qdcToMax = features.qdcToMax;
 	if(use_damm){
 		for(unsigned int i = 0; i < trace.size(); i++)
 			plot(DD_TRACES, i, counter, trace[i]);
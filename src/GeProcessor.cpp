@@ -62,18 +62,19 @@ double GeProcessor::WalkCorrection(double e) {
 }
 
 double GeProcessor::GammaBetaDtime(double gTime) {
-    PlaceOR* betas = dynamic_cast<PlaceOR*>(
-                        TreeCorrelator::get()->place("Beta"));
-    if (betas->info_.size() == 0)
+    PlaceOR* betas = dynamic_cast<PlaceOR*>(FindPlace("Beta"));
+    if (betas == NULL || betas->info_.size() == 0)
         return numeric_limits<double>::max();
 
-    vector<double> dtime;
-    for (deque<CorrEventData>::iterator it = betas->info_.begin();
-         it != betas->info_.end();
-         ++it) {
-        dtime.push_back((gTime - it->time) * pixie::clockInSeconds);
+    CompareTimes closer;
+    deque<CorrEventData>::iterator it = betas->info_.begin();
+    double dtime = (gTime - it->time) * pixie::clockInSeconds;
+    for (++it; it != betas->info_.end(); ++it) {
+        double dt = (gTime - it->time) * pixie::clockInSeconds;
+        if (closer(dt, dtime))
+            dtime = dt;
     }
-    return *min_element(dtime.begin(),dtime.end(), CompareTimes());
+    return dtime;
 }
 
 bool GeProcessor::GoodGammaBeta(double gTime, 
@@ -83,6 +84,12 @@ bool GeProcessor::GoodGammaBeta(double gTime,
     return true;
 }
 
+Place* GeProcessor::FindPlace(const string &name) {
+    map<string, Place*> &places = TreeCorrelator::get()->places_;
+    map<string, Place*>::iterator it = places.find(name);
+    return (it != places.end() ? it->second : NULL);
+}
+
 // useful function for symmetrically incrementing 2D plots
 void GeProcessor::symplot(int dammID, double bin1, double bin2)
 {
@@ -92,8 +99,9 @@ void GeProcessor::symplot(int dammID, double bin1, double bin2)
 
 using namespace dammIds::ge;
 
-GeProcessor::GeProcessor() : EventProcessor(OFFSET, RANGE), leafToClover() {
+GeProcessor::GeProcessor() : EventProcessor(OFFSET, RANGE), leafToClover(), numClovers(0) {
     name = "ge";
+    tablesBuilt = false;
     associatedTypes.insert("ge"); // associate with germanium detectors
 
     // previously used:
@@ -147,18 +155,13 @@ GeProcessor::GeProcessor() : EventProcessor(OFFSET, RANGE), leafToClover() {
 #endif
 }
 
-/** Declare plots including many for decay/implant/neutron gated analysis  */
-void GeProcessor::DeclarePlots(void) 
+/** Build the clover lookup tables from the map. This is needed by both
+ * InitDamm and Init, whichever is called first */
+void GeProcessor::BuildCloverTables(void)
 {
-    const int energyBins1  = SE;
-    const int energyBins2  = SC;
-    const int timeBins1    = S8;
-    const int granTimeBins = SA;
-
-    using namespace dammIds::ge;
-
-    /** This was moved here from Init because the number of clovers is needed
-     * for plots declaration, however Init is called after DeclarePlots */
+    if (tablesBuilt)
+        return;
+    tablesBuilt = true;
 
     /* clover specific routine, determine the number of clover detector
        channels and divide by four to find the total number of clovers
@@ -169,11 +172,17 @@ void GeProcessor::DeclarePlots(void)
     // could set it now but we'll iterate through the locations to set this
     unsigned int cloverChans = 0;
 
+    // lookup tables indexed by location
+    if (!cloverLocations.empty())
+        leafToClover.assign(*cloverLocations.rbegin() + 1, 0);
     for ( set<int>::const_iterator it = cloverLocations.begin();
 	  it != cloverLocations.end(); it++) {
         leafToClover[*it] = int(cloverChans / 4); 
         cloverChans++;
     }
+    const set<int> &lowLocations = modChan->GetLocations("ge", "clover_low");
+    if (!lowLocations.empty())
+        lowByLocation.assign(*lowLocations.rbegin() + 1, NULL);
 
     if (cloverChans % chansPerClover != 0) {
         cout << " There does not appear to be the proper number of"
@@ -186,15 +195,15 @@ void GeProcessor::DeclarePlots(void)
         //print statement
         cout << "A total of " << cloverChans << " clover channels were detected: ";
         int lastClover = numeric_limits<int>::min();
-        for ( map<int, int>::const_iterator it = leafToClover.begin();
-            it != leafToClover.end(); it++ ) {
-            if (it->second != lastClover) {
-                lastClover = it->second;
+        for ( set<int>::const_iterator it = cloverLocations.begin();
+            it != cloverLocations.end(); it++ ) {
+            if (leafToClover[*it] != lastClover) {
+                lastClover = leafToClover[*it];
                 cout << endl << "  " << lastClover << " : ";
             } else {
                 cout << ", ";
             }
-                cout << setw(2) << it->first ;
+                cout << setw(2) << *it ;
         }
 
         if (numClovers > dammIds::ge::MAX_CLOVERS) {
@@ -208,6 +217,32 @@ void GeProcessor::DeclarePlots(void)
         vector< pair<double, double> > empty;
         addbackEvents_.push_back(empty);
     }
+}
+
+bool GeProcessor::Init(RawEvent &event)
+{
+    BuildCloverTables();
+    return EventProcessor::Init(event);
+}
+
+/** Declare plots including many for decay/implant/neutron gated analysis  */
+bool GeProcessor::InitDamm(void) 
+{
+    std::cout << " GeProcessor: Initializing the damm output\n";
+    if(use_damm){
+        std::cout << " GeProcessor: Warning! Damm output already initialized\n";
+        return false;
+    }
+
+    const int energyBins1  = SE;
+    const int energyBins2  = SC;
+    const int timeBins1    = S8;
+    const int granTimeBins = SA;
+
+    using namespace dammIds::ge;
+
+    // the number of clovers is needed for the plots
+    BuildCloverTables();
 
     DeclareHistogram1D(D_ENERGY                 , energyBins1, "Gamma singles");
     DeclareHistogram1D(betaGated::D_ENERGY      , energyBins1, "Beta gated gamma");
@@ -289,67 +324,85 @@ void GeProcessor::DeclarePlots(void)
     DeclareHistogramGranY(DD_ADD_ENERGY__TIMEX           , energyBins2, granTimeBins, "Addback E - Time", 2, timeResolution, "s");
     DeclareHistogramGranY(betaGated::DD_ENERGY__TIMEX    , energyBins2, granTimeBins, "Beta-gated E - Time", 2, timeResolution, "s");
     DeclareHistogramGranY(betaGated::DD_ADD_ENERGY__TIMEX, energyBins2, granTimeBins, "Beta-gated addback E - Time", 2, timeResolution, "s");
+
+    use_damm = true;
+    return true;
 }
 
 
+/** Everything is done in one pass over each list plus one sort by time:
+ *  high/low gain matching uses the lowByLocation table, and addback takes
+ *  the time-sorted events in order. */
 bool GeProcessor::PreProcess(RawEvent &event) {
-    if (!EventProcessor::PreProcess(event))
-        return false;
+    if(!initDone){ return (didProcess = false); }
+
+    // start the process timer
+    StartProcess();
 
     // Clear all events stored in vectors from previous event
     geEvents_.clear();
+    geClovers_.clear();
     for (unsigned i = 0; i < numClovers; ++i)
         addbackEvents_[i].clear();
     tas_.clear();
 
-    // makes a copy so we can remove (or rearrange) bad events 
-    //   based on poorly matched high-low gain energies
-    geEvents_ = sumMap["ge"]->GetList();
-    vector<ChanEvent*>::iterator geEnd = geEvents_.end();
-
     //   correspond properly to raw low gain energy
     const double lowRatio = 1.5, highRatio = 3.0;
     static const vector<ChanEvent*> &highEvents = event.GetSummary("ge:clover_high", true)->GetList();
     static const vector<ChanEvent*> &lowEvents  = event.GetSummary("ge:clover_low", true)->GetList();
 
+    // ge events other than the clover channels are all kept
+    const vector<ChanEvent*> &allEvents = sumMap["ge"]->GetList();
+    if (allEvents.size() > highEvents.size() + lowEvents.size()) {
+        for (vector<ChanEvent*>::const_iterator it = allEvents.begin();
+             it != allEvents.end(); it++) {
+            const string &subtype = (*it)->GetChanID().GetSubtype();
+            if (subtype != "clover_high" && subtype != "clover_low")
+                geEvents_.push_back(*it);
+        }
+    }
+
+    // the first low gain event of each location is the match for the high gain
+    for (vector<ChanEvent*>::const_iterator itLow = lowEvents.begin(); 
+	 itLow != lowEvents.end(); itLow++) {
+        int location = (*itLow)->GetChanID().GetLocation();
+        if (location >= 0 && (unsigned int)location < lowByLocation.size() &&
+            lowByLocation[location] == NULL)
+            lowByLocation[location] = *itLow;
+    }
+
     for (vector<ChanEvent*>::const_iterator itHigh = highEvents.begin();
 	 itHigh != highEvents.end(); itHigh++) {
         
         //Purge the cases where the high gain saturated.
-        if((*itHigh)->IsSaturated()) {
-            geEnd = remove(geEvents_.begin(), geEnd, *itHigh);
+        if((*itHigh)->IsSaturated())
             continue;
-        }
         
         // find the matching low gain event
         int location = (*itHigh)->GetChanID().GetLocation();
-        plot(D_ENERGY_HIGHGAIN, (*itHigh)->GetCalEnergy());
-        vector <ChanEvent*>::const_iterator itLow = lowEvents.begin();
-        for (; itLow != lowEvents.end(); itLow++) {
-            if ( (*itLow)->GetChanID().GetLocation() == location ) {
-                break;
-            }
-        }
-        if ( itLow != lowEvents.end() ) {
-            double ratio = (*itHigh)->GetEnergy() / (*itLow)->GetEnergy();
-            plot(DD_CLOVER_ENERGY_RATIO, location, ratio * 10.);
-            if (ratio < lowRatio || ratio > highRatio) {
-                // put these bad events at the end of the vector
-                geEnd = remove(geEvents_.begin(), geEnd, *itHigh);
-                geEnd = remove(geEvents_.begin(), geEnd, *itLow);
-            }
+        if (use_damm)
+            plot(D_ENERGY_HIGHGAIN, (*itHigh)->GetCalEnergy());
+        ChanEvent *low = NULL;
+        if (location >= 0 && (unsigned int)location < lowByLocation.size())
+            low = lowByLocation[location];
+        if (low != NULL) {
+            double ratio = (*itHigh)->GetEnergy() / low->GetEnergy();
+            if (use_damm)
+                plot(DD_CLOVER_ENERGY_RATIO, location, ratio * 10.);
+            // throw out badly matched events
+            if (ratio < lowRatio || ratio > highRatio)
+                continue;
         }
+        geEvents_.push_back(*itHigh);
     }
-    // Now throw out any remaining clover low-gain events (for now)
-    for ( vector<ChanEvent*>::const_iterator itLow = lowEvents.begin(); 
-	  itLow != lowEvents.end(); itLow++ ) {
-        geEnd = remove(geEvents_.begin(), geEnd, *itLow);
+    // the clover low-gain events are not used any further (for now)
+    for (vector<ChanEvent*>::const_iterator itLow = lowEvents.begin(); 
+	 itLow != lowEvents.end(); itLow++) {
+        int location = (*itLow)->GetChanID().GetLocation();
+        if (location >= 0 && (unsigned int)location < lowByLocation.size())
+            lowByLocation[location] = NULL;
     }
 
-    // this purges the bad events for good from this processor which "remove"
-    //   has moved to the end
-    geEvents_.erase(geEnd, geEvents_.end());
-
     /** NOTE we do permanents changes to events here
      *  Necessary in order to set corrected time for use in correlator
      */
@@ -361,6 +414,10 @@ bool GeProcessor::PreProcess(RawEvent &event) {
     }
     // now we sort the germanium events according to their corrected time
     sort(geEvents_.begin(), geEvents_.end(), CompareCorrectedTime);
+    for (vector<ChanEvent*>::iterator it = geEvents_.begin(); 
+	 it != geEvents_.end(); it++) {
+        geClovers_.push_back(CloverOf((*it)->GetChanID().GetLocation()));
+    }
 
     /** Here the addback spectra is constructed.
      *  addbackEvents_ is a vector for each clover 
@@ -373,11 +430,11 @@ bool GeProcessor::PreProcess(RawEvent &event) {
      */
     double refTime = -2.0 * detectors::subEventWindow; 
 
-    for (vector<ChanEvent*>::iterator it = geEvents_.begin(); it != geEvents_.end(); it++) {
-        ChanEvent *chan = *it;
+    for (unsigned int i = 0; i < geEvents_.size(); i++) {
+        ChanEvent *chan = geEvents_[i];
         double energy = chan->GetCalEnergy(); 
         double time = chan->GetCorrectedTime();
-        int clover = leafToClover[chan->GetChanID().GetLocation()];
+        unsigned int clover = geClovers_[i];
 
         /**
         * Do not take into account events with too low energy
@@ -386,77 +443,100 @@ bool GeProcessor::PreProcess(RawEvent &event) {
         if (energy < detectors::addbackEnergyCut)
             continue;
 
-        // entries in map are sorted by time
+        // events are sorted by time
         // if event time is outside of subEventWindow, we start new 
         //   events for all clovers and "tas"
         double dtime = abs(time - refTime) * pixie::clockInSeconds;
         if (dtime > detectors::subEventWindow) {
-            for (unsigned i = 0; i < numClovers; ++i) {
-                addbackEvents_[i].push_back(pair<double, double>());
+            for (unsigned c = 0; c < numClovers; ++c) {
+                addbackEvents_[c].push_back(pair<double, double>());
             }
             tas_.push_back(pair<double, double>());
         }
-        // Total addback energy
-        addbackEvents_[clover].back().first += energy;
-        // We store latest time only
-        addbackEvents_[clover].back().second   = time;
+        if (clover < numClovers) {
+            // Total addback energy
+            addbackEvents_[clover].back().first += energy;
+            // We store latest time only
+            addbackEvents_[clover].back().second   = time;
+        }
         tas_.back().first += energy;
         tas_.back().second   = time;
         refTime = time;
     }
 
-    return true;
+    // there is no root output
+    EndProcess();
+    return false;
 } 
 
+/** The gamma-beta time of each gamma and addback event is found once, and
+ *  only gammas above threshold enter the gamma-gamma loops. */
 bool GeProcessor::Process(RawEvent &event) {
     using namespace dammIds::ge;
 
-    if (!EventProcessor::Process(event))
-        return false;
+    // everything below is histogramming
+    if(!initDone || !use_damm){ return (didProcess = false); }
+
+    // start the process timer
+    StartProcess();
 
     // tapeMove is true if the tape is moving
-    bool tapeMove = TreeCorrelator::get()->place("TapeMove")->status();
+    Place *tape = FindPlace("TapeMove");
+    bool tapeMove = (tape != NULL && tape->status());
 
     // If the tape is moving there is no need of analyzing events
     // as they must belong to background
-    if (tapeMove)
-        return true;
+    if (tapeMove) {
+        EndProcess();
+        return (didProcess = false);
+    }
 
     // beamOn is true for beam on and false for beam off
-    bool beamOn =  TreeCorrelator::get()->place("Beam")->status();
-
-    bool hasBeta = TreeCorrelator::get()->place("Beta")->status();
-    bool hasBeta0 = TreeCorrelator::get()->place("scint_beta_0")->status();
-    bool hasBeta1 = TreeCorrelator::get()->place("scint_beta_1")->status();
+    Place *beam = FindPlace("Beam");
+    bool beamOn = (beam != NULL && beam->status());
+
+    Place *beta = FindPlace("Beta");
+    Place *beta0 = FindPlace("scint_beta_0");
+    Place *beta1 = FindPlace("scint_beta_1");
+    bool hasBeta = (beta != NULL && beta->status());
+    bool hasBeta0 = (beta0 != NULL && beta0->status());
+    bool hasBeta1 = (beta1 != NULL && beta1->status());
     double betaEnergy = -1;
     if (hasBeta) {
         double betaEnergy0 = -1;
         if (hasBeta0) {
-            betaEnergy0 = TreeCorrelator::get()->place("scint_beta_0")->last().energy;
+            betaEnergy0 = beta0->last().energy;
         }
         double betaEnergy1 = -1;
         if (hasBeta1) {
-            betaEnergy1 = TreeCorrelator::get()->place("scint_beta_1")->last().energy;
+            betaEnergy1 = beta1->last().energy;
         }
         betaEnergy = max(betaEnergy0, betaEnergy1);
     }
     
     // Cycle time is measured from the begining of last beam on event
-    double cycleTime = TreeCorrelator::get()->place("Cycle")->last().time;
+    Place *cycle = FindPlace("Cycle");
+    double cycleTime = (cycle != NULL ? cycle->last().time : 0);
+
+    // Beam deque should be updated upon beam off so decay times for the
+    // early and late coincidences are measured from that point
+    double beamOffTime = (beam != NULL ? beam->last().time : 0);
 
     // Note that geEvents_ vector holds only good events (matched
     // low & high gain). See PreProcess
-    for (vector<ChanEvent*>::iterator it = geEvents_.begin(); 
-	 it != geEvents_.end(); it++) {
-        ChanEvent *chan = *it;
+    geAbove_.clear();
+    geBetaDtime_.assign(geEvents_.size(), numeric_limits<double>::max());
+    for (unsigned int i = 0; i < geEvents_.size(); i++) {
+        ChanEvent *chan = geEvents_[i];
         
         double gEnergy = chan->GetCalEnergy();	
         double gTime = chan->GetCorrectedTime();
         double decayTime = (gTime - cycleTime) 
                            * pixie::clockInSeconds;
-        int det = leafToClover[chan->GetChanID().GetLocation()];
+        int det = geClovers_[i];
         if (gEnergy < detectors::gammaThreshold) 
             continue;
+        geAbove_.push_back(i);
 
         plot(D_ENERGY, gEnergy);
         plot(D_ENERGY_CLOVERX + det, gEnergy);
@@ -464,6 +544,7 @@ bool GeProcessor::Process(RawEvent &event) {
 
         if (hasBeta) {
             double dtime = GammaBetaDtime(gTime);
+            geBetaDtime_[i] = dtime;
 
             double plotResolution = 10e-9;
             plot(betaGated::DD_TDIFF__GAMMA_ENERGY,
@@ -473,7 +554,7 @@ bool GeProcessor::Process(RawEvent &event) {
             plot(betaGated::DD_TDIFF__BETA_ENERGY, 
                     (int)(dtime / plotResolution + 100), betaEnergy); 
 
-            if (GoodGammaBeta(gTime)) {
+            if (dtime <= detectors::gammaBetaLimit) {
                 plot(betaGated::D_ENERGY, gEnergy);
                 plot(betaGated::D_ENERGY_CLOVERX + det, gEnergy);
                 granploty(betaGated::DD_ENERGY__TIMEX, gEnergy, decayTime, timeResolution);
@@ -486,20 +567,24 @@ bool GeProcessor::Process(RawEvent &event) {
                 }
             }
         }
-        
-        for (vector<ChanEvent*>::const_iterator it2 = it + 1;
-                it2 != geEvents_.end(); it2++) {
-            ChanEvent *chan2 = *it2;
+    }
 
-            double gEnergy2 = chan2->GetCalEnergy();            
-            int det2 = leafToClover[chan2->GetChanID().GetLocation()];
-            if (gEnergy2 < detectors::gammaThreshold) 
-                continue;
+    // gamma-gamma pairs, in time order
+    for (unsigned int a = 0; a < geAbove_.size(); a++) {
+        unsigned int i = geAbove_[a];
+        double gEnergy = geEvents_[i]->GetCalEnergy();
+        double gTime = geEvents_[i]->GetCorrectedTime();
+        int det = geClovers_[i];
+        bool betaGated = (hasBeta && geBetaDtime_[i] <= detectors::gammaBetaLimit);
+
+        for (unsigned int b = a + 1; b < geAbove_.size(); b++) {
+            unsigned int j = geAbove_[b];
+            double gEnergy2 = geEvents_[j]->GetCalEnergy();            
 
             /** Plot timediff between events in the same clover
              * to monitor addback subevent gates. */
-            if (det == det2) {
-                double gTime2 = chan2->GetCorrectedTime();
+            if (det == geClovers_[j]) {
+                double gTime2 = geEvents_[j]->GetCorrectedTime();
                 double plotResolution = 10e-9;
                 double dtime = (gTime2 - gTime) * pixie::clockInSeconds;
                 plot(DD_TDIFF__GAMMA_GAMMA_ENERGY, 
@@ -509,7 +594,7 @@ bool GeProcessor::Process(RawEvent &event) {
             }
 
             symplot(DD_ENERGY, gEnergy, gEnergy2);
-            if (hasBeta && GoodGammaBeta(gTime))
+            if (betaGated)
                 symplot(betaGated::DD_ENERGY, gEnergy, gEnergy2);            
         } // iteration over other gammas
     } 
@@ -528,19 +613,28 @@ bool GeProcessor::Process(RawEvent &event) {
     }
 
     // Plot addback spectra 
+    vector<double> betaDtime(numClovers, numeric_limits<double>::max());
     for (unsigned int ev = 0; ev < nEvents; ev++) {
+        if (hasBeta) {
+            for (unsigned int det = 0; det < numClovers; ++det) {
+                if (addbackEvents_[det][ev].first >= detectors::gammaThreshold)
+                    betaDtime[det] = GammaBetaDtime(addbackEvents_[det][ev].second);
+            }
+        }
+
         for (unsigned int det = 0; det < numClovers; ++det) {
             double gEnergy = addbackEvents_[det][ev].first;
             double gTime = addbackEvents_[det][ev].second;
             double decayTime = (gTime - cycleTime) * pixie::clockInSeconds;
             if (gEnergy < detectors::gammaThreshold)
                 continue;
+            bool betaGated = (hasBeta && betaDtime[det] <= detectors::gammaBetaLimit);
 
             plot(D_ADD_ENERGY, gEnergy);
             plot(D_ADD_ENERGY_CLOVERX + det, gEnergy);
             granploty(DD_ADD_ENERGY__TIMEX, gEnergy, decayTime, timeResolution);
 
-            if (hasBeta && GoodGammaBeta(gTime)) {
+            if (betaGated) {
                 plot(betaGated::D_ADD_ENERGY, gEnergy);
                 plot(betaGated::D_ADD_ENERGY_CLOVERX + det, gEnergy);
                 granploty(betaGated::DD_ADD_ENERGY__TIMEX, gEnergy, decayTime, timeResolution);
@@ -562,30 +656,26 @@ bool GeProcessor::Process(RawEvent &event) {
                 if (!beamOn) {
                     double decayCycleEarly = 0.5;
                     double decayCycleEnd   = 1.0;
-                    // Beam deque should be updated upon beam off so
-                    // measure time from that point
-                    double decayTime = (gTime - 
-                         TreeCorrelator::get()->place("Beam")->last().time) *
+                    double decayTime = (gTime - beamOffTime) *
                          pixie::clockInSeconds;
                     if (decayTime < decayCycleEarly) {
                         symplot(DD_ADD_ENERGY_EARLY, gEnergy, gEnergy2);
-                        if (hasBeta && GoodGammaBeta(gTime)) 
+                        if (betaGated) 
                             symplot(betaGated::DD_ADD_ENERGY_EARLY,
                                     gEnergy, gEnergy2);
                     } else if (decayTime < decayCycleEnd) {
                         symplot(DD_ADD_ENERGY_LATE, gEnergy, gEnergy2);
-                        if (hasBeta && GoodGammaBeta(gTime)) 
+                        if (betaGated) 
                             symplot(betaGated::DD_ADD_ENERGY_LATE,
                                     gEnergy, gEnergy2);
                     }
                 }
                 if (hasBeta) {
-                    if (GoodGammaBeta(gTime)) {
+                    if (betaGated) {
                         symplot(betaGated::DD_ADD_ENERGY, gEnergy, gEnergy2);
                     } else {
-                        if (GammaBetaDtime(gTime) > detectors::gammaBetaLimit)
-                            symplot(betaGated::DD_ADD_ENERGY_DELAYED,
-                                    gEnergy, gEnergy2);
+                        symplot(betaGated::DD_ADD_ENERGY_DELAYED,
+                                gEnergy, gEnergy2);
                     }
                 }
                     
@@ -616,11 +706,11 @@ bool GeProcessor::Process(RawEvent &event) {
                                 (e2 >= g2min && e2 <= g2max) ) {
                             if (det % 2 != det2 % 2) {
                                 plot(DD_ANGLE__GATEX, 1, ig);
-                                if (hasBeta && GoodGammaBeta(gTime))
+                                if (betaGated)
                                     plot(betaGated::DD_ANGLE__GATEX, 1, ig);
                             } else {
                             plot(DD_ANGLE__GATEX, 2, ig);
-                                if (hasBeta && GoodGammaBeta(gTime))
+                                if (betaGated)
                                     plot(betaGated::DD_ANGLE__GATEX, 2, ig);
                             }
                             for (unsigned det3 = det2 + 1;
@@ -629,7 +719,7 @@ bool GeProcessor::Process(RawEvent &event) {
                                 if (gEnergy3 < detectors::gammaThreshold)
                                     continue;
                                 plot(DD_ENERGY__GATEX, gEnergy3, ig);
-                                if (hasBeta && GoodGammaBeta(gTime))
+                                if (betaGated)
                                     plot(betaGated::DD_ENERGY__GATEX, gEnergy3, ig);
                             }
                         }
@@ -641,7 +731,8 @@ bool GeProcessor::Process(RawEvent &event) {
     } // iteration over events
 
     EndProcess(); // update the processing time
-    return true;
+    didProcess = true;
+    return false; // there is no root output
 }
 
 /**
@@ -3,10 +3,16 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <thread>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "TH1I.h"
 #include "TH2I.h"
 
@@ -102,20 +108,13 @@ void HisData::Initialize(size_t size_, bool use_int_){
 
 bool HisData::Read(std::ifstream *input_){
 	if(!init || !input_ || !input_->good()){ return false; }
-	unsigned int temp1;
-	unsigned short temp2;
-	for(size_t i = 0; i < size; i++){
-		if(use_int){ 
-			input_->read((char*)&temp1, 4); 
-			data[i] = temp1;
-		}
-		else{ 
-			input_->read((char*)&temp2, 2); 
-			data[i] = (unsigned int)temp2;
-		}
-		
+	if(use_int){ input_->read((char*)data, size*4); }
+	else{ // Read the whole block at once and widen the cells
+		std::vector<unsigned short> temp(size);
+		if(size > 0){ input_->read((char*)&temp[0], size*2); }
+		for(size_t i = 0; i < size; i++){ data[i] = temp[i]; }
 	}
-	return true;
+	return input_->good();
 }
 
 unsigned int HisData::Get(size_t index_){
@@ -296,6 +295,34 @@ void drr_entry::print_list(std::ofstream *file_){
 	*file_ << "  " << rstrip(title) << std::endl;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// struct HisView
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned int HisView::Get(size_t bin_) const {
+	if(use_int){
+		unsigned int value;
+		memcpy((char*)&value, data + bin_*4, 4);
+		return value;
+	}
+	return ((const unsigned short*)data)[bin_];
+}
+
+void HisView::Copy(size_t start_, size_t count_, unsigned int *output_) const {
+	if(use_int){ memcpy((char*)output_, data + start_*4, count_*4); }
+	else{
+		const unsigned short *cells = (const unsigned short*)data + start_;
+		for(size_t i = 0; i < count_; i++){ output_[i] = cells[i]; }
+	}
+}
+
+/// Clamp cells copied into the Int_t bin array of a root histogram to the largest Int_t
+static void clamp_to_int(unsigned int *cells_, size_t count_){
+	for(size_t i = 0; i < count_; i++){
+		if(cells_[i] > 0x7FFFFFFF){ cells_[i] = 0x7FFFFFFF; }
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class HisFile
 ///////////////////////////////////////////////////////////////////////////////
@@ -333,8 +360,38 @@ void HisFile::clear_drr_entries(){
 	current_entry = NULL;
 }
 
+bool HisFile::map_his(const std::string &fname_){
+	unmap_his();
+	
+	int fd = open(fname_.c_str(), O_RDONLY);
+	if(fd < 0){ return false; }
+	
+	struct stat file_stat;
+	if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0){
+		close(fd);
+		return false;
+	}
+	
+	void *ptr = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // The mapping stays valid after the file is closed
+	if(ptr == MAP_FAILED){ return false; }
+	
+	his_map = (const char*)ptr;
+	his_map_size = file_stat.st_size;
+	
+	return true;
+}
+
+void HisFile::unmap_his(){
+	if(his_map){ munmap((void*)his_map, his_map_size); }
+	his_map = NULL;
+	his_map_size = 0;
+}
+
 void HisFile::initialize(){
 	current_entry = NULL;
+	his_map = NULL;
+	his_map_size = 0;
 	err_flag = 0;
 	hists_processed = 0;
 	is_good = false;
@@ -354,6 +411,7 @@ HisFile::HisFile(const char *prefix_){
 HisFile::~HisFile(){
 	drr.close();
 	his.close();
+	unmap_his();
 
 	clear_drr_entries();
 }
@@ -368,6 +426,7 @@ int HisFile::GetError(bool verbose_/*=true*/){
 		else if(err_flag == 3){ std::cout << "  3: Failed to open the .his file. Check that the path is correct.\n"; }
 		else if(err_flag == 4){ std::cout << "  4: Either the .drr file and/or the .his file are not opened or are not of the correct format.\n"; }
 		else if(err_flag == 5){ std::cout << "  5: Cannot call GetNextHistogram because the last entry in the .drr file is already loaded.\n"; }
+		else if(err_flag == 6){ std::cout << "  6: The histogram extends past the end of the .his file.\n"; }
 		else if(err_flag == -1){ std::cout << "  -1: current_entry is uninitialized. Use GetHistogram, GetNextHistogram, or GetHistogramByID.\n"; }
 		else if(err_flag == -2){ std::cout << "  -2: Specified .his cell size is larger than that of an integer (4 bytes).\n"; }
 		else if(err_flag == -3){ std::cout << "  -3: GetHistogram returned 0. i.e. the specified histogram does not exist.\n"; }
@@ -519,28 +578,23 @@ TH1I* HisFile::GetTH1(int hist_/*=-1*/){
 	// Get the histogram from the file
 	if(hist_ != -1 && GetHistogram(hist_) == 0){			
 		err_flag = -3; 
-		return false; 
+		return NULL; 
 	}	
 	
 	// Check that this histogram has the correct dimension
 	if(current_entry->hisDim != 1){			
 		err_flag = -4; 
-		return false; 
+		return NULL; 
 	}
 	
-	std::stringstream stream;
-	stream << "d" << current_entry->hisID;
-
-	TH1I *hist = new TH1I(stream.str().c_str(), rstrip(current_entry->title).c_str(), 
-						  current_entry->total_bins, (double)current_entry->minc[0], (double)current_entry->maxc[0]+1);
-
-	// Fill the histogram bins
-	for(size_t x = 0; x < current_entry->total_bins; x++){
-		hist->SetBinContent(x+1, data[x]); 
-	}
-	hist->ResetStats(); // Update the histogram statistics to include new bin content
-
-	return hist;
+	// The loaded data has already been widened to 4 byte cells
+	HisView view;
+	view.entry = current_entry;
+	view.data = (const char*)data.GetData();
+	view.use_int = true;
+	view.size = data.GetSize();
+
+	return MakeTH1(view);
 }
 
 /// Get a pointer to a root TH2I
@@ -563,20 +617,65 @@ TH2I* HisFile::GetTH2(int hist_/*=-1*/){
 		return NULL; 
 	}
 	
+	// The loaded data has already been widened to 4 byte cells
+	HisView view;
+	view.entry = current_entry;
+	view.data = (const char*)data.GetData();
+	view.use_int = true;
+	view.size = data.GetSize();
+
+	return MakeTH2(view);
+}
+
+bool HisFile::GetView(size_t id_, HisView &view_) const {
+	if(!his_map || id_ >= drr_entries.size()){ return false; }
+	
+	drr_entry *entry = drr_entries.at(id_);
+	if(!entry->good || (size_t)entry->offset*2 + entry->total_size > his_map_size){ return false; }
+	
+	view_.entry = entry;
+	view_.data = his_map + (size_t)entry->offset*2;
+	view_.use_int = entry->use_int;
+	view_.size = entry->total_bins;
+	
+	return true;
+}
+
+TH1I* HisFile::MakeTH1(const HisView &view_){
+	if(!view_.entry || view_.entry->hisDim != 1){ return NULL; }
+
 	std::stringstream stream;
-	stream << "dd" << current_entry->hisID;
-
-	TH2I *hist = new TH2I(stream.str().c_str(), rstrip(current_entry->title).c_str(), 
-						  current_entry->scaled[0], (double)current_entry->minc[0], (double)current_entry->maxc[0]+1,
-						  current_entry->scaled[1], (double)current_entry->minc[1], (double)current_entry->maxc[1]+1);
-
-	// Fill the histogram bins
-	unsigned int bin = 0;
-	for(unsigned int i = 0; i < (unsigned int)current_entry->scaled[1]; i++){ // y
-		for(unsigned int j = 0; j < (unsigned int)current_entry->scaled[0]; j++){ // x
-			current_entry->get_bin(j, i, bin);
-			hist->SetBinContent(hist->GetBin(j+1, i+1), data[bin]);
-		}
+	stream << "d" << view_.entry->hisID;
+
+	TH1I *hist = new TH1I(stream.str().c_str(), rstrip(view_.entry->title).c_str(), 
+						  view_.size, (double)view_.entry->minc[0], (double)view_.entry->maxc[0]+1);
+
+	// Copy all cells directly into the bin array (bin 0 is the underflow bin)
+	unsigned int *array = (unsigned int*)hist->GetArray() + 1;
+	view_.Copy(0, view_.size, array);
+	if(view_.use_int){ clamp_to_int(array, view_.size); } // Full word cells may not fit in an Int_t
+	hist->ResetStats(); // Update the histogram statistics to include new bin content
+
+	return hist;
+}
+
+TH2I* HisFile::MakeTH2(const HisView &view_){
+	if(!view_.entry || view_.entry->hisDim != 2){ return NULL; }
+
+	std::stringstream stream;
+	stream << "dd" << view_.entry->hisID;
+
+	unsigned int xbins = view_.entry->scaled[0];
+	unsigned int ybins = view_.entry->scaled[1];
+	TH2I *hist = new TH2I(stream.str().c_str(), rstrip(view_.entry->title).c_str(), 
+						  xbins, (double)view_.entry->minc[0], (double)view_.entry->maxc[0]+1,
+						  ybins, (double)view_.entry->minc[1], (double)view_.entry->maxc[1]+1);
+
+	// Both layouts are row major, root rows have an extra underflow and overflow bin
+	unsigned int *array = (unsigned int*)hist->GetArray();
+	for(unsigned int y = 0; y < ybins; y++){
+		view_.Copy(y*xbins, xbins, array + (y+1)*(xbins+2) + 1);
+		if(view_.use_int){ clamp_to_int(array + (y+1)*(xbins+2) + 1, xbins); } // Full word cells may not fit in an Int_t
 	}
 	hist->ResetStats(); // Update the histogram statistics to include new bin content
 
@@ -605,12 +704,23 @@ size_t HisFile::GetHistogram(unsigned int hist_, bool no_copy_/*=false*/){
 	}
 
 	if(!no_copy_){
-		// Seek to the start of this histogram
-		his.seekg(current_entry->offset*2, std::ios::beg);
-
-		// Read the histogram data
 		data.Initialize(current_entry->total_bins, current_entry->use_int);
-		data.Read(&his);
+		
+		HisView view;
+		if(his_map){ // Copy the histogram data straight from the mapped file
+			if(!GetView(hist_, view)){
+				err_flag = 6;
+				return 0;
+			}
+			view.Copy(0, view.size, data.GetData());
+		}
+		else{
+			// Seek to the start of this histogram
+			his.seekg(current_entry->offset*2, std::ios::beg);
+
+			// Read the histogram data
+			data.Read(&his);
+		}
 	}
 
 	return current_entry->total_size;
@@ -689,7 +799,11 @@ bool HisFile::LoadDrr(const char* prefix_, bool open_his_/*=true*/){
 			err_flag = 3;
 			return false; 
 		}
+		
+		// Fall back on reading the stream if the file cannot be mapped
+		map_his(filename_prefix + ".his");
 	}
+	else{ unmap_his(); }
 
 	// Read in the drr header
 	drr.read((char*)&nHis, 4);
@@ -779,11 +893,13 @@ void OutputHisFile::flush(){
 	if(debug_mode){ std::cout << "debug: Flushing histogram entries to file.\n"; }
 
 	if(writable){ // Do the filling
+		flush_timer.Start();
+		std::vector<char> block;
 		for(std::vector<fill_queue*>::iterator iter = fills_waiting.begin(); iter != fills_waiting.end(); iter++){
 			if(!(*iter)->good){ continue; }
 			
 			current_entry = (*iter)->entry;
-			current_entry->good_counts++;
+			current_entry->good_counts += (*iter)->count;
 			
 			// Seek to the specified bin
 			ofile.seekg(current_entry->offset*2 + (*iter)->byte, std::ios::beg); // input offset
@@ -791,8 +907,28 @@ void OutputHisFile::flush(){
 			unsigned short sval = 0;
 			unsigned int ival = 0;
 			
+			// Overwrite a range of bins with a single read and write
+			if((*iter)->count > 1){
+				size_t cell_size = (current_entry->use_int ? 4 : 2);
+				block.resize((*iter)->count * cell_size);
+				ofile.read(&block[0], block.size());
+				for(size_t i = 0; i < block.size(); i += cell_size){
+					if(current_entry->use_int){
+						memcpy((char*)&ival, &block[i], 4);
+						ival += (*iter)->weight;
+						memcpy(&block[i], (char*)&ival, 4);
+					}
+					else{
+						memcpy((char*)&sval, &block[i], 2);
+						sval += (short)(*iter)->weight;
+						memcpy(&block[i], (char*)&sval, 2);
+					}
+				}
+				ofile.seekp(current_entry->offset*2 + (*iter)->byte, std::ios::beg); // output offset
+				ofile.write(&block[0], block.size());
+			}
 			// Overwrite the bin value
-			if(current_entry->use_int){
+			else if(current_entry->use_int){
 				// Get the original value of the bin
 				ofile.read((char*)&ival, 4);
 				ival += (*iter)->weight;
@@ -811,6 +947,8 @@ void OutputHisFile::flush(){
 				ofile.write((char*)&sval, 2);
 			}
 		}
+		flush_timer.Stop();
+		flush_timer.AddChannels(fills_waiting.size());
 	}
 	else if(debug_mode){ std::cout << "debug: Output file is not writable!\n"; }
 	
@@ -1012,6 +1150,27 @@ bool OutputHisFile::FillBin(unsigned int hisID_, unsigned int x_, unsigned int y
 	return false;
 }
 	
+bool OutputHisFile::FillRange(unsigned int hisID_, unsigned int x_, unsigned int y_, unsigned int count_, unsigned int weight_){
+	if(!writable || count_ == 0){ return false; }
+
+	drr_entry *temp_drr = find_drr_in_list(hisID_);
+	if(temp_drr){
+		unsigned int bin;
+		temp_drr->total_counts += count_;
+		if(!temp_drr->get_bin(x_, y_, bin) || bin >= temp_drr->total_bins){ return false; }
+		if(bin + count_ > temp_drr->total_bins){ count_ = temp_drr->total_bins - bin; }
+	
+		// Push the whole range into the queue as one fill
+		fill_queue *fill = new fill_queue(temp_drr, bin, weight_, count_);
+		fills_waiting.push_back(fill);
+
+		if(++flush_count >= flush_wait){ flush(); }
+		return true;
+	}
+	
+	return false;
+}
+	
 bool OutputHisFile::Zero(unsigned int hisID_){
 	if(!writable){ return false; }
 	
@@ -1070,3 +1229,202 @@ void OutputHisFile::Close(){
 	writable = false;
 	ofile.close();
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Histogram Summation
+///////////////////////////////////////////////////////////////////////////////
+
+/// Copy a file byte for byte. Return false if the input does not exist or the copy fails
+static bool copy_file(const std::string &input_, const std::string &output_){
+	std::ifstream input(input_.c_str(), std::ios::binary);
+	if(!input.good()){ return false; }
+	std::ofstream output(output_.c_str(), std::ios::binary);
+	if(!output.good()){ return false; }
+	output << input.rdbuf();
+	return output.good();
+}
+
+bool HisCombineOptions::Selected(unsigned int id_) const {
+	if(id_ranges.empty()){ return true; }
+	for(std::vector<std::pair<unsigned int, unsigned int> >::const_iterator iter = id_ranges.begin(); iter != id_ranges.end(); iter++){
+		if(id_ >= iter->first && id_ <= iter->second){ return true; }
+	}
+	return false;
+}
+
+/// Shared state of a thread combining histograms
+struct his_combine_job{
+	std::vector<HisFile*> *inputs; /// The input files, all with the same layout
+	const std::vector<double> *weights; /// The weight of each input
+	const HisCombineOptions *options;
+	char *output; /// The memory mapped output .his file
+	size_t first; /// Index of the first histogram handled by this thread
+	size_t overflows; /// Number of cells which did not fit, for this thread
+	bool good; /// False if a histogram could not be read
+};
+
+/// Combine every num_threads'th histogram, starting at job_->first
+static void combine_his(his_combine_job *job_){
+	std::vector<HisFile*> &inputs = *job_->inputs;
+	const std::vector<double> &weights = *job_->weights;
+	size_t step = (job_->options->num_threads > 0 ? job_->options->num_threads : 1);
+	std::vector<double> sums;
+	std::vector<unsigned int> cells;
+	HisView view;
+	
+	for(size_t i = job_->first; i < inputs.front()->GetNumHistograms(); i += step){
+		if(!inputs.front()->GetView(i, view)){
+			job_->good = false;
+			return;
+		}
+		char *output = job_->output + (size_t)view.entry->offset*2;
+		
+		// Unselected histograms are copied from the first input
+		if(!job_->options->Selected(view.entry->hisID)){
+			memcpy(output, view.data, view.entry->total_size);
+			continue;
+		}
+		else if(view.size == 0){ continue; }
+		
+		// Accumulate in double precision, which is exact for integer weights
+		sums.assign(view.size, 0.0);
+		cells.resize(view.size);
+		for(size_t j = 0; j < inputs.size(); j++){
+			if(!inputs.at(j)->GetView(i, view)){
+				job_->good = false;
+				return;
+			}
+			view.Copy(0, view.size, &cells[0]);
+			const double weight = weights.at(j);
+			for(size_t k = 0; k < view.size; k++){ sums[k] += weight * cells[k]; }
+		}
+		
+		// Convert back to the cell size of the histogram
+		const double max_value = (view.use_int ? 4294967295.0 : 65535.0);
+		for(size_t k = 0; k < view.size; k++){
+			double value = floor(sums[k] + 0.5);
+			if(value < 0.0 || value > max_value){
+				job_->overflows++;
+				if(job_->options->saturate){ value = (value < 0.0 ? 0.0 : max_value); }
+				else{
+					value = fmod(value, max_value + 1.0);
+					if(value < 0.0){ value += max_value + 1.0; }
+					if(value > max_value){ value = 0.0; }
+				}
+			}
+			cells[k] = (unsigned int)value;
+		}
+		
+		if(view.use_int){ memcpy(output, (char*)&cells[0], view.size*4); }
+		else{
+			unsigned short *short_cells = (unsigned short*)output;
+			for(size_t k = 0; k < view.size; k++){ short_cells[k] = (unsigned short)cells[k]; }
+		}
+	}
+}
+
+bool CombineHisFiles(const std::vector<std::string> &inputs_, const std::vector<double> &weights_, const std::string &output_, const HisCombineOptions &options_, size_t &overflows_){
+	overflows_ = 0;
+	if(inputs_.empty() || weights_.size() != inputs_.size()){ return false; }
+
+	// Map all inputs and check that their layouts are identical to the first
+	std::vector<HisFile*> inputs;
+	bool retval = true;
+	for(std::vector<std::string>::const_iterator iter = inputs_.begin(); iter != inputs_.end(); iter++){
+		HisFile *current = new HisFile();
+		inputs.push_back(current);
+		if(!current->LoadDrr(iter->c_str())){
+			std::cout << "CombineHisFiles: Failed to load '" << *iter << "'\n";
+			retval = false;
+			break;
+		}
+		if(current->GetNumHistograms() != inputs.front()->GetNumHistograms()){
+			std::cout << "CombineHisFiles: '" << *iter << ".drr' does not match '" << inputs_.front() << ".drr'\n";
+			retval = false;
+			break;
+		}
+		HisView view1, view2;
+		for(size_t i = 0; i < current->GetNumHistograms(); i++){
+			if(!inputs.front()->GetView(i, view1) || !current->GetView(i, view2)){
+				std::cout << "CombineHisFiles: Failed to map histogram " << i << " of '" << *iter << ".his'\n";
+				retval = false;
+				break;
+			}
+			if(view1.entry->hisID != view2.entry->hisID || view1.entry->offset != view2.entry->offset || view1.use_int != view2.use_int || view1.size != view2.size){
+				std::cout << "CombineHisFiles: Histogram " << view1.entry->hisID << " in '" << *iter << ".drr' does not match '" << inputs_.front() << ".drr'\n";
+				retval = false;
+				break;
+			}
+		}
+		if(!retval){ break; }
+	}
+
+	// Create the output .his file with the same size as the inputs and map it
+	size_t output_size = 0;
+	char *output = NULL;
+	if(retval){
+		std::ifstream first_his((inputs_.front() + ".his").c_str(), std::ios::binary | std::ios::ate);
+		output_size = (size_t)first_his.tellg();
+		first_his.close();
+		
+		int fd = open((output_ + ".his").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0 || ftruncate(fd, output_size) != 0){
+			std::cout << "CombineHisFiles: Failed to open '" << output_ << ".his' for writing\n";
+			retval = false;
+		}
+		else{
+			void *ptr = mmap(NULL, output_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(ptr == MAP_FAILED){
+				std::cout << "CombineHisFiles: Failed to map '" << output_ << ".his'\n";
+				retval = false;
+			}
+			else{ output = (char*)ptr; }
+		}
+		if(fd >= 0){ close(fd); }
+	}
+
+	// Combine the histograms, each thread handles an interleaved subset
+	if(retval){
+		size_t num_threads = (options_.num_threads > 0 ? options_.num_threads : 1);
+		std::vector<his_combine_job> jobs(num_threads);
+		std::vector<std::thread> threads;
+		for(size_t i = 0; i < num_threads; i++){
+			jobs[i].inputs = &inputs;
+			jobs[i].weights = &weights_;
+			jobs[i].options = &options_;
+			jobs[i].output = output;
+			jobs[i].first = i;
+			jobs[i].overflows = 0;
+			jobs[i].good = true;
+			if(i > 0){ threads.push_back(std::thread(combine_his, &jobs[i])); }
+		}
+		combine_his(&jobs[0]);
+		for(std::vector<std::thread>::iterator iter = threads.begin(); iter != threads.end(); iter++){ iter->join(); }
+		
+		for(std::vector<his_combine_job>::iterator iter = jobs.begin(); iter != jobs.end(); iter++){
+			if(!iter->good){ retval = false; }
+			overflows_ += iter->overflows;
+		}
+		if(!retval){ std::cout << "CombineHisFiles: Failed to read histogram data\n"; }
+	}
+	
+	if(output){ munmap(output, output_size); }
+	for(std::vector<HisFile*>::iterator iter = inputs.begin(); iter != inputs.end(); iter++){
+		delete (*iter);
+	}
+
+	if(!retval){ return false; }
+
+	// The layout is unchanged, so the .drr and .list files are simply copied
+	if(!copy_file(inputs_.front() + ".drr", output_ + ".drr")){
+		std::cout << "CombineHisFiles: Failed to write '" << output_ << ".drr'\n";
+		return false;
+	}
+	copy_file(inputs_.front() + ".list", output_ + ".list");
+
+	return true;
+}
+
+bool SumHisFiles(const std::vector<std::string> &inputs_, const std::string &output_, size_t &overflows_){
+	return CombineHisFiles(inputs_, std::vector<double>(inputs_.size(), 1.0), output_, HisCombineOptions(), overflows_);
+}
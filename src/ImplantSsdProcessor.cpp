@@ -9,7 +9,6 @@
 #include <cfloat> // for DBL_MAX
 #include <climits>
 #include <iostream>
-#include <sstream>
 #include <vector>
 
 #include "DammPlotIds.hpp"
@@ -23,7 +22,6 @@
 using std::cout;
 using std::endl;
 using std::min;
-using std::stringstream;
 
 /*! ecutoff for 108Xe experiment where each bin is roughly 4 keV
  *  ... implants deposit above 18 MeV
@@ -70,13 +68,19 @@ namespace dammIds {
     }
 }
 
-ImplantSsdProcessor::ImplantSsdProcessor() : EventProcessor(OFFSET, RANGE)
+ImplantSsdProcessor::ImplantSsdProcessor() : EventProcessor(OFFSET, RANGE),
+    tripleEvents("events flagged with three or more pulses")
 {
     name = "ImplantSsd";
 
     associatedTypes.insert("ssd");
 }
 
+ImplantSsdProcessor::~ImplantSsdProcessor()
+{
+    tripleEvents.PrintTotal("ImplantSsdProcessor");
+}
+
 void ImplantSsdProcessor::DeclarePlots(void)
 {
     using namespace dammIds::implantSsd;
@@ -346,7 +350,8 @@ bool ImplantSsdProcessor::Process(RawEvent &event)
     }
 
     Trace &trace = ch->GetTrace();
-    if (trace.HasValue("filterEnergy2")) {
+    const TracePulses &pulses = trace.GetPulses();
+    if (pulses.num > 1) {
 	info.pileUp = true;
     }
     
@@ -394,29 +399,19 @@ bool ImplantSsdProcessor::Process(RawEvent &event)
     if (info.pileUp) {
 	double trigTime = info.time;
 
-	info.energy = driver->cal.at(ch->GetID()).Calibrate(trace.GetValue("filterEnergy2"));
-	info.time   = trigTime + trace.GetValue("filterTime2") - trace.GetValue("filterTime");
-	
-	SetType(info);	
-	Correlate(corr, info, location);
-
-	int numPulses = trace.GetValue("numPulses");
-
-	if ( numPulses > 2 ) {
-	    corr.Flag(location, 1);
-	    cout << "Flagging triple event" << endl;
-	    for (int i=3; i <= numPulses; i++) {
-		stringstream str;
-		str << "filterEnergy" << i;
-		info.energy = driver->cal.at(ch->GetID()).Calibrate(trace.GetValue(str.str()));
-		str.str(""); // clear it
-		str << "filterTime" << i;
-		info.time   = trigTime + trace.GetValue(str.str()) - trace.GetValue("filterTime");
-
-		SetType(info);
-		Correlate(corr, info, location);
+	// each later pulse is correlated as a separate event
+	for (unsigned int i=1; i < pulses.num; i++) {
+	    if (i == 2) {
+		corr.Flag(location, 1);
+		if (tripleEvents.Count())
+		    cout << "Flagging triple event (" << tripleEvents.GetCount() << " so far)" << endl;
 	    }
-	}	
+	    info.energy = driver->calTable.Calibrate(ch->GetID(), pulses.energy[i]);
+	    info.time   = trigTime + pulses.time[i] - pulses.time[0];
+
+	    SetType(info);
+	    Correlate(corr, info, location);
+	}
 	// corr.Flag(location, 1);	                
 #ifdef VERBOSE
 	cout << "Flagging for pileup" << endl; 
@@ -110,7 +110,7 @@ bool LiquidProcessor::Process(RawEvent &event) {
     static int counter = 0;
     for(vector<ChanEvent*>::const_iterator itLiquid = liquidEvents.begin(); itLiquid != liquidEvents.end(); itLiquid++) {
         unsigned int loc = (*itLiquid)->GetChanID().GetLocation();
-        TimingInformation::TimingData liquid((*itLiquid));
+        const TimingInformation::TimingData &liquid = (*itLiquid)->GetTimingData();
 
         //Graph traces for the Liquid Scintillators
         if(liquid.discrimination == 0) {
@@ -140,7 +140,7 @@ bool LiquidProcessor::Process(RawEvent &event) {
 		            
 			for(vector<ChanEvent*>::iterator itStart = startEvents.begin(); itStart != startEvents.end(); itStart++){            
 				unsigned int startLoc = (*itStart)->GetChanID().GetLocation();
-				TimingInformation::TimingData start((*itStart));
+				const TimingInformation::TimingData &start = (*itStart)->GetTimingData();
 
 				if(start.dataValid) {
 					double tofOffset;
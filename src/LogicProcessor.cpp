@@ -175,13 +175,12 @@ bool LogicProcessor::TriggerProcessing(RawEvent &event) {
 		startTimeBin = max(0, startTimeBin - firstTimeBin);
 		timeBin -= firstTimeBin;
 
-		if(use_damm){ 
-			for (int bin=startTimeBin; bin < timeBin; bin++) {
-				int row = bin / plotSize;
-				int col = bin % plotSize;
-				plot(DD_RUNTIME_LOGIC, col, row, loc + 1); // add one since first logic location might be 0
-				plot(DD_RUNTIME_LOGIC + loc, col, row, 1);
-			}
+		if(use_damm && timeBin > startTimeBin){ 
+			// fill every bin the logic was high in one call, bins wrap onto the next row
+			int row = startTimeBin / plotSize;
+			int col = startTimeBin % plotSize;
+			plotRange(DD_RUNTIME_LOGIC, col, row, timeBin - startTimeBin, loc + 1); // add one since first logic location might be 0
+			plotRange(DD_RUNTIME_LOGIC + loc, col, row, timeBin - startTimeBin, 1);
 		}
     }
     
@@ -215,8 +214,8 @@ float LogicProcessor::Status(unsigned int total_events)
 	float time_taken = 0.0;
 	if (initDone) {
 		// output the time usage and the number of valid events
-		time_taken = ((float)total_time)/CLOCKS_PER_SEC;
-		cout << " " << name << "Processor: Used " << time_taken << " seconds of CPU time\n";
+		time_taken = timer.GetSeconds();
+		cout << " " << name << "Processor: Used " << time_taken << " seconds\n";
 		for(int i = 0; i < MAX_LOGIC; i++){
 			if(logic_counts[i] > 0){ cout << " " << name << "Processor: Location " << i << " received " << logic_counts[i] << " counts\n"; }
 		}
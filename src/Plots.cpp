@@ -172,6 +172,13 @@ bool Plots::Plot(int dammId, double val1, double val2, double val3, const char*
     return true;
 }
 
+bool Plots::PlotRange(int dammId, int x, int y, int count, int weight)
+{
+    if (!output_his || count <= 0 || x < 0 || y < 0)
+        return false;
+    return output_his->FillRange(dammId + offset_, x, y, count, weight);
+}
+
 bool Plots::Plot(const std::string &mne, double val1, double val2, double val3, const char* name)
 {    
     if (!Exists(mne))
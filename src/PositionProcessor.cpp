@@ -74,7 +74,7 @@ bool PositionProcessor::Init(RawEvent& rawev)
 {
     // Call the parent function to handle the standard stuff
     if (!EventProcessor::Init(rawev)) {
-        return false;
+        return (initDone = false);
     }
 
     DetectorLibrary* modChan = DetectorLibrary::get();
@@ -158,9 +158,15 @@ bool PositionProcessor::Init(RawEvent& rawev)
 /**
  *  Declare all the plots we plan on using (part of dammIds::qdc namespace)
  */
-void PositionProcessor::DeclarePlots() {
+bool PositionProcessor::InitDamm() {
     using namespace dammIds::position;
 
+    std::cout << " PositionProcessor: Initializing the damm output\n";
+    if(use_damm){
+        std::cout << " PositionProcessor: Warning! Damm output already initialized\n";
+        return false;
+    }
+
     const int qdcBins = S7;
     const int normBins = SA;
     const int infoBins = S3;
@@ -242,6 +248,9 @@ void PositionProcessor::DeclarePlots() {
 
     histo.DeclareHistogram1D(D_INFO_LOCX + LOC_SUM, infoBins, "ALL INFO");
     histo.DeclareHistogram2D(DD_POSITION, locationBins, positionBins, "Qdc Position", 1, "pos");
+
+    use_damm = true;
+    return true;
 }
 
 /**
@@ -249,8 +258,10 @@ void PositionProcessor::DeclarePlots() {
  *  Note QDC lengths are HARD-CODED at the moment for the plots and to determine the position
  */
 bool PositionProcessor::Process(RawEvent &event) {
-    if (!EventProcessor::Process(event))
-        return false;
+    if (!initDone || !use_damm) { return (didProcess = false); }
+
+    // start the process timer
+    StartProcess();
 
     static const vector<ChanEvent*> &sumEvents = 
 	event.GetSummary("ssd:sum", true)->GetList();
@@ -261,212 +272,250 @@ bool PositionProcessor::Process(RawEvent &event) {
     static const vector<ChanEvent*> &bottomEvents =
 	event.GetSummary("ssd:bottom", true)->GetList();
 
-    vector<ChanEvent *> allEvents;
-    // just add in the digisum events for now
-    allEvents.insert(allEvents.begin(), digisumEvents.begin(), digisumEvents.end());
-    allEvents.insert(allEvents.begin(), sumEvents.begin(), sumEvents.end());
-
-    for (vector<ChanEvent*>::const_iterator it = allEvents.begin();
-	     it != allEvents.end(); ++it) {
-         ChanEvent *sumchan   = *it;
+    // Bucket the edges by location so each sum only looks at its own strip
+    FillEdges(topEvents, topEdges);
+    FillEdges(bottomEvents, bottomEdges);
 
-        int location = sumchan->GetChanID().GetLocation();
+    // just add in the digisum events for now
+    for (vector<ChanEvent*>::const_iterator it = sumEvents.begin();
+	 it != sumEvents.end(); ++it) {
+        ProcessSum(*it);
+    }
+    for (vector<ChanEvent*>::const_iterator it = digisumEvents.begin();
+	 it != digisumEvents.end(); ++it) {
+        ProcessSum(*it);
+    }
 
-        // Don't waste our time with noise events
-        if ( (*it)->GetEnergy() < 10. || (*it)->GetEnergy() > 16374 ) {
-            using namespace dammIds::position;
+    EndProcess();
+    didProcess = true;
+    return false; // there is no root output
+}
 
-            plot(D_INFO_LOCX + location, INFO_NOISE);
-            plot(D_INFO_LOCX + LOC_SUM , INFO_NOISE);
-            continue;
-        }
+/**
+ *  Sort the edge events of one side into lists by location. The lists are
+ *  kept between events so their memory is reused.
+ */
+void PositionProcessor::FillEdges(const vector<ChanEvent*> &events,
+                                  vector< vector<ChanEvent*> > &edges) const
+{
+    edges.resize(numLocations);
+    for (int i = 0; i < numLocations; ++i)
+        edges[i].clear();
+    for (vector<ChanEvent*>::const_iterator it = events.begin();
+	 it != events.end(); ++it) {
+        int location = (*it)->GetChanID().GetLocation();
+        if (location >= 0 && location < numLocations)
+            edges[location].push_back(*it);
+    }
+}
 
-        const ChanEvent *top    = FindMatchingEdge(sumchan, topEvents.begin(), topEvents.end());
-        const ChanEvent *bottom = FindMatchingEdge(sumchan, bottomEvents.begin(), bottomEvents.end());
+/**
+ *  Position and QDC plots of a single sum (or digisum) channel
+ */
+void PositionProcessor::ProcessSum(ChanEvent *sumchan)
+{
+    using namespace dammIds::position;
 
+    int location = sumchan->GetChanID().GetLocation();
 
-        if (top == NULL || bottom == NULL) {
-            using namespace dammIds::position;
+    // Don't waste our time with noise events
+    if ( sumchan->GetEnergy() < 10. || sumchan->GetEnergy() > 16374 ) {
+        plot(D_INFO_LOCX + location, INFO_NOISE);
+        plot(D_INFO_LOCX + LOC_SUM , INFO_NOISE);
+        return;
+    }
 
-            if (top == NULL) {
-                // [6] -> Missing top
-                plot(D_INFO_LOCX + location, INFO_MISSING_TOP);
-                plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_TOP);
-            }
+    bool multipleTop = false, multipleBottom = false;
+    const ChanEvent *top    = NULL;
+    const ChanEvent *bottom = NULL;
+    if (location >= 0 && location < numLocations) {
+        top    = FindMatchingEdge(sumchan, topEdges[location], multipleTop);
+        bottom = FindMatchingEdge(sumchan, bottomEdges[location], multipleBottom);
+    }
 
-            if (bottom == NULL) {
-                // [5] -> Missing bottom
-                plot(D_INFO_LOCX + location, INFO_MISSING_BOTTOM);
-                plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_BOTTOM);
-            }
-            continue;
+    if (top == NULL || bottom == NULL) {
+        if (top == NULL) {
+            // [6] -> Missing top
+            plot(D_INFO_LOCX + location, INFO_MISSING_TOP);
+            plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_TOP);
         }
 
-        /* Make sure we get the same match going backwards to insure there is only one in the vector */
-        if ( FindMatchingEdge(sumchan, topEvents.rbegin(), topEvents.rend()) != top) {
-            using namespace dammIds::position;
-            // [4] -> Multiple top
-            plot(D_INFO_LOCX + location, INFO_MULTIPLE_TOP);
-            plot(D_INFO_LOCX + LOC_SUM, INFO_MULTIPLE_TOP);
-            continue;
-        }
-        if ( FindMatchingEdge(sumchan, bottomEvents.rbegin(), bottomEvents.rend()) != bottom) {
-            using namespace dammIds::position;
-            // [3] -> Multiple bottom
-            plot(D_INFO_LOCX + location, INFO_MULTIPLE_BOTTOM);
-            plot(D_INFO_LOCX + LOC_SUM, INFO_MULTIPLE_BOTTOM);
-            continue;
+        if (bottom == NULL) {
+            // [5] -> Missing bottom
+            plot(D_INFO_LOCX + location, INFO_MISSING_BOTTOM);
+            plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_BOTTOM);
         }
+        return;
+    }
 
-        using namespace dammIds::position;
-        
-        float topQdc[numQdcs];
-        float bottomQdc[numQdcs];
-        float topQdcTot = 0;
-        float bottomQdcTot = 0;
-        float position = NAN;
-        
-        topQdc[0] = top->GetQdcValue(0);
-        bottomQdc[0] = bottom->GetQdcValue(0);
-        if (bottomQdc[0] == U_DELIMITER || topQdc[0] == U_DELIMITER) {
-            // This happens naturally for traces which have double triggers
-            //   Onboard DSP does not write QDCs in this case
+    /* Make sure there is only one matching edge on each side */
+    if (multipleTop) {
+        // [4] -> Multiple top
+        plot(D_INFO_LOCX + location, INFO_MULTIPLE_TOP);
+        plot(D_INFO_LOCX + LOC_SUM, INFO_MULTIPLE_TOP);
+        return;
+    }
+    if (multipleBottom) {
+        // [3] -> Multiple bottom
+        plot(D_INFO_LOCX + location, INFO_MULTIPLE_BOTTOM);
+        plot(D_INFO_LOCX + LOC_SUM, INFO_MULTIPLE_BOTTOM);
+        return;
+    }
+
+    float topQdc[numQdcs];
+    float bottomQdc[numQdcs];
+    float topQdcTot = 0;
+    float bottomQdcTot = 0;
+    float position = NAN;
+
+    // prefix sums of the traces, filled only if a QDC has to be recreated
+    topPrefix.clear();
+    bottomPrefix.clear();
+
+    topQdc[0] = top->GetQdcValue(0);
+    bottomQdc[0] = bottom->GetQdcValue(0);
+    if (bottomQdc[0] == U_DELIMITER || topQdc[0] == U_DELIMITER) {
+        // This happens naturally for traces which have double triggers
+        //   Onboard DSP does not write QDCs in this case
 #ifdef VERBOSE
-            cout << "SSD strip edges are missing QDC information for location " << location << endl;
+        cout << "SSD strip edges are missing QDC information for location " << location << endl;
 #endif
-            if (topQdc[0] == U_DELIMITER) {
-                // [2] -> Missing top QDC
-                plot(D_INFO_LOCX + location, INFO_MISSING_TOP_QDC);
-                plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_TOP_QDC);
-                // Recreate qdc from trace
-                if ( !top->GetTrace().empty() ) {
-                    topQdc[0] = accumulate(top->GetTrace().begin(), top->GetTrace().begin() + qdcLen[0], 0);
-                } else {
-                    topQdc[0] = 0;
-                }
-            }
-            if (bottomQdc[0] == U_DELIMITER) {
-                // [1] -> Missing bottom QDC
-                plot(D_INFO_LOCX + location, INFO_MISSING_BOTTOM_QDC);
-                plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_BOTTOM_QDC);
-                // Recreate qdc from trace
-                if ( !bottom->GetTrace().empty() ) {
-                    bottomQdc[0] = accumulate(bottom->GetTrace().begin(), bottom->GetTrace().begin() + qdcLen[0], 0);
-                } else {
-                    bottomQdc[0] = 0;
-                }
-            }
-            if ( topQdc[0] == 0 || bottomQdc[0] == 0 ) {
-                continue;
-            }
+        if (topQdc[0] == U_DELIMITER) {
+            // [2] -> Missing top QDC
+            plot(D_INFO_LOCX + location, INFO_MISSING_TOP_QDC);
+            plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_TOP_QDC);
+            // Recreate qdc from trace
+            topQdc[0] = TraceQdc(top->GetTrace(), 0, topPrefix);
         }
-        // [0] -> good stuff
-        plot(D_INFO_LOCX + location, INFO_OKAY);
-        plot(D_INFO_LOCX + LOC_SUM, INFO_OKAY);
-
-
-        for (int i = 1; i < numQdcs; ++i) {		
-            if (top->GetQdcValue(i) == U_DELIMITER) {
-                // Recreate qdc from trace
-                topQdc[i] = accumulate(top->GetTrace().begin() + qdcPos[i-1],
-                top->GetTrace().begin() + qdcPos[i], 0);
-            } else {
-                topQdc[i] = top->GetQdcValue(i);
-            }
+        if (bottomQdc[0] == U_DELIMITER) {
+            // [1] -> Missing bottom QDC
+            plot(D_INFO_LOCX + location, INFO_MISSING_BOTTOM_QDC);
+            plot(D_INFO_LOCX + LOC_SUM, INFO_MISSING_BOTTOM_QDC);
+            // Recreate qdc from trace
+            bottomQdc[0] = TraceQdc(bottom->GetTrace(), 0, bottomPrefix);
+        }
+        if ( topQdc[0] == 0 || bottomQdc[0] == 0 ) {
+            return;
+        }
+    }
+    // [0] -> good stuff
+    plot(D_INFO_LOCX + location, INFO_OKAY);
+    plot(D_INFO_LOCX + LOC_SUM, INFO_OKAY);
 
-            topQdc[i] -= topQdc[0] * qdcLen[i] / qdcLen[0];
-            topQdcTot += topQdc[i];
-            topQdc[i] /= qdcLen[i];		
-            
-            if (bottom->GetQdcValue(i) == U_DELIMITER) {
-                // Recreate qdc from trace
-                bottomQdc[i] = accumulate(bottom->GetTrace().begin() + qdcPos[i-1],
-                                          bottom->GetTrace().begin() + qdcPos[i], 0);
-            } else {
-                bottomQdc[i] = bottom->GetQdcValue(i);
-            }
 
-            bottomQdc[i] -= bottomQdc[0] * qdcLen[i] / qdcLen[0];
-            bottomQdcTot += bottomQdc[i];
-            bottomQdc[i] /= qdcLen[i];
-            
-            plot(DD_QDCN__QDCN_LOCX + QDC_JUMP * i + location, topQdc[i] + 10, bottomQdc[i] + 10);
-            plot(DD_QDCN__QDCN_LOCX + QDC_JUMP * i + LOC_SUM, topQdc[i], bottomQdc[i]);
-            
-            float frac = topQdc[i] / (topQdc[i] + bottomQdc[i]) * 1000.; // per mil
-            
-            plot(D_QDCNORMN_LOCX + QDC_JUMP * i + location, frac);
-            plot(D_QDCNORMN_LOCX + QDC_JUMP * i + LOC_SUM, frac);
-            if (i == whichQdc) {
-                position = posScale * (frac - minNormQdc[location]) / 
-                    (maxNormQdc[location] - minNormQdc[location]);		
-                sumchan->GetTrace().InsertValue("position", position);
-                plot(DD_POSITION__ENERGY_LOCX + location, position, sumchan->GetCalEnergy());
-                plot(DD_POSITION__ENERGY_LOCX + LOC_SUM, position, sumchan->GetCalEnergy());
-            }
-            if (i == 6 && !sumchan->IsSaturated()) {
-                // compare the long qdc to the energy
-                int qdcSum = topQdc[i] + bottomQdc[i];
-                
-                // MAGIC NUMBERS HERE, move to qdc.txt
-                if (qdcSum < 1000 && sumchan->GetCalEnergy() > 15000) {
-                    sumchan->GetTrace().InsertValue("badqdc", 1);
-                } else if ( !isnan(position) ) {
-                    plot(DD_POSITION, location, position);
-                }
-            }
-        } // end loop over qdcs
-        // KM QDC - QDC correlations
-        double ratio[4] = {0};
-        for (int i = 1; i < 5; ++i) {
-                ratio[i - 1] = topQdc[i] / (bottomQdc[i] + topQdc[i]) * 1000.0;
+    for (int i = 1; i < numQdcs; ++i) {		
+        if (top->GetQdcValue(i) == U_DELIMITER) {
+            // Recreate qdc from trace
+            topQdc[i] = TraceQdc(top->GetTrace(), i, topPrefix);
+        } else {
+            topQdc[i] = top->GetQdcValue(i);
         }
 
-        plot(DD_QDCR2__QDCR1_LOCX + location, ratio[1], ratio[0]);
-        plot(DD_QDCR2__QDCR3_LOCX + location, ratio[1], ratio[2]);
-        plot(DD_QDCR2__QDCR4_LOCX + location, ratio[1], ratio[3]);
-
-        plot(DD_QDC1R__POS_LOCX + location, ratio[0], position * 10.0 + 200.0);
-        plot(DD_QDC2R__POS_LOCX + location, ratio[1], position * 10.0 + 200.0);
-        plot(DD_QDC3R__POS_LOCX + location, ratio[2], position * 10.0 + 200.0);
-        plot(DD_QDC4R__POS_LOCX + location, ratio[3], position * 10.0 + 200.0);
+        topQdc[i] -= topQdc[0] * qdcLen[i] / qdcLen[0];
+        topQdcTot += topQdc[i];
+        topQdc[i] /= qdcLen[i];		
+        
+        if (bottom->GetQdcValue(i) == U_DELIMITER) {
+            // Recreate qdc from trace
+            bottomQdc[i] = TraceQdc(bottom->GetTrace(), i, bottomPrefix);
+        } else {
+            bottomQdc[i] = bottom->GetQdcValue(i);
+        }
 
-        topQdcTot    /= totLen;
-        bottomQdcTot /= totLen;
+        bottomQdc[i] -= bottomQdc[0] * qdcLen[i] / qdcLen[0];
+        bottomQdcTot += bottomQdc[i];
+        bottomQdc[i] /= qdcLen[i];
+        
+        plot(DD_QDCN__QDCN_LOCX + QDC_JUMP * i + location, topQdc[i] + 10, bottomQdc[i] + 10);
+        plot(DD_QDCN__QDCN_LOCX + QDC_JUMP * i + LOC_SUM, topQdc[i], bottomQdc[i]);
+        
+        float frac = topQdc[i] / (topQdc[i] + bottomQdc[i]) * 1000.; // per mil
         
-        plot(DD_QDCTOT__QDCTOT_LOCX + location, topQdcTot, bottomQdcTot);
-        plot(DD_QDCTOT__QDCTOT_LOCX + LOC_SUM, topQdcTot, bottomQdcTot);
-    } // end iteration over sum events
+        plot(D_QDCNORMN_LOCX + QDC_JUMP * i + location, frac);
+        plot(D_QDCNORMN_LOCX + QDC_JUMP * i + LOC_SUM, frac);
+        if (i == whichQdc) {
+            position = posScale * (frac - minNormQdc[location]) / 
+                (maxNormQdc[location] - minNormQdc[location]);		
+            sumchan->GetTrace().InsertValue("position", position);
+            plot(DD_POSITION__ENERGY_LOCX + location, position, sumchan->GetCalEnergy());
+            plot(DD_POSITION__ENERGY_LOCX + LOC_SUM, position, sumchan->GetCalEnergy());
+        }
+        if (i == 6 && !sumchan->IsSaturated()) {
+            // compare the long qdc to the energy
+            int qdcSum = topQdc[i] + bottomQdc[i];
+            
+            // MAGIC NUMBERS HERE, move to qdc.txt
+            if (qdcSum < 1000 && sumchan->GetCalEnergy() > 15000) {
+                sumchan->GetTrace().InsertValue("badqdc", 1);
+            } else if ( !isnan(position) ) {
+                plot(DD_POSITION, location, position);
+            }
+        }
+    } // end loop over qdcs
+    // KM QDC - QDC correlations
+    double ratio[4] = {0};
+    for (int i = 1; i < 5; ++i) {
+            ratio[i - 1] = topQdc[i] / (bottomQdc[i] + topQdc[i]) * 1000.0;
+    }
 
-   // test
+    plot(DD_QDCR2__QDCR1_LOCX + location, ratio[1], ratio[0]);
+    plot(DD_QDCR2__QDCR3_LOCX + location, ratio[1], ratio[2]);
+    plot(DD_QDCR2__QDCR4_LOCX + location, ratio[1], ratio[3]);
 
-    EndProcess();
+    plot(DD_QDC1R__POS_LOCX + location, ratio[0], position * 10.0 + 200.0);
+    plot(DD_QDC2R__POS_LOCX + location, ratio[1], position * 10.0 + 200.0);
+    plot(DD_QDC3R__POS_LOCX + location, ratio[2], position * 10.0 + 200.0);
+    plot(DD_QDC4R__POS_LOCX + location, ratio[3], position * 10.0 + 200.0);
 
-    return true;
+    topQdcTot    /= totLen;
+    bottomQdcTot /= totLen;
+    
+    plot(DD_QDCTOT__QDCTOT_LOCX + location, topQdcTot, bottomQdcTot);
+    plot(DD_QDCTOT__QDCTOT_LOCX + LOC_SUM, topQdcTot, bottomQdcTot);
 }
 
-ChanEvent* PositionProcessor::FindMatchingEdge(ChanEvent *match,
-					  vector<ChanEvent*>::const_iterator begin,
-					  vector<ChanEvent*>::const_iterator end) const
+/**
+ *  Find the edge which is within matchingTimeCut of the sum. All edges
+ *  passed in are from the location of the sum
+ *  \param [out] multiple : true if more than one edge matches
+ *  \return the first matching edge, or NULL if there is none
+ */
+ChanEvent* PositionProcessor::FindMatchingEdge(const ChanEvent *match,
+					  const vector<ChanEvent*> &edges,
+					  bool &multiple) const
 {
-    for (;begin < end; ++begin) {
-        if ( (*begin)->GetChanID().GetLocation() == match->GetChanID().GetLocation() &&
-            abs( (*begin)->GetTime() - match->GetTime() ) < matchingTimeCut ) {
-            return *begin;
+    ChanEvent *found = NULL;
+    multiple = false;
+    for (vector<ChanEvent*>::const_iterator it = edges.begin();
+	 it != edges.end(); ++it) {
+        if ( abs( (*it)->GetTime() - match->GetTime() ) < matchingTimeCut ) {
+            if (found != NULL) {
+                multiple = true;
+                break;
+            }
+            found = *it;
         }
     }
-    return NULL;
+    return found;
 }
 
-ChanEvent* PositionProcessor::FindMatchingEdge(ChanEvent *match,
-					  vector<ChanEvent*>::const_reverse_iterator begin,
-					  vector<ChanEvent*>::const_reverse_iterator end) const
+/**
+ *  Recreate QDC i from the trace. The prefix sum of the trace is built on
+ *  the first call for an edge (prefix is empty), after which each QDC is the
+ *  difference of two of its entries. Samples past the end of the trace
+ *  count as zero.
+ */
+float PositionProcessor::TraceQdc(const Trace &trace, int i,
+                                  vector<int> &prefix) const
 {
-    for (;begin < end; ++begin) {
-        if ( (*begin)->GetChanID().GetLocation() == match->GetChanID().GetLocation() &&
-            abs( (*begin)->GetTime() - match->GetTime() ) < matchingTimeCut ) {
-            return *begin;
-        }
+    if (prefix.empty()) {
+        size_t len = min(trace.size(), (size_t)qdcPos[numQdcs - 1]);
+        prefix.resize(len + 1);
+        prefix[0] = 0;
+        partial_sum(trace.begin(), trace.begin() + len, prefix.begin() + 1);
     }
-    return NULL;
+    size_t last = prefix.size() - 1;
+    size_t low  = (i == 0 ? 0 : min((size_t)qdcPos[i - 1], last));
+    size_t high = min((size_t)qdcPos[i], last);
+    return prefix[high] - prefix[low];
 }
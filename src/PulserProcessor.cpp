@@ -91,7 +91,7 @@ bool PulserProcessor::RetrieveData(RawEvent &event)
 	string subType = (*itPulser)->GetChanID().GetSubtype();
 
 	IdentKey pulserKey(location, subType);
-	pulserMap.insert(make_pair(pulserKey, TimingData(*itPulser)));
+	pulserMap.insert(make_pair(pulserKey, (*itPulser)->GetTimingData()));
     }
     
     if(pulserMap.empty() || pulserMap.size()%2 != 0) {
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <vector>
 
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 
@@ -25,6 +27,10 @@
 #include "RawEvent.hpp"
 #include "DetectorDriver.hpp"
 #include "DetectorLibrary.hpp"
+#include "EventDump.hpp"
+#include "SpillIndex.hpp"
+#include "BatchDriver.hpp"
+#include "BenchDriver.hpp"
 #include "TreeCorrelator.hpp"
 #include "DammPlotIds.hpp"
 
@@ -115,6 +121,7 @@ void Scanner::ProcessRawEvent(){
 	
 	//calculate some of the parameters of interest
 	id = event->GetID();
+	event->SetChanID(&modChan->Lookup(id));
         /* retrieve the current event time and determine the time difference
         between the current and previous events.
         */
@@ -177,6 +184,8 @@ Scanner::Scanner(){
 
 Scanner::~Scanner(){
     Close(); // Close the Unpacker object.
+    if(!spill_fname.empty())
+	remove(spill_fname.c_str()); // Remove the temporary file of selected spills
 }
 
 /// Initialize the map file, the config file, the processor handler, and add all of the required processors.
@@ -191,6 +200,10 @@ bool Scanner::Initialize(std::string prefix_){
 /// Return the syntax string for this program.
 void Scanner::SyntaxStr(const char *name_, std::string prefix_){ 
     std::cout << prefix_ << "SYNTAX: " << std::string(name_) << " [input-fname] <options> <output-prefix>\n"; 
+    std::cout << prefix_ << "        " << std::string(name_) << " [input-fname] [--spills|--skip <first>-<last>|--time <start>-<stop>] <options> <output-prefix>\n"; 
+    std::cout << prefix_ << "        " << std::string(name_) << " [dump-fname.pxd] <output-prefix>\n"; 
+    std::cout << prefix_ << "        " << std::string(name_) << " --batch [-j N] <output-prefix> [input-fname ...]\n"; 
+    std::cout << prefix_ << "        " << std::string(name_) << " --bench [--spills N] [--events N] [--mult M] [--trace N] <output-prefix>\n"; 
 }       
 
 /** 
@@ -207,15 +220,69 @@ void Scanner::CmdHelp(std::string prefix_){
  */
 bool Scanner::SetArgs(std::deque<std::string> &args_, std::string &filename){
     std::string current_arg;
+    std::string spill_mode, spill_range;
     int count = 0;
     while(!args_.empty()){
 	current_arg = args_.front();
 	args_.pop_front();
+	if(current_arg == "--spills" || current_arg == "--skip" || current_arg == "--time"){ // Select part of the input file.
+	    if(args_.empty()){
+		std::cout << "Scanner: Error! " << current_arg << " requires a range\n";
+		return false;
+	    }
+	    spill_mode = current_arg;
+	    spill_range = args_.front();
+	    args_.pop_front();
+	    continue;
+	}
 	if(count == 0){ filename = current_arg; } // Set the input filename.
 	else if(count == 1){ output_fname = current_arg; } // Set the output filename prefix.
 	count++;
     }
     
+    // Write the selected spills to a new file and scan it instead of the input.
+    if(!spill_mode.empty() && !SelectSpills(filename, spill_mode, spill_range))
+	return false;
+    
+    // Create the detector driver now so that it writes to the requested output prefix.
+    DetectorDriver::get(output_fname);
+    
+    return true;
+}
+
+/// Write the spills selected by mode_ and range_ to a new file and replace filename_ with it.
+bool Scanner::SelectSpills(std::string &filename_, const std::string &mode_, const std::string &range_){
+    size_t index = range_.find('-', 1);
+    if(index == std::string::npos){
+	std::cout << "Scanner: Error! Invalid range '" << range_ << "'\n";
+	return false;
+    }
+    double first = strtod(range_.substr(0, index).c_str(), NULL);
+    double last = strtod(range_.substr(index+1).c_str(), NULL);
+    
+    SpillIndex spill_index;
+    if(!spill_index.Open(filename_))
+	return false;
+    
+    std::vector<SpillRange> ranges;
+    if(mode_ == "--spills")
+	ranges.push_back(SpillRange((size_t)first, (size_t)last));
+    else if(mode_ == "--skip")
+	ranges = spill_index.Exclude(SpillRange((size_t)first, (size_t)last));
+    else
+	ranges = spill_index.FindTimeRange(first, last);
+    
+    if(ranges.empty()){
+	std::cout << "Scanner: Error! No spills in '" << filename_ << "' match " << mode_ << " " << range_ << "\n";
+	return false;
+    }
+    
+    spill_fname = output_fname + "_spills." + spill_index.GetExtension();
+    std::cout << "Scanner: Writing selected spills of '" << filename_ << "' to '" << spill_fname << "'\n";
+    if(!spill_index.Write(spill_fname, ranges))
+	return false;
+    
+    filename_ = spill_fname;
     return true;
 }
 
@@ -227,7 +294,121 @@ bool Scanner::CommandControl(std::string cmd_, const std::vector<std::string> &a
     return false;
 }
 
+/// Process all events in a columnar event dump.
+bool Scanner::ReplayDump(const std::string &fname_){
+    EventDumpReader reader;
+    if(!reader.Open(fname_))
+	return false;
+    
+    DetectorDriver* driver = DetectorDriver::get();
+    DetectorLibrary* modChan = DetectorLibrary::get();
+    
+    cout << "Replaying " << reader.GetNumEvents() << " events (" << reader.GetNumChannels() << " channels) from '" << fname_ << "'" << endl;
+    if(!reader.HasTraces())
+	cout << "Event dump contains no traces" << endl;
+    
+    modChan->PrintUsedDetectors(rawev);
+    driver->Init(rawev);
+    
+    set<string> usedDetectors;
+    vector<ChanEvent*> chans;
+    EventDumpView view;
+    for(unsigned long long i = 0; i < reader.GetNumEvents(); i++){
+	reader.GetEvent(i, view);
+	
+	for(unsigned int j = 0; j < view.size; j++){
+	    if ((*modChan)[view.id[j]].GetType() == "ignore")
+		continue;
+	    ChanEvent *event = new ChanEvent(view.GetPixieEvent(j));
+	    event->SetChanID(&modChan->Lookup(view.id[j]));
+	    usedDetectors.insert((*modChan)[view.id[j]].GetType());
+	    rawev.AddChan(event);
+	    chans.push_back(event);
+	}
+	
+	if(rawev.Size() > 0)
+	    driver->ProcessEvent(rawev);
+	
+	// Zero the rawevent and clear all places in correlator (if resetable type)
+	rawev.Zero(usedDetectors);
+	usedDetectors.clear();
+	for (map<string, Place*>::iterator it =
+		TreeCorrelator::get()->places_.begin();
+	    it != TreeCorrelator::get()->places_.end(); ++it)
+	    if ((*it).second->resetable())
+		(*it).second->reset();
+	
+	for(vector<ChanEvent*>::iterator it = chans.begin(); it != chans.end(); it++)
+	    delete (*it);
+	chans.clear();
+    }
+    counter++;
+    
+    return true;
+}
+
+/// Process synthetic spills built in memory and time each call to ProcessRawEvent.
+bool Scanner::Bench(BenchDriver &bench_){
+    if(!bench_.Init())
+	return false;
+    
+    StageTimer scan_timer;
+    size_t num_chans;
+    while((num_chans = bench_.NextSpill(rawEvent)) > 0){
+	scan_timer.Start();
+	ProcessRawEvent();
+	scan_timer.Stop();
+	scan_timer.AddChannels(num_chans);
+    }
+    bench_.Print(scan_timer);
+    
+    return true;
+}
+
+/// Return true if fname_ is a columnar event dump.
+static bool IsDumpFile(const char *fname_){
+    size_t length = strlen(fname_);
+    return (length > 4 && strcmp(fname_ + length - 4, ".pxd") == 0);
+}
+
 int main(int argc, char *argv[]){
+    // Scan several files in parallel worker processes and merge the output.
+    if(argc > 1 && strcmp(argv[1], "--batch") == 0){
+	BatchDriver batch;
+	if(!batch.SetArgs(argc, argv)){
+	    batch.Help();
+	    return 1;
+	}
+	return (batch.Run() ? 0 : 1);
+    }
+    
+    // Time the analysis on synthetic events built in memory, without an input file.
+    if(argc > 1 && strcmp(argv[1], "--bench") == 0){
+	BenchDriver bench;
+	if(!bench.SetArgs(argc, argv)){
+	    bench.Help();
+	    return 1;
+	}
+	Scanner *scanner = new Scanner();
+	scanner->Initialize();
+	DetectorDriver::get(bench.GetOutputPrefix());
+	bool retval = scanner->Bench(bench);
+	DetectorDriver::get()->Delete();
+	return (retval ? 0 : 1);
+    }
+    
+    // Replay a columnar event dump without going through the unpacker.
+    if(argc > 1 && IsDumpFile(argv[1])){
+	Scanner *scanner = new Scanner();
+	scanner->Initialize();
+	DetectorDriver::SetReplay(true);
+	if(argc > 2)
+	    DetectorDriver::get(argv[2]);
+	bool retval = scanner->ReplayDump(argv[1]);
+	DetectorDriver::get()->Delete();
+	return (retval ? 0 : 1);
+    }
+    
     // Define a new unpacker object.
     Unpacker *scanner = (Unpacker*)(new Scanner());
     
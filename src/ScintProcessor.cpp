@@ -193,7 +193,7 @@ void ScintProcessor::LiquidAnalysis(RawEvent &event)
     for(vector<ChanEvent*>::const_iterator itLiquid = liquidEvents.begin();
 	itLiquid != liquidEvents.end(); itLiquid++) {
         unsigned int loc = (*itLiquid)->GetChanID().GetLocation();
-        TimingData liquid((*itLiquid));
+        const TimingData &liquid = (*itLiquid)->GetTimingData();
 
         //Graph traces for the Liquid Scintillators
         if(liquid.discrimination == 0) {
@@ -228,7 +228,7 @@ void ScintProcessor::LiquidAnalysis(RawEvent &event)
             for(vector<ChanEvent*>::iterator itStart = startEvents.begin(); 
             itStart != startEvents.end(); itStart++) { 
                 unsigned int startLoc = (*itStart)->GetChanID().GetLocation();
-                TimingData start((*itStart));
+                const TimingData &start = (*itStart)->GetTimingData();
                 int histLoc = loc + startLoc;
                 const int resMult = 2;
                 const int resOffset = 2000;
@@ -0,0 +1,443 @@
+/** \file SpillIndex.cpp
+ * \brief Index of the spills in an ldf or pld list mode file
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Globals.hpp"
+#include "SpillIndex.hpp"
+
+#define SPILL_INDEX_MAGIC "PXINDEX"
+
+#define LDF_BUFFER_WORDS 8194 // Words per ldf buffer, including the 2 word buffer header
+#define LDF_END_BUFFER 0xFFFFFFFF // Marks the unused end of an ldf buffer
+
+#define BUFFER_DATA 0x41544144 // "DATA"
+#define BUFFER_EOF 0x20464F45 // "EOF "
+
+#define END_OF_SPILL_VSN 9999 // Module number of the spill footer
+
+/// Header at the start of an index file
+struct SpillIndexHeader{
+	char magic[8]; /// "PXINDEX\0"
+	unsigned int version; /// SPILL_INDEX_VERSION
+	unsigned int format; /// 0 for ldf and 1 for pld files
+	unsigned long long file_size; /// Size of the data file when it was indexed
+	long long file_mtime; /// Modification time of the data file when it was indexed
+	unsigned long long header_size; /// Number of bytes before the first spill
+	unsigned long long num_spills; /// Number of SpillInfo entries following the header
+};
+
+bool SpillIndex::map_file(){
+	unmap_file();
+
+	int fd = open(fname.c_str(), O_RDONLY);
+	if(fd < 0){ return false; }
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0){
+		close(fd);
+		return false;
+	}
+	map_size = info.st_size;
+	file_size = info.st_size;
+	file_mtime = info.st_mtime;
+
+	void *ptr = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping remains valid after the descriptor is closed
+	if(ptr == MAP_FAILED){ return false; }
+
+	map = (const char*)ptr;
+	return true;
+}
+
+void SpillIndex::unmap_file(){
+	if(map){ munmap((void*)map, map_size); }
+	map = NULL;
+	map_size = 0;
+}
+
+void SpillIndex::scan_spill(const std::vector<unsigned int> &data_, SpillInfo &info_){
+	info_.nWords = data_.size();
+	info_.nEvents = 0;
+
+	// The spill is a sequence of module blocks of (length in words, module number, events)
+	size_t pos = 0;
+	while(pos + 2 <= data_.size()){
+		unsigned int nWords = data_[pos];
+		unsigned int vsn = data_[pos+1];
+		if(nWords < 2 || vsn == END_OF_SPILL_VSN){ break; }
+		if(pos + nWords > data_.size()){
+			info_.good = false;
+			break;
+		}
+
+		if(vsn < 1000){ // Pixie modules. Higher numbers are used for clock and scaler blocks
+			size_t evt = pos + 2;
+			while(evt + 3 <= pos + nWords){
+				unsigned int evtLength = (data_[evt] & 0x7FFE0000) >> 17;
+				if(evtLength < 3){ break; }
+				unsigned long long time = ((unsigned long long)(data_[evt+2] & 0xFFFF) << 32) | data_[evt+1];
+				if(info_.nEvents == 0 || time < info_.first_time){ info_.first_time = time; }
+				if(info_.nEvents == 0 || time > info_.last_time){ info_.last_time = time; }
+				info_.nEvents++;
+				evt += evtLength;
+			}
+		}
+		pos += nWords;
+	}
+}
+
+bool SpillIndex::walk_ldf_spill(const SpillInfo &info_, std::vector<unsigned int> *data_, std::vector<std::pair<const unsigned int*, unsigned int> > *chunks_){
+	const unsigned int *words = (const unsigned int*)map;
+	size_t num_buffers = map_size / (LDF_BUFFER_WORDS*4);
+	size_t buffer = info_.buffer;
+	size_t pos = info_.position;
+	unsigned int expected = 0;
+
+	while(buffer < num_buffers){
+		const unsigned int *buff = words + buffer*LDF_BUFFER_WORDS;
+		if(buff[0] != BUFFER_DATA){ // Skip non-data buffers
+			buffer++;
+			pos = 2;
+			continue;
+		}
+		if(pos + 3 > LDF_BUFFER_WORDS || buff[pos] == LDF_END_BUFFER){ // Continue in the next buffer
+			buffer++;
+			pos = 2;
+			continue;
+		}
+
+		unsigned int sizeB = buff[pos];
+		unsigned int total = buff[pos+1];
+		unsigned int current = buff[pos+2];
+		unsigned int nWords = sizeB / 4;
+		if(sizeB < 12 || sizeB % 4 != 0 || pos + nWords > LDF_BUFFER_WORDS || current != expected || current >= total){ return false; }
+
+		if(chunks_){ chunks_->push_back(std::make_pair(buff + pos, nWords)); }
+		if(current == total - 1){ return true; } // Spill footer
+		if(data_){ data_->insert(data_->end(), buff + pos + 3, buff + pos + nWords); }
+
+		pos += nWords;
+		expected++;
+	}
+
+	return false; // Reached the end of the file
+}
+
+bool SpillIndex::build_ldf(){
+	const unsigned int *words = (const unsigned int*)map;
+	size_t num_buffers = map_size / (LDF_BUFFER_WORDS*4);
+	header_size = 0;
+
+	std::vector<unsigned int> data;
+	for(size_t buffer = 0; buffer < num_buffers; buffer++){
+		const unsigned int *buff = words + buffer*LDF_BUFFER_WORDS;
+		if(buff[0] != BUFFER_DATA){ continue; }
+		if(header_size == 0){ header_size = buffer*LDF_BUFFER_WORDS*4; }
+
+		// Every chunk numbered zero starts a new spill
+		size_t pos = 2;
+		while(pos + 3 <= LDF_BUFFER_WORDS && buff[pos] != LDF_END_BUFFER){
+			unsigned int sizeB = buff[pos];
+			if(sizeB < 12 || sizeB % 4 != 0 || pos + sizeB/4 > LDF_BUFFER_WORDS){
+				std::cout << " SpillIndex: Warning! Malformed chunk in buffer " << buffer << " of '" << fname << "'\n";
+				break;
+			}
+			if(buff[pos+2] == 0){
+				SpillInfo info;
+				info.offset = (unsigned long long)buffer*LDF_BUFFER_WORDS*4;
+				info.buffer = buffer;
+				info.position = pos;
+
+				data.clear();
+				info.good = walk_ldf_spill(info, &data, NULL);
+				scan_spill(data, info);
+				spills.push_back(info);
+			}
+			pos += sizeB/4;
+		}
+	}
+
+	return true;
+}
+
+bool SpillIndex::build_pld(){
+	const unsigned int *words = (const unsigned int*)map;
+	size_t num_words = map_size / 4;
+
+	// Skip the header, which ends at the first DATA record
+	size_t pos = 0;
+	while(pos < num_words && words[pos] != BUFFER_DATA){ pos++; }
+	header_size = pos*4;
+
+	std::vector<unsigned int> data;
+	while(pos + 2 <= num_words && words[pos] == BUFFER_DATA){
+		SpillInfo info;
+		info.offset = (unsigned long long)pos*4;
+		unsigned int nWords = words[pos+1];
+		if(pos + 2 + nWords > num_words){
+			std::cout << " SpillIndex: Warning! Spill " << spills.size() << " of '" << fname << "' is truncated\n";
+			nWords = num_words - pos - 2;
+			info.good = false;
+		}
+
+		data.assign(words + pos + 2, words + pos + 2 + nWords);
+		scan_spill(data, info);
+		spills.push_back(info);
+
+		pos += 2 + nWords;
+	}
+	if(pos < num_words && words[pos] != BUFFER_EOF){
+		std::cout << " SpillIndex: Warning! Unexpected word 0x" << std::hex << words[pos] << std::dec << " at byte " << pos*4 << " of '" << fname << "'\n";
+	}
+
+	return true;
+}
+
+bool SpillIndex::load(const std::string &fname_){
+	std::ifstream file(fname_.c_str(), std::ios::binary);
+	if(!file.good()){ return false; }
+
+	SpillIndexHeader header;
+	file.read((char*)&header, sizeof(SpillIndexHeader));
+	if(!file.good() || strncmp(header.magic, SPILL_INDEX_MAGIC, 8) != 0 || header.version != SPILL_INDEX_VERSION){ return false; }
+
+	// Rebuild the index if the data file has changed
+	if(header.format != (unsigned int)format || header.file_size != file_size || header.file_mtime != file_mtime){ return false; }
+
+	header_size = header.header_size;
+	spills.resize(header.num_spills);
+	if(header.num_spills > 0){ file.read((char*)&spills[0], header.num_spills*sizeof(SpillInfo)); }
+	if(!file.good()){
+		spills.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool SpillIndex::save(const std::string &fname_){
+	std::ofstream file(fname_.c_str(), std::ios::binary);
+	if(!file.good()){ return false; }
+
+	SpillIndexHeader header;
+	memset((char*)&header, 0, sizeof(SpillIndexHeader));
+	strcpy(header.magic, SPILL_INDEX_MAGIC);
+	header.version = SPILL_INDEX_VERSION;
+	header.format = format;
+	header.file_size = file_size;
+	header.file_mtime = file_mtime;
+	header.header_size = header_size;
+	header.num_spills = spills.size();
+
+	file.write((char*)&header, sizeof(SpillIndexHeader));
+	if(!spills.empty()){ file.write((char*)&spills[0], spills.size()*sizeof(SpillInfo)); }
+
+	return file.good();
+}
+
+SpillIndex::SpillIndex(){
+	format = -1;
+	file_size = 0;
+	file_mtime = 0;
+	header_size = 0;
+	map = NULL;
+	map_size = 0;
+}
+
+bool SpillIndex::Open(const std::string &fname_, bool rebuild_/*=false*/){
+	fname = fname_;
+	spills.clear();
+
+	size_t index = fname.find_last_of('.');
+	extension = (index != std::string::npos ? fname.substr(index+1) : "");
+	if(extension == "ldf"){ format = 0; }
+	else if(extension == "pld"){ format = 1; }
+	else{
+		std::cout << " SpillIndex: Error! Unsupported file format '" << extension << "'\n";
+		return false;
+	}
+
+	if(!map_file()){
+		std::cout << " SpillIndex: Error! Failed to open '" << fname << "'\n";
+		return false;
+	}
+
+	std::string index_fname = fname + ".idx";
+	if(!rebuild_ && load(index_fname)){ return true; }
+
+	std::cout << " SpillIndex: Indexing '" << fname << "'\n";
+	if(!(format == 0 ? build_ldf() : build_pld())){ return false; }
+
+	if(!save(index_fname)){ std::cout << " SpillIndex: Warning! Failed to write '" << index_fname << "'\n"; }
+
+	return true;
+}
+
+unsigned long long SpillIndex::GetFirstTime(){
+	unsigned long long first_time = 0;
+	bool found = false;
+	for(std::vector<SpillInfo>::iterator iter = spills.begin(); iter != spills.end(); iter++){
+		if(iter->nEvents == 0){ continue; }
+		if(!found || iter->first_time < first_time){ first_time = iter->first_time; }
+		found = true;
+	}
+	return first_time;
+}
+
+std::vector<SpillRange> SpillIndex::FindTimeRange(double start_, double stop_){
+	std::vector<SpillRange> output;
+	double first_time = (double)GetFirstTime();
+
+	bool in_range = false;
+	for(size_t i = 0; i < spills.size(); i++){
+		const SpillInfo &info = spills.at(i);
+		bool overlaps = false;
+		if(info.nEvents > 0){
+			double spill_start = (info.first_time - first_time) * pixie::clockInSeconds;
+			double spill_stop = (info.last_time - first_time) * pixie::clockInSeconds;
+			overlaps = (spill_stop >= start_ && spill_start <= stop_);
+		}
+		if(overlaps && in_range){ output.back().second = i; }
+		else if(overlaps){ output.push_back(SpillRange(i, i)); }
+		in_range = overlaps;
+	}
+
+	return output;
+}
+
+std::vector<SpillRange> SpillIndex::Exclude(const SpillRange &skip_){
+	std::vector<SpillRange> output;
+	if(spills.empty()){ return output; }
+	if(skip_.first > 0){ output.push_back(SpillRange(0, (skip_.first < spills.size() ? skip_.first : spills.size()) - 1)); }
+	if(skip_.second + 1 < spills.size()){ output.push_back(SpillRange(skip_.second + 1, spills.size() - 1)); }
+	return output;
+}
+
+bool SpillIndex::Write(const std::string &output_, const std::vector<SpillRange> &ranges_){
+	if(!map){ return false; }
+
+	std::ofstream file(output_.c_str(), std::ios::binary);
+	if(!file.good()){
+		std::cout << " SpillIndex: Error! Failed to open '" << output_ << "' for writing\n";
+		return false;
+	}
+
+	// Keep the run information at the start of the file
+	file.write(map, header_size);
+
+	if(format == 0){
+		// Pack the chunks of each spill into new buffers. Each chunk already fits in a single buffer
+		std::vector<unsigned int> buffer(LDF_BUFFER_WORDS, LDF_END_BUFFER);
+		std::vector<std::pair<const unsigned int*, unsigned int> > chunks;
+		size_t pos = 2;
+		buffer[0] = BUFFER_DATA;
+		buffer[1] = LDF_BUFFER_WORDS - 2;
+		for(std::vector<SpillRange>::const_iterator range = ranges_.begin(); range != ranges_.end(); range++){
+			for(size_t i = range->first; i <= range->second && i < spills.size(); i++){
+				if(!spills.at(i).good){ continue; } // Leave out incomplete spills
+				chunks.clear();
+				walk_ldf_spill(spills.at(i), NULL, &chunks);
+				for(std::vector<std::pair<const unsigned int*, unsigned int> >::iterator chunk = chunks.begin(); chunk != chunks.end(); chunk++){
+					if(pos + chunk->second > LDF_BUFFER_WORDS){
+						file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+						std::fill(buffer.begin() + 2, buffer.end(), LDF_END_BUFFER);
+						pos = 2;
+					}
+					memcpy((char*)&buffer[pos], (const char*)chunk->first, chunk->second*4);
+					pos += chunk->second;
+				}
+			}
+		}
+		if(pos > 2){ file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4); }
+
+		// Finish with two end of file buffers
+		std::fill(buffer.begin(), buffer.end(), LDF_END_BUFFER);
+		buffer[0] = BUFFER_EOF;
+		buffer[1] = LDF_BUFFER_WORDS - 2;
+		file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+		file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+	}
+	else{
+		for(std::vector<SpillRange>::const_iterator range = ranges_.begin(); range != ranges_.end(); range++){
+			for(size_t i = range->first; i <= range->second && i < spills.size(); i++){
+				if(!spills.at(i).good){ continue; }
+				file.write(map + spills.at(i).offset, 8 + spills.at(i).nWords*4);
+			}
+		}
+		unsigned int eof = BUFFER_EOF;
+		file.write((char*)&eof, 4);
+	}
+
+	return file.good();
+}
+
+bool SpillIndex::Split(size_t num_, const std::string &prefix_, std::vector<std::string> &files_){
+	files_.clear();
+	if(spills.empty() || num_ == 0){ return false; }
+
+	unsigned long long total_words = 0;
+	for(std::vector<SpillInfo>::iterator iter = spills.begin(); iter != spills.end(); iter++){ total_words += iter->nWords; }
+
+	// Start a new piece whenever the current one reaches its share of the data
+	unsigned long long piece_words = total_words / num_ + 1;
+	unsigned long long current_words = 0;
+	size_t first = 0;
+	for(size_t i = 0; i < spills.size(); i++){
+		current_words += spills.at(i).nWords;
+		if(current_words < piece_words && i + 1 < spills.size()){ continue; }
+
+		std::stringstream stream;
+		stream << prefix_ << "_s" << std::setw(2) << std::setfill('0') << files_.size() << "." << extension;
+		std::vector<SpillRange> ranges(1, SpillRange(first, i));
+		if(!Write(stream.str(), ranges)){ return false; }
+		files_.push_back(stream.str());
+
+		first = i + 1;
+		current_words = 0;
+	}
+
+	return true;
+}
+
+void SpillIndex::Print(bool verbose_/*=false*/){
+	unsigned long long first_time = GetFirstTime();
+	unsigned long long last_time = first_time;
+	unsigned long long num_events = 0;
+	size_t num_bad = 0;
+	for(std::vector<SpillInfo>::iterator iter = spills.begin(); iter != spills.end(); iter++){
+		if(iter->nEvents > 0 && iter->last_time > last_time){ last_time = iter->last_time; }
+		num_events += iter->nEvents;
+		if(!iter->good){ num_bad++; }
+	}
+
+	std::cout << " File: " << fname << std::endl;
+	std::cout << "  Spills: " << spills.size() << " (" << num_bad << " incomplete)\n";
+	std::cout << "  Events: " << num_events << std::endl;
+	std::cout << "  Time range: " << (last_time - first_time) * pixie::clockInSeconds << " s\n";
+
+	if(!verbose_){ return; }
+
+	std::cout << "\n  spill       offset  words  events     start (s)      stop (s)\n";
+	for(size_t i = 0; i < spills.size(); i++){
+		const SpillInfo &info = spills.at(i);
+		std::cout << std::setw(7) << i << std::setw(13) << info.offset << std::setw(7) << info.nWords << std::setw(8) << info.nEvents;
+		if(info.nEvents > 0){
+			std::cout << std::fixed << std::setprecision(6) << std::setw(14) << (info.first_time - first_time) * pixie::clockInSeconds;
+			std::cout << std::setw(14) << (info.last_time - first_time) * pixie::clockInSeconds;
+			std::cout.unsetf(std::ios::fixed);
+		}
+		if(!info.good){ std::cout << "  incomplete"; }
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,151 @@
+/** \file StageTimer.cpp
+ * \brief Wall clock timing and latency histogram of a single processing stage
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "StageTimer.hpp"
+
+bool StageTimer::use_perf = false;
+
+StageTimer::StageTimer(){
+	perf_fd = -2;
+	Zero();
+}
+
+StageTimer::~StageTimer(){
+	if(perf_fd >= 0){ close(perf_fd); } // Closing the leader also releases the cache miss counter
+}
+
+void StageTimer::open_perf(){
+	perf_fd = -1;
+#ifdef __linux__
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	// Count the calling thread on any cpu
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	int leader = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if(leader < 0){
+		static bool warned = false;
+		if(!warned){ std::cout << "StageTimer: Warning! Failed to open hardware counters (" << strerror(errno) << "), check /proc/sys/kernel/perf_event_paranoid\n"; }
+		warned = true;
+		return;
+	}
+
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	if(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0) < 0){
+		close(leader);
+		return;
+	}
+	perf_fd = leader;
+#endif
+}
+
+bool StageTimer::read_perf(unsigned long long *values_){
+	unsigned long long data[3]; // Number of counters followed by their values
+	if(read(perf_fd, data, sizeof(data)) != (ssize_t)sizeof(data)){ return false; }
+	values_[0] = data[1];
+	values_[1] = data[2];
+	return true;
+}
+
+/* Times below 8 ns get a bin each. Above that, bin = 4*(log2(ns) - 1) plus
+ * the next two bits of the time, so that bin 8 starts at 8 ns.
+ */
+unsigned int StageTimer::Bin(unsigned long long ns_){
+	if(ns_ < 2*STAGE_TIMER_SUBBINS){ return (unsigned int)ns_; }
+	unsigned int exponent = 63 - __builtin_clzll(ns_);
+	unsigned int bin = (exponent - 1)*STAGE_TIMER_SUBBINS + ((ns_ >> (exponent - 2)) & (STAGE_TIMER_SUBBINS - 1));
+	return (bin < STAGE_TIMER_BINS ? bin : STAGE_TIMER_BINS - 1);
+}
+
+double StageTimer::BinLow(unsigned int bin_){
+	if(bin_ < 2*STAGE_TIMER_SUBBINS){ return bin_; }
+	unsigned int exponent = bin_ / STAGE_TIMER_SUBBINS + 1;
+	return std::ldexp(1.0 + (double)(bin_ % STAGE_TIMER_SUBBINS)/STAGE_TIMER_SUBBINS, exponent);
+}
+
+void StageTimer::Stop(){
+	unsigned long long elapsed = Now() - start_time;
+	total_time += elapsed;
+	if(elapsed > max_time){ max_time = elapsed; }
+	histogram[Bin(elapsed)]++;
+	calls++;
+
+	unsigned long long values[2];
+	if(perf_fd >= 0 && read_perf(values)){
+		perf_total[0] += values[0] - perf_start[0];
+		perf_total[1] += values[1] - perf_start[1];
+	}
+}
+
+void StageTimer::Zero(){
+	start_time = Now();
+	total_time = 0;
+	max_time = 0;
+	calls = 0;
+	channels = 0;
+	memset(histogram, 0, sizeof(histogram));
+	perf_start[0] = perf_start[1] = 0;
+	perf_total[0] = perf_total[1] = 0;
+}
+
+double StageTimer::GetQuantile(double quantile_) const {
+	if(calls == 0){ return 0.0; }
+	unsigned long long target = (unsigned long long)std::ceil(quantile_ * calls);
+	unsigned long long sum = 0;
+	for(unsigned int i = 0; i < STAGE_TIMER_BINS; i++){
+		sum += histogram[i];
+		if(sum >= target){ // Linear interpolation within the bin
+			double low = BinLow(i), high = (i + 1 < STAGE_TIMER_BINS ? BinLow(i + 1) : max_time);
+			double frac = 1.0 - (double)(sum - target)/histogram[i];
+			return std::min(low + frac*(high - low), (double)max_time);
+		}
+	}
+	return max_time;
+}
+
+void StageTimer::PrintHeader(){
+	std::cout << "  " << std::left << std::setw(24) << "Stage" << std::right << std::setw(12) << "Calls" << std::setw(12) << "Total (s)";
+	std::cout << std::setw(12) << "Mean (us)" << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)" << std::setw(12) << "Max (us)";
+	std::cout << std::setw(12) << "Channels" << std::setw(12) << "ns/chan";
+	if(use_perf){ std::cout << std::setw(14) << "Cycles/call" << std::setw(14) << "Misses/call"; }
+	std::cout << std::endl;
+}
+
+void StageTimer::Print(const std::string &name_) const {
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << "  " << std::left << std::setw(24) << name_ << std::right << std::setw(12) << calls;
+	std::cout << std::fixed << std::setprecision(3) << std::setw(12) << GetSeconds();
+	std::cout << std::setw(12) << (calls > 0 ? total_time*1E-3/calls : 0.0);
+	std::cout << std::setw(12) << GetQuantile(0.50)*1E-3 << std::setw(12) << GetQuantile(0.99)*1E-3 << std::setw(12) << max_time*1E-3;
+	std::cout << std::setw(12) << channels;
+	if(channels > 0){ std::cout << std::setprecision(1) << std::setw(12) << (double)total_time/channels; }
+	else{ std::cout << std::setw(12) << "-"; }
+	if(use_perf){
+		if(perf_fd >= 0 && calls > 0){ std::cout << std::setprecision(0) << std::setw(14) << (double)perf_total[0]/calls << std::setw(14) << (double)perf_total[1]/calls; }
+		else{ std::cout << std::setw(14) << "-" << std::setw(14) << "-"; }
+	}
+	std::cout << std::endl;
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
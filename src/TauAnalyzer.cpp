@@ -14,9 +14,15 @@
 
 #include <cmath>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 using namespace dammIds::trace;
 
+const double TauAnalyzer::tolerance = 0.01;
+
 TauAnalyzer::TauAnalyzer() : TraceAnalyzer(0, 0)
 {
     // type and subtype default to empty string 
@@ -24,52 +30,200 @@ TauAnalyzer::TauAnalyzer() : TraceAnalyzer(0, 0)
 }
 
 TauAnalyzer::TauAnalyzer(const string &aType, const string &aSubtype) :
-  TraceAnalyzer(), type(aType), subtype(aSubtype)
+  TraceAnalyzer(0, 0), type(aType), subtype(aSubtype)
 {
     name="tau";
 }
 
 TauAnalyzer::~TauAnalyzer()
 {
-    // do nothing
+    // print the running decay constant of each channel
+    for (vector<TauEstimate>::size_type id = 0; id < estimates.size(); id++) {
+	const TauEstimate &est = estimates[id];
+	if (est.fits == 0)
+	    continue;
+	cout << "TauAnalyzer: channel " << id << ", tau = " << est.mean * 1e6 
+	     << " us (" << est.fits << " of " << est.traces << " traces fitted"
+	     << (est.converged ? ", converged)" : ")") << endl;
+    }
+}
+
+/** Both the type and the subtype must match, an empty type or subtype
+ * matches anything */
+bool TauAnalyzer::AppliesTo(const string &aType, const string &aSubtype) const
+{
+    return ((type == "" || type == aType) && (subtype == "" || subtype == aSubtype));
+}
+
+/** Log-linear least squares fit of the falling edge, ln(y - baseline) = a - t/tau.
+ * The baseline is the mean of the samples before the maximum. The fit starts
+ * 10% of the way from the maximum to the minimum and ends before the pulse
+ * falls below 10% of its height (or 10% before the minimum). */
+bool TauAnalyzer::FitTau(const Trace &trace, double &tau) const
+{
+    const int *samples = &trace[0];
+    unsigned int maxPos = max_element(trace.begin(), trace.end()) - trace.begin();
+    unsigned int minPos = min_element(trace.begin() + maxPos, trace.end()) - trace.begin();
+    unsigned int numBaseline = min(maxPos, 15u);
+    if (numBaseline == 0)
+	return false;
+
+    double baseline = 0;
+    for (unsigned int i = 0; i < numBaseline; i++)
+	baseline += samples[i];
+    baseline /= numBaseline;
+
+    if (samples[maxPos] <= baseline)
+	return false;
+    double threshold = baseline + (samples[maxPos] - baseline) / 10.;
+    unsigned int size = minPos - maxPos;
+    unsigned int low = maxPos + size / 10;
+    unsigned int high = minPos - size / 10;
+    for (unsigned int i = low; i < high; i++) {
+	if (samples[i] < threshold) {
+	    high = i;
+	    break;
+	}
+    }
+    if (high < low + 4)
+	return false;
+
+    double sumLog, sumXLog;
+    LogSums(samples + low, high - low, baseline, sumLog, sumXLog);
+
+    // sum(x) and sum(x^2) for x = 0 .. n-1 are known
+    double n = high - low;
+    double sumX = n * (n - 1) / 2;
+    double slope = (n * sumXLog - sumX * sumLog) / (n * n * (n * n - 1) / 12);
+    if (!(slope < 0))
+	return false;
+    tau = -pixie::clockInSeconds / slope;
+    return true;
+}
+
+void TauAnalyzer::LogSumsScalar(const int *samples, unsigned int n, double baseline, double &sumLog, double &sumXLog)
+{
+    sumLog = sumXLog = 0;
+    for (unsigned int i = 0; i < n; i++) {
+	double y = log(samples[i] - baseline);
+	sumLog += y;
+	sumXLog += i * y;
+    }
+}
+
+#ifdef __SSE2__
+/** Natural log of 4 positive, normal floats. x = m*2^e with m in [sqrt(1/2),
+ * sqrt(2)) and ln(m) = 2 atanh(t), t = (m-1)/(m+1), from its series to t^9.
+ * The relative error is below 1e-7 */
+static inline __m128 log_ps(__m128 x)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+
+    // move m from [1, 2) to [sqrt(1/2), sqrt(2))
+    __m128 big = _mm_cmpge_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+    exponent = _mm_sub_epi32(exponent, _mm_castps_si128(big)); // true is -1
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(1.0f / 7), _mm_mul_ps(t2, _mm_set1_ps(1.0f / 9)));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f / 5), _mm_mul_ps(t2, poly));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f / 3), _mm_mul_ps(t2, poly));
+    poly = _mm_add_ps(one, _mm_mul_ps(t2, poly));
+    __m128 lnm = _mm_mul_ps(_mm_add_ps(t, t), poly);
+
+    return _mm_add_ps(lnm, _mm_mul_ps(_mm_cvtepi32_ps(exponent), _mm_set1_ps(0.693147181f)));
+}
+#endif
+
+/** One pass over the samples, 4 at a time. The logs are taken in single
+ * precision and summed in double precision */
+void TauAnalyzer::LogSums(const int *samples, unsigned int n, double baseline, double &sumLog, double &sumXLog)
+{
+#ifdef __SSE2__
+    const __m128 base = _mm_set1_ps((float)baseline);
+    const __m128d four = _mm_set1_pd(4.0);
+    __m128d sumLo = _mm_setzero_pd(), sumHi = _mm_setzero_pd();
+    __m128d sumXLo = _mm_setzero_pd(), sumXHi = _mm_setzero_pd();
+    __m128d xLo = _mm_set_pd(1.0, 0.0), xHi = _mm_set_pd(3.0, 2.0);
+    unsigned int i = 0;
+    for (; i + 4 <= n; i += 4) {
+	__m128i block = _mm_loadu_si128((const __m128i *)(samples + i));
+	__m128 y = log_ps(_mm_sub_ps(_mm_cvtepi32_ps(block), base));
+	__m128d yLo = _mm_cvtps_pd(y), yHi = _mm_cvtps_pd(_mm_movehl_ps(y, y));
+	sumLo = _mm_add_pd(sumLo, yLo);
+	sumHi = _mm_add_pd(sumHi, yHi);
+	sumXLo = _mm_add_pd(sumXLo, _mm_mul_pd(xLo, yLo));
+	sumXHi = _mm_add_pd(sumXHi, _mm_mul_pd(xHi, yHi));
+	xLo = _mm_add_pd(xLo, four);
+	xHi = _mm_add_pd(xHi, four);
+    }
+    double lanes[2], xLanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sumLo, sumHi));
+    _mm_storeu_pd(xLanes, _mm_add_pd(sumXLo, sumXHi));
+    sumLog = lanes[0] + lanes[1];
+    sumXLog = xLanes[0] + xLanes[1];
+    for (; i < n; i++) {
+	double y = log(samples[i] - baseline);
+	sumLog += y;
+	sumXLog += i * y;
+    }
+#else
+    LogSumsScalar(samples, n, baseline, sumLog, sumXLog);
+#endif
+}
+
+/** Exponentially weighted mean and variance. Until estimateWindow fits have
+ * been made this is the plain mean and variance */
+void TauAnalyzer::UpdateEstimate(TauEstimate &est, double tau)
+{
+    est.fits++;
+    double alpha = 1.0 / min(est.fits, (unsigned long long)estimateWindow);
+    double delta = tau - est.mean;
+    est.mean += alpha * delta;
+    est.var = (1 - alpha) * (est.var + alpha * delta * delta);
+    est.converged = (est.fits >= estimateWindow && 
+		     sqrt(est.var / estimateWindow) < tolerance * fabs(est.mean));
 }
 
 void TauAnalyzer::Analyze(Trace &trace, const string &aType, const string &aSubtype)
 {
-    // don't do analysis for piled-up traces
-    if (trace.HasValue("filterEnergy2")) {
+    StartAnalyze();
+    // only do analysis for the proper type and subtype
+    if (!AppliesTo(aType, aSubtype)) {
+	EndAnalyze();
 	return;
     }
-    // only do analysis for the proper type and subtype
-    if (type != "" && subtype != "" && 
-	type != aType && subtype != aSubtype ) {
+    // don't do analysis for piled-up traces
+    if (trace.HasValue("filterEnergy2")) {
+	EndAnalyze();
 	return;
     }
 
     TraceAnalyzer::Analyze(trace, type, subtype);
-	
-    // find the maximum
-    Trace::const_iterator itMax=max_element(trace.begin(), trace.end());
-    Trace::const_iterator itMin=min_element(itMax, (Trace::const_iterator)trace.end());
-    iterator_traits< Trace::const_iterator >::difference_type  size = distance(itMax, itMin);
-    
-    // skip over the area near the extrema since it may be non-exponential there
-    advance(itMax, size/10);
-    advance(itMin, -size/10);
-
-    size = distance(itMax, itMin);
-    double n = (double)size;
-
-    double sum1=0, sum2=0;
-    double i=0;
-    for (Trace::const_iterator it=itMax; it != itMin; it++) {
-	double j=i+1.;
-	sum1 += double(*it)*(j*n*n-3*j*j*n+2*j*j*j);
-	sum2 += double(*it)*(i*n*n-3*i*i*n+2*i*i*i);
-	i+=1.;
+
+    // keep a running estimate for each channel, once it has settled only
+    // every checkInterval-th trace is fitted to follow any drift
+    TauEstimate *est = NULL;
+    int id = trace.GetChannelId();
+    if (id >= 0) {
+	if ((unsigned int)id >= estimates.size())
+	    estimates.resize(id + 1);
+	est = &estimates[id];
+	est->traces++;
+    }
+
+    double tau;
+    if (est && est->converged && est->traces % checkInterval != 0) {
+	trace.SetValue("tau", est->mean);
+    } else if (FitTau(trace, tau)) {
+	trace.SetValue("tau", tau);
+	if (est)
+	    UpdateEstimate(*est, tau);
     }
-    double tau =  1 / log(sum1 / sum2) * pixie::clockInSeconds;
-    trace.SetValue("tau", tau);
     
     EndAnalyze(); //update the timer
 }
@@ -47,16 +47,27 @@ TimingInformation::TimingData::TimingData(ChanEvent *chan) : trace(chan->GetTrac
 	// refered here directly. Should not change anything but allows to 
 	// remove global variable emptyTrace
 	const Trace& trace = chan->GetTrace();
-	aveBaseline = trace.GetValue("baseline");
-	discrimination = trace.GetValue("discrim");
+	const TraceFeatures& features = trace.GetFeatures();
 	highResTime = chan->GetHighResTime()*1e+9;  
-	maxpos = trace.GetValue("maxpos");
-	maxval = trace.GetValue("maxval");
 	numAboveThresh = trace.GetValue("numAboveThresh");
 	phase = trace.GetValue("phase")*(pixie::adcClockInSeconds*1e+9);
-	stdDevBaseline = trace.GetValue("sigmaBaseline");
-	tqdc = trace.GetValue("tqdc")/qdcCompression;
 	walk = trace.GetValue("walk");
+	if(features.valid){
+		aveBaseline = features.baseline;
+		discrimination = features.discrim;
+		maxpos = features.maxPos;
+		maxval = features.maxVal;
+		stdDevBaseline = features.sigmaBaseline;
+		tqdc = features.qdc/qdcCompression;
+	}
+	else{
+		aveBaseline = numeric_limits<double>::quiet_NaN();
+		discrimination = numeric_limits<double>::quiet_NaN();
+		maxpos = numeric_limits<double>::quiet_NaN();
+		maxval = numeric_limits<double>::quiet_NaN();
+		stdDevBaseline = numeric_limits<double>::quiet_NaN();
+		tqdc = numeric_limits<double>::quiet_NaN();
+	}
 		
 	//Calculate some useful quantities.
 	//snr = pow(maxval/stdDevBaseline,2); 
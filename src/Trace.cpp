@@ -8,6 +8,7 @@
 #include <numeric>
 
 #include "Trace.hpp"
+#include "TraceAnalyzer.hpp"
 #include "DammPlotIds.hpp"
 
 using namespace std;
@@ -145,6 +146,75 @@ unsigned int Trace::FindMaxInfo(std::string tDelay)
     return (itTrace-begin());
 }
 
+const TraceFeatures& Trace::ExtractFeatures(const TraceFeatureParameters &parms)
+{
+    features.Zero();
+    waveform.clear();
+
+    unsigned int lo = parms.searchLow, hi = parms.searchHigh;
+    if (hi > size() || lo >= hi)
+	return features;
+
+    const int *samples = &(*this)[0];
+    unsigned int maxPos = lo;
+    for (unsigned int i = lo + 1; i < hi; i++) {
+	if (samples[i] > samples[maxPos])
+	    maxPos = i;
+    }
+
+    // the waveform window [winLow, winHigh] must lie inside the trace
+    unsigned int winLow = maxPos - parms.waveformLow;
+    unsigned int winHigh = maxPos + parms.waveformHigh;
+    if (maxPos < parms.waveformLow || winLow == 0 || winHigh >= size())
+	return features;
+
+    features.maxPos = maxPos;
+    if (samples[maxPos] >= 4095) {
+	features.saturated = true;
+	InsertValue("saturation", 1);
+	return features;
+    }
+
+    unsigned int discLow = maxPos + parms.discrimLow;
+    unsigned int discHigh = winHigh;
+    bool doDiscrim = parms.doDiscrim && discLow <= discHigh;
+
+    /* One pass over the trace accumulating the raw sum. The sum of every
+     * range is the difference of the running sums at its ends, and the
+     * baseline is the range [0, winLow) before the window. */
+    double sum = 0, sqSum = 0;
+    double sumWinLow = 0, sumWinHigh = 0, sumDiscLow = 0, sumDiscHigh = 0;
+    unsigned int i = 0;
+    for (; i < winLow; i++) {
+	sum += samples[i];
+	sqSum += (double)samples[i] * samples[i];
+    }
+    sumWinLow = sum;
+    for (; i < size(); i++) {
+	if (i == discLow) { sumDiscLow = sum; }
+	if (i == discHigh) { sumDiscHigh = sum; }
+	sum += samples[i];
+	if (i == winHigh) { sumWinHigh = sum; }
+    }
+
+    double baseline = sumWinLow / winLow;
+    features.baseline = baseline;
+    features.sigmaBaseline = sqrt(sqSum / winLow - baseline * baseline);
+    features.maxVal = samples[maxPos] - baseline;
+    features.qdc = (sumWinHigh - sumWinLow) - (winHigh - winLow + 1) * baseline;
+    features.fullQdc = sum - size() * baseline;
+    features.qdcToMax = features.qdc / features.maxVal;
+    if (doDiscrim)
+	features.discrim = (sumDiscHigh - sumDiscLow) - (discHigh - discLow) * baseline;
+
+    waveform.resize(winHigh - winLow + 1);
+    for (unsigned int j = winLow; j <= winHigh; j++)
+	waveform[j - winLow] = samples[j] - baseline;
+
+    features.valid = true;
+    return features;
+}
+
 void Trace::Plot(int id)
 {
     for (size_type i=0; i < size(); i++) {
@@ -186,3 +256,15 @@ void Trace::OffsetPlot(int id, int row, double offset)
 	histo.Plot(id, i, row, max(0., at(i) - offset));
     }
 }
+
+/** The analyzers fill the trace values, so the trace is modified even when the
+ * result was requested through a const accessor. The pending list is cleared
+ * first so that the analyzers may use the accessors themselves. */
+void Trace::RunPending() const
+{
+    Trace *self = const_cast<Trace*>(this);
+    const vector<TraceAnalyzer *> *chain = pendingAnalyzers;
+    self->pendingAnalyzers = NULL;
+    for (vector<TraceAnalyzer *>::const_iterator it = chain->begin(); it != chain->end(); it++)
+        (*it)->Analyze(*self, *pendingType, *pendingSubtype);
+}
@@ -36,8 +36,7 @@ void TraceAnalyzer::_initialize(){
     // start at -1 so that when incremented on first trace analysis,
     //   row 0 is respectively filled in the trace spectrum of inheritees 
     numTracesAnalyzed = -1; 
-	total_time = 0;
-	start_time = clock();
+    timerDepth = 0;
 }
 
 TraceAnalyzer::TraceAnalyzer() : histo(OFFSET, RANGE){
@@ -68,8 +67,8 @@ float TraceAnalyzer::Status()
 	float time_taken = 0.0;
 	if(initDone){
 		// output the time usage and the number of valid events
-		time_taken = ((float)total_time)/CLOCKS_PER_SEC;
-		cout << " " << name << "Analyzer: Used " << time_taken << " seconds of CPU time\n";
+		time_taken = timer.GetSeconds();
+		cout << " " << name << "Analyzer: Used " << time_taken << " seconds\n";
 	}
 	return time_taken;
 }
@@ -103,14 +102,13 @@ bool TraceAnalyzer::InitDamm()
 }
 
 /**
- * Function to quickly analyze a trace online.
+ * Count the trace and record the analyzer level in it. The timer is started
+ * and stopped by the Analyze() of the derived analyzer
  */
 void TraceAnalyzer::Analyze(Trace &trace, const string &detType, const string &detSubtype)
 {
-    StartAnalyze(); // begin timing process
     numTracesAnalyzed++;
-    EndAnalyze(trace);
-    return;
+    trace.SetValue("analyzedLevel", level);
 }
 
 /**
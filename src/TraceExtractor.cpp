@@ -32,12 +32,19 @@ void TraceExtractor::DeclarePlots(void)
 	DeclareHistogram1D(extractor::D_TRACE + i, traceBins, "traces data");
 }
 
+/** Only traces of the selected type and subtype are extracted */
+bool TraceExtractor::AppliesTo(const string &aType, const string &aSubtype) const
+{
+    return (type == aType && subtype == aSubtype);
+}
+
 /** Plot the damm spectra of the first few traces analyzed with (level >= 1) */
 void TraceExtractor::Analyze(Trace &trace, const string &aType, const string &aSubtype)
 {   
     using namespace dammIds::trace;
 
     if (type ==  aType && subtype == aSubtype && numTracesAnalyzed < numTraces) {	
+	StartAnalyze();
 	TraceAnalyzer::Analyze(trace, type, subtype);
 	trace.OffsetPlot(extractor::D_TRACE + numTracesAnalyzed, trace.DoBaseline(1,20) );
 	EndAnalyze(trace);
@@ -130,6 +130,7 @@ void TraceFilterer::DeclarePlots(void)
 void TraceFilterer::Analyze(Trace &trace, const string &type, const string &subtype)
 {
 	using namespace dammIds::trace;
+	StartAnalyze();
 	TracePlotter::Analyze(trace, type, subtype);
 
 	if (level >= 5) {
@@ -165,9 +166,11 @@ void TraceFilterer::Analyze(Trace &trace, const string &type, const string &subt
 		}
 		FindPulse(fastFilter.begin(), fastFilter.end());
 
+		trace.ClearPulses();
 		if (pulse.isFound) {
 			trace.SetValue("filterTime", (int)pulse.time);
 			trace.SetValue("filterEnergy", pulse.energy);
+			trace.AddPulse(pulse.time, pulse.energy);
 		}
 
 		// now plot some stuff
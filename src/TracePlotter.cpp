@@ -42,6 +42,7 @@ void TracePlotter::DeclarePlots(void)
 /** Plot the damm spectra of the first few traces analyzed with (level >= 1) */
 void TracePlotter::Analyze(Trace &trace, const string &type, const string &subtype)
 {   
+    StartAnalyze();
     TraceAnalyzer::Analyze(trace, type, subtype);
     if (level >= 1 && numTracesAnalyzed < numTraces) {      
         trace.Plot(plotter::DD_TRACE, numTracesAnalyzed);
@@ -79,7 +79,7 @@ bool TriggerProcessor::PreProcess(RawEvent &event){
 
     unsigned int multiplicity = 0;
     for (vector<ChanEvent*>::const_iterator it = scintTriggerEvents.begin(); it != scintTriggerEvents.end(); it++) {
-    	TimingInformation::TimingData trigger((*it));
+    	const TimingInformation::TimingData &trigger = (*it)->GetTimingData();
         double energy = (*it)->GetEnergy();
         if (energy > detectors::triggerThreshold){ ++multiplicity; }
         if(use_damm){ plot(D_ENERGY_TRIGGER, energy); }
@@ -599,7 +599,7 @@ void VandleProcessor::FillMap(const vector<ChanEvent*> &eventList, const string
 		string subType = (*it)->GetChanID().GetSubtype();
 		IdentKey key(location, subType); //--- the key is the location and subtype of the eventList
 	
-		TimingDataMap::iterator itTemp = eventMap.insert(make_pair(key, TimingData(*it))).first; //--- inserts into map the key and value, which in turn are a pair, first refers to map::insert
+		TimingDataMap::iterator itTemp = eventMap.insert(make_pair(key, (*it)->GetTimingData())).first; //--- inserts into map the key and value, which in turn are a pair, first refers to map::insert
 	
 		if(type == "start"){ continue; }
 
@@ -23,6 +23,7 @@ using namespace dammIds::trace::waveform;
 //********** WaveformAnalyzer **********
 WaveformAnalyzer::WaveformAnalyzer() : TraceAnalyzer(OFFSET, RANGE, "Waveform") 
 {
+    haveParameters = false;
 }
 
 //********** DeclarePlots **********
@@ -38,31 +39,51 @@ bool WaveformAnalyzer::InitDamm()
     return true;
 }
 
+//********** IsWaveformType **********
+bool WaveformAnalyzer::IsWaveformType(const string &detType)
+{
+    return (detType == "vandleSmall" || detType == "vandleBig" || detType == "scint" || detType == "pulser" || detType == "tvandle");
+}
+
+//********** AppliesTo **********
+bool WaveformAnalyzer::AppliesTo(const string &detType, const string &detSubtype) const
+{
+    return IsWaveformType(detType);
+}
+
 //********** Analyze **********
 void WaveformAnalyzer::Analyze(Trace &trace, const string &detType, const string &detSubtype)
 {
 	StartAnalyze();
     TraceAnalyzer::Analyze(trace, detType, detSubtype);
     
-    if(detType == "vandleSmall" || detType == "vandleBig" || detType == "scint" || detType == "pulser" || detType == "tvandle") {
-    	unsigned int maxPos;
-    	if(detSubtype == "liquid"){ maxPos = trace.FindMaxInfo("traceDelayLiquid"); }
-    	else{ maxPos = trace.FindMaxInfo("traceDelayVandle"); }
-
-	if(trace.HasValue("saturation")) {
-	    EndAnalyze();
-	    return;
-	}
+    // Only called for the types in AppliesTo()
+    if(!haveParameters){ LoadParameters(); }
+    
+    // Everything is extracted in one pass, the string keyed values are no longer filled
+    if(detSubtype == "liquid"){ trace.ExtractFeatures(liquidParms); }
+    else{ trace.ExtractFeatures(vandleParms); }
+    EndAnalyze();
+}
 
-	unsigned int waveformLow = GetConstant("waveformLow");
-	unsigned int waveformHigh = GetConstant("waveformHigh");
-	unsigned int startDiscrimination = GetConstant("startDiscrimination");
-	double qdc = trace.DoQDC(maxPos-waveformLow, waveformHigh+waveformLow);
+//********** LoadParameters **********
+void WaveformAnalyzer::LoadParameters()
+{
+    double samplesPerNs = 1.0 / (pixie::adcClockInSeconds*1e9);
+    double walk = GetConstant("trapezoidalWalk") * samplesPerNs;
+    
+    // The maximum is searched for in [delay - walk - 3, delay)
+    vandleParms.searchHigh = (unsigned int)(GetConstant("traceDelayVandle") * samplesPerNs);
+    vandleParms.searchLow = (unsigned int)max(0.0, vandleParms.searchHigh - walk - 3);
+    vandleParms.waveformLow = (unsigned int)GetConstant("waveformLow");
+    vandleParms.waveformHigh = (unsigned int)GetConstant("waveformHigh");
+    vandleParms.discrimLow = (unsigned int)GetConstant("startDiscrimination");
+    vandleParms.doDiscrim = false;
 
-	trace.InsertValue("qdcToMax", qdc/trace.GetValue("maxval"));
+    liquidParms = vandleParms;
+    liquidParms.searchHigh = (unsigned int)(GetConstant("traceDelayLiquid") * samplesPerNs);
+    liquidParms.searchLow = (unsigned int)max(0.0, liquidParms.searchHigh - walk - 3);
+    liquidParms.doDiscrim = true;
 
-	if(detSubtype == "liquid")
-	    trace.DoDiscrimination(startDiscrimination, waveformHigh - startDiscrimination);
-    } //if(detType
-    EndAnalyze();
+    haveParameters = true;
 }
@@ -5,12 +5,14 @@
 struct DataType{
 	std::string type;
 	std::string decl;
+	std::string arg_decl;
 	std::string name;
 	std::string descrip;
 	
 	bool trace_value;
 	bool mult_value;
 	bool is_vector;
+	bool is_packed;
 	
 	DataType(const std::string &type_, const std::string &name_, const std::string &description_);
 	
@@ -104,6 +104,9 @@ fi
 if [ $DEF_FILE -nt $DEF_FILE_BKP ]; then
 	# Definitions file was modified, rebuild the entire file tree
 	LEVEL_NEEDED=5
+elif [ $TOOL_SRC_DIR/$BUILDER_SRC -nt $INC_DIR/$STRUCT_HEADER ]; then
+	# The generator was modified (e.g. a class version), rebuild the entire file tree
+	LEVEL_NEEDED=5
 else
 	# Definitions file was not modified, but check for missing files along the build tree
 	if [ -f $SRC_DIR/$STRUCT_SOURCE ] && [ -f $INC_DIR/$STRUCT_HEADER ] && [ -f $DICT_DIR/$LINKFILE ]; then
@@ -139,7 +142,7 @@ fi
 
 if [ $LEVEL_NEEDED -ge 5 ]; then
 	# Build the builder executable, if needed
-	if [ ! -f $TOOL_DIR/$BUILDER_EXE ]; then
+	if [ ! -f $TOOL_DIR/$BUILDER_EXE ] || [ $TOOL_SRC_DIR/$BUILDER_SRC -nt $TOOL_DIR/$BUILDER_EXE ]; then
 		echo -n " [1/6] Building structures file generator... "
 		g++ -Wall -O2 -o $TOOL_DIR/$BUILDER_EXE -I$TOOL_INC_DIR $TOOL_SRC_DIR/$BUILDER_SRC
 
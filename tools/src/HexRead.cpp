@@ -9,8 +9,18 @@
 #include <fstream>
 #include <sstream>
 #include <bitset>
+#include <vector>
 #include <stdlib.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define HEAD 1145128264 // Run begin buffer
 #define DATA 1096040772 // Physics data buffer
 #define SCAL 1279345491 // Scaler type buffer
@@ -20,6 +30,8 @@
 #define ENDFILE 541478725 // End of file buffer
 #define ENDBUFF -1 // End of buffer marker
 
+#define LDF_BUFFER_BYTES 32776 // Size of an ldf buffer (8194 words)
+
 struct CLoption{
 	char opt;
 	std::string alias;
@@ -54,7 +66,12 @@ void help(){
 	std::cout << "   -c, --convert      Attempt to convert words to Ascii characters\n";
 	std::cout << "   -s, --search <int> Search for an integer in the stream\n";
 	std::cout << "   -z, --zero         Suppress zero output\n";
-	std::cout << "   -w, --word <int>   Specify the file word size\n\n";
+	std::cout << "   -w, --word <int>   Specify the file word size\n";
+	std::cout << "   -m, --map          Memory map the file and only print the offsets of matches (fast)\n";
+	std::cout << "   -b, --buffers      Find buffer headers and report irregular buffer spacing (implies --map)\n";
+	std::cout << "   -p, --pattern <int>[/<mask>] Find words whose masked bits equal the pattern (implies --map)\n";
+	std::cout << "   -o, --offset <int> Start reading at a byte offset\n";
+	std::cout << "   -l, --length <int> Only read this many bytes\n\n";
 	std::cout << "  Available Buffer Types:\n";
 	std::cout << "   \"HEAD\" 1145128264\n";
 	std::cout << "   \"DATA\" 1096040772\n"; // Physics data buffer
@@ -192,7 +209,7 @@ std::string convert_to_hex(T input_, bool to_text_=false){
 
 template <typename T>
 void go(std::ifstream *input_, unsigned int &buff_count, unsigned int &good_buff_count, unsigned int &total_count, 
-		bool show_raw, bool convert, bool show_zero, bool do_search, T search_int, T buffer_select){
+		bool show_raw, bool convert, bool show_zero, bool do_search, T search_int, T buffer_select, unsigned long long max_words=0){
 	bool good_buffer;
 	int show_next = 0;
 	unsigned int count = 0;
@@ -205,7 +222,7 @@ void go(std::ifstream *input_, unsigned int &buff_count, unsigned int &good_buff
 
 	while(true){
 		input_->read((char*)&word, sizeof(T));
-		if(input_->eof()){ 
+		if(input_->eof() || (max_words > 0 && total_count >= max_words)){ 
 			if(buff_count > 1){
 				std::cout << " Buffer Size: " << word_count << " words\n";
 				std::cout << "============================================================================================================================\n";
@@ -299,6 +316,161 @@ void go(std::ifstream *input_, unsigned int &buff_count, unsigned int &good_buff
 	}
 }
 
+/* Return the name of a buffer type word, or an empty string. */
+std::string buffer_name(unsigned int word_){
+	if(word_ == HEAD){ return "HEAD"; }
+	else if(word_ == DATA){ return "DATA"; }
+	else if(word_ == SCAL){ return "SCAL"; }
+	else if(word_ == DEAD){ return "DEAD"; }
+	else if(word_ == DIR){ return "DIR "; }
+	else if(word_ == PAC){ return "PAC "; }
+	else if(word_ == ENDFILE){ return "EOF "; }
+	return "";
+}
+
+/* Compare a block of 16 words against up to 8 (pattern, mask) pairs. Bit i of the
+ * return value is set if word i matches any of the patterns. */
+template <typename T>
+unsigned int match_block(const T *words_, const std::vector<T> &values_, const std::vector<T> &masks_){
+	unsigned int hits = 0;
+	for(size_t p = 0; p < values_.size(); p++){
+		const T value = values_[p];
+		const T mask = masks_[p];
+		for(unsigned int i = 0; i < 16; i++){ hits |= (unsigned int)((words_[i] & mask) == value) << i; }
+	}
+	return hits;
+}
+
+#ifdef __SSE2__
+/* SSE2 version for 4 byte words, which compares 4 words per instruction. */
+template <>
+unsigned int match_block<unsigned int>(const unsigned int *words_, const std::vector<unsigned int> &values_, const std::vector<unsigned int> &masks_){
+	__m128i w0 = _mm_loadu_si128((const __m128i*)words_);
+	__m128i w1 = _mm_loadu_si128((const __m128i*)(words_+4));
+	__m128i w2 = _mm_loadu_si128((const __m128i*)(words_+8));
+	__m128i w3 = _mm_loadu_si128((const __m128i*)(words_+12));
+	unsigned int hits = 0;
+	for(size_t p = 0; p < values_.size(); p++){
+		__m128i value = _mm_set1_epi32((int)values_[p]);
+		__m128i mask = _mm_set1_epi32((int)masks_[p]);
+		hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w0, mask), value)));
+		hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w1, mask), value))) << 4;
+		hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w2, mask), value))) << 8;
+		hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w3, mask), value))) << 12;
+	}
+	return hits;
+}
+#endif
+
+/* Scan a memory mapped region for words matching any of the (pattern, mask) pairs
+ * and print the byte offset of each match. The first num_buffer_values_ pairs are
+ * buffer header types, and the spacing between consecutive buffer headers is also
+ * checked. Return the number of matches. */
+template <typename T>
+unsigned long long scan_mapped(const char *map_, unsigned long long start_, unsigned long long stop_, 
+							   const std::vector<T> &values_, const std::vector<T> &masks_, size_t num_buffer_values_, bool convert){
+	const T *words = (const T*)(map_ + start_);
+	unsigned long long num_words = (stop_ - start_) / sizeof(T);
+	unsigned long long num_matches = 0;
+	unsigned long long num_irregular = 0;
+	unsigned long long last_buffer = 0;
+	bool found_buffer = false;
+
+	for(unsigned long long index = 0; index < num_words; index += 16){
+		unsigned int hits;
+		if(index + 16 <= num_words){ hits = match_block<T>(words + index, values_, masks_); }
+		else{ // Handle the last partial block one word at a time
+			hits = 0;
+			for(unsigned long long i = index; i < num_words; i++){
+				for(size_t p = 0; p < values_.size(); p++){
+					if((words[i] & masks_[p]) == values_[p]){ hits |= 1 << (i - index); }
+				}
+			}
+		}
+
+		while(hits){
+			unsigned int bit = __builtin_ctz(hits);
+			hits &= hits - 1;
+
+			T word = words[index + bit];
+			unsigned long long offset = start_ + (index + bit) * sizeof(T);
+			std::cout << " " << convert_to_hex(offset) << " (" << offset << ")  " << convert_to_hex(word);
+			if(convert){ std::cout << "  " << convert_to_hex(word, true); }
+			// Only buffer headers count for the spacing, not words which match the pattern alone
+			bool is_buffer = false;
+			for(size_t p = 0; p < num_buffer_values_ && !is_buffer; p++){ is_buffer = (word == values_[p]); }
+			if(is_buffer){
+				std::cout << " \"" << buffer_name((unsigned int)word) << "\"";
+				if(found_buffer && (offset - last_buffer) % LDF_BUFFER_BYTES != 0){
+					std::cout << "  <-- irregular spacing of " << offset - last_buffer << " bytes";
+					num_irregular++;
+				}
+				last_buffer = offset;
+				found_buffer = true;
+			}
+			std::cout << std::endl;
+			num_matches++;
+		}
+	}
+
+	if(num_buffer_values_ > 0){ std::cout << "  Found " << num_irregular << " irregularly spaced buffers\n"; }
+	return num_matches;
+}
+
+/* Map the requested region of a file and search it. */
+template <typename T>
+int run_mapped(const char *fname_, unsigned long long offset_, unsigned long long length_, bool buffers_, 
+			   bool do_pattern_, T pattern_, T mask_, bool convert_){
+	int fd = open(fname_, O_RDONLY);
+	if(fd < 0){
+		std::cout << " Error: failed to open input file\n";
+		return 1;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0){
+		std::cout << " Error: input file is empty\n";
+		close(fd);
+		return 1;
+	}
+	unsigned long long file_size = info.st_size;
+	const char *map = (const char*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == (const char*)MAP_FAILED){
+		std::cout << " Error: failed to map input file\n";
+		return 1;
+	}
+	madvise((void*)map, file_size, MADV_SEQUENTIAL);
+
+	// Align the start to a whole word and clip the range to the file
+	unsigned long long start = offset_ - (offset_ % sizeof(T));
+	unsigned long long stop = (length_ > 0 && start + length_ < file_size ? start + length_ : file_size);
+	if(start >= stop){
+		std::cout << " Error: offset is past the end of the file\n";
+		munmap((void*)map, file_size);
+		return 1;
+	}
+
+	std::vector<T> values, masks;
+	if(buffers_){
+		unsigned int types[7] = {HEAD, DATA, SCAL, DEAD, DIR, PAC, ENDFILE};
+		for(int i = 0; i < 7; i++){
+			values.push_back((T)types[i]);
+			masks.push_back((T)-1);
+		}
+	}
+	size_t num_buffer_values = values.size();
+	if(do_pattern_){
+		values.push_back(pattern_ & mask_);
+		masks.push_back(mask_);
+	}
+
+	unsigned long long num_matches = scan_mapped<T>(map, start, stop, values, masks, num_buffer_values, convert_);
+	std::cout << "\n Searched " << stop - start << " bytes from offset " << start << ", found " << num_matches << " matches\n";
+
+	munmap((void*)map, file_size);
+	return 0;
+}
+
 int main(int argc, char *argv[]){
 	if(argc < 2){
 		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected 1, received " << argc-1 << ".\n";
@@ -306,20 +478,19 @@ int main(int argc, char *argv[]){
 		return 1;
 	}
 	
-	CLoption valid_opt[6];
+	CLoption valid_opt[11];
 	valid_opt[0].Set("type", true, false);
 	valid_opt[1].Set("raw", false, false);
 	valid_opt[2].Set("convert", false, false);
 	valid_opt[3].Set("search", true, false);
 	valid_opt[4].Set("zero", false, false);
 	valid_opt[5].Set("word", true, false);
-	if(!get_opt(argc, argv, valid_opt, 6, 2)){ return 1; }
-	
-	std::ifstream input(argv[1], std::ios::binary);
-	if(!input.is_open()){
-		std::cout << " Error: failed to open input file\n";
-		return 1;
-	}
+	valid_opt[6].Set("map", false, false);
+	valid_opt[7].Set("buffers", false, false);
+	valid_opt[8].Set("pattern", true, false);
+	valid_opt[9].Set("offset", true, false);
+	valid_opt[10].Set("length", true, false);
+	if(!get_opt(argc, argv, valid_opt, 11, 2)){ return 1; }
 
 	int buffer_select = 0;
 	int search_int = 0;
@@ -354,14 +525,48 @@ int main(int argc, char *argv[]){
 	}
 	show_zero = true;
 
-	unsigned int good_buff_count;
-	unsigned int total_count;
-	unsigned int buff_count;
+	unsigned long long offset = 0;
+	unsigned long long length = 0;
+	if(valid_opt[9].is_active){ offset = strtoull(valid_opt[9].value.c_str(), NULL, 0); }
+	if(valid_opt[10].is_active){ length = strtoull(valid_opt[10].value.c_str(), NULL, 0); }
+
+	// Memory mapped search mode. Only the offsets of matching words are printed
+	if(valid_opt[6].is_active || valid_opt[7].is_active || valid_opt[8].is_active){
+		bool do_pattern = (do_search || valid_opt[8].is_active);
+		unsigned long long pattern = (unsigned int)search_int;
+		unsigned long long mask = (unsigned long long)-1;
+		if(valid_opt[8].is_active){
+			std::string arg = valid_opt[8].value;
+			size_t index = arg.find('/');
+			pattern = strtoull(arg.substr(0, index).c_str(), NULL, 0);
+			if(index != std::string::npos){ mask = strtoull(arg.substr(index+1).c_str(), NULL, 0); }
+			std::cout << " Searching for pattern " << convert_to_hex(pattern) << " with mask " << convert_to_hex(mask) << "\n";
+		}
+		if(!do_pattern && !valid_opt[7].is_active){
+			std::cout << " Error: --map requires --buffers, --pattern or --search\n";
+			return 1;
+		}
+		if(word_size == 1){ return run_mapped<unsigned char>(argv[1], offset, length, valid_opt[7].is_active, do_pattern, pattern, mask, convert); }
+		else if(word_size == 2){ return run_mapped<unsigned short>(argv[1], offset, length, valid_opt[7].is_active, do_pattern, pattern, mask, convert); }
+		else if(word_size == 4){ return run_mapped<unsigned int>(argv[1], offset, length, valid_opt[7].is_active, do_pattern, pattern, mask, convert); }
+		return run_mapped<unsigned long long>(argv[1], offset, length, valid_opt[7].is_active, do_pattern, pattern, mask, convert);
+	}
+	
+	std::ifstream input(argv[1], std::ios::binary);
+	if(!input.is_open()){
+		std::cout << " Error: failed to open input file\n";
+		return 1;
+	}
+	if(offset > 0){ input.seekg(offset - (offset % word_size), std::ios::beg); }
+
+	unsigned int good_buff_count = 0;
+	unsigned int total_count = 0;
+	unsigned int buff_count = 0;
 
-	if(word_size == 1){ go<unsigned char>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select); }
-	else if(word_size == 2){ go<unsigned short>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select); }
-	else if(word_size == 4){ go<unsigned int>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select); }
-	else{ go<unsigned long long>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select); }
+	if(word_size == 1){ go<unsigned char>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select, length / word_size); }
+	else if(word_size == 2){ go<unsigned short>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select, length / word_size); }
+	else if(word_size == 4){ go<unsigned int>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select, length / word_size); }
+	else{ go<unsigned long long>(&input, buff_count, good_buff_count, total_count, show_raw, convert, show_zero, do_search, search_int, buffer_select, length / word_size); }
 
 	input.close();
 	
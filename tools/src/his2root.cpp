@@ -5,20 +5,47 @@
 // SYNTAX: ./his2root [filename] [prefix] <options>
 
 #include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
 
 #include "TNamed.h"
 #include "TFile.h"
 #include "TH1I.h"
 #include "TH2I.h"
+#include "RVersion.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+#include <thread>
+#include "TROOT.h"
+#define HIS2ROOT_THREADS
+#endif
 
 #include "HisFile.h"
 
+#define BATCH_SIZE 256 // Number of histograms converted between writes
+
 OutputHisFile *output_his;
 
 void help(char * prog_name_){
 	std::cout << "  SYNTAX: " << prog_name_ << " [prefix] <options>\n";
 	std::cout << "   Available options:\n";
 	std::cout << "    --verbose | Print .drr histogram information.\n";
+	std::cout << "    -j <N>    | Convert histograms using N threads (default = 1).\n";
+}
+
+/// Convert every num_threads_'th histogram of a batch, starting with first_
+void convert(HisFile *his_file_, size_t start_, size_t stop_, size_t first_, size_t num_threads_, std::vector<TH1*> *output_){
+	HisView view;
+	for(size_t i = start_ + first_; i < stop_; i += num_threads_){
+		TH1 *hist = NULL;
+		if(his_file_->GetView(i, view)){
+			if(view.entry->hisDim == 1){ hist = HisFile::MakeTH1(view); }
+			else if(view.entry->hisDim == 2){ hist = HisFile::MakeTH2(view); }
+		}
+		output_->at(i - start_) = hist;
+	}
 }
 
 int main(int argc, char *argv[]){
@@ -29,9 +56,17 @@ int main(int argc, char *argv[]){
 	}
 
 	bool verbose = false;
+	unsigned int num_threads = 1;
 	int arg_index = 2;
 	while(arg_index < argc){
 		if(strcmp(argv[arg_index], "--verbose") == 0){ verbose = true; }
+		else if(strcmp(argv[arg_index], "-j") == 0){
+			if(++arg_index >= argc || atoi(argv[arg_index]) <= 0){
+				std::cout << " Error: -j requires a positive number of threads\n";
+				return 1;
+			}
+			num_threads = atoi(argv[arg_index]);
+		}
 		else{ 
 			std::cout << " Error: Encountered unrecognized option '" << argv[arg_index] << "'\n";
 			return 1;
@@ -67,29 +102,72 @@ int main(int argc, char *argv[]){
 	name->Delete();
 	
 	int count = 0;
-	while(his_file.GetNextHistogram() > 0){
-		if(verbose){ 
-			his_file.PrintEntry(); 
-			std::cout << std::endl;
-		}
-		if(his_file.GetDimension() == 1){
-			TH1I *h1 = his_file.GetTH1();
-			if(h1){
-				h1->Write();
-				h1->Delete();
+	HisView first_view;
+	if(!verbose && his_file.GetView(0, first_view)){
+		// Convert the histograms straight from the mapped .his file in batches. The
+		// conversion is done in parallel, the histograms are written in file order
+#ifdef HIS2ROOT_THREADS
+		if(num_threads > 1){ ROOT::EnableThreadSafety(); }
+#else
+		if(num_threads > 1){ std::cout << " Warning! Multithreading requires root 6.08 or newer\n"; }
+		num_threads = 1;
+#endif
+		TH1::AddDirectory(false);
+		std::vector<TH1*> batch;
+		for(size_t start = 0; start < his_file.GetNumHistograms(); start += BATCH_SIZE){
+			size_t stop = start + BATCH_SIZE;
+			if(stop > his_file.GetNumHistograms()){ stop = his_file.GetNumHistograms(); }
+			batch.assign(stop - start, NULL);
+#ifdef HIS2ROOT_THREADS
+			std::vector<std::thread> threads;
+			for(size_t i = 1; i < num_threads; i++){
+				threads.push_back(std::thread(convert, &his_file, start, stop, i, (size_t)num_threads, &batch));
 			}
-			count++;
-		}
-		else if(his_file.GetDimension() == 2){
-			TH2I *h2 = his_file.GetTH2();
-			if(h2){
-				h2->Write();
-				h2->Delete();
+			convert(&his_file, start, stop, 0, num_threads, &batch);
+			for(std::vector<std::thread>::iterator iter = threads.begin(); iter != threads.end(); iter++){ iter->join(); }
+#else
+			convert(&his_file, start, stop, 0, 1, &batch);
+#endif
+			for(size_t i = start; i < stop; i++){
+				TH1 *hist = batch.at(i - start);
+				if(hist){
+					hist->Write();
+					delete hist;
+					count++;
+				}
+				else{
+					his_file.GetEntry(i);
+					if(his_file.GetDimension() == 1 || his_file.GetDimension() == 2){ std::cout << " Warning! Failed to read histogram id = " << his_file.GetHisID() << std::endl; }
+					else{ std::cout << " Warning! Unsupported histogram dimension (" << his_file.GetDimension() << ") for id = " << his_file.GetHisID() << std::endl; }
+				}
 			}
-			count++;
 		}
-		else{
-			std::cout << " Warning! Unsupported histogram dimension (" << his_file.GetDimension() << ") for id = " << his_file.GetHisID() << std::endl;
+	}
+	else{
+		while(his_file.GetNextHistogram() > 0){
+			if(verbose){ 
+				his_file.PrintEntry(); 
+				std::cout << std::endl;
+			}
+			if(his_file.GetDimension() == 1){
+				TH1I *h1 = his_file.GetTH1();
+				if(h1){
+					h1->Write();
+					h1->Delete();
+				}
+				count++;
+			}
+			else if(his_file.GetDimension() == 2){
+				TH2I *h2 = his_file.GetTH2();
+				if(h2){
+					h2->Write();
+					h2->Delete();
+				}
+				count++;
+			}
+			else{
+				std::cout << " Warning! Unsupported histogram dimension (" << his_file.GetDimension() << ") for id = " << his_file.GetHisID() << std::endl;
+			}
 		}
 	}
 	
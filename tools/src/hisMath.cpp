@@ -0,0 +1,119 @@
+// hisMath.cpp
+// Add, subtract or scale damm .his files bin by bin
+// SYNTAX: ./hisMath [output] [input] <[+|-][factor*]input ...> <options>
+
+#include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "HisFile.h"
+
+OutputHisFile *output_his;
+
+void help(char * prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [output] [input] <[+|-][factor*]input ...> <options>\n";
+	std::cout << "   Each input is the prefix of a .his/.drr pair. The output is the sum of all inputs,\n";
+	std::cout << "   each multiplied by its factor (default = 1). e.g. " << prog_name_ << " sum run1 run2 -0.5*bkg\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --ids <first>[-<last>] | Only combine histograms in this id range (may be repeated).\n";
+	std::cout << "                           | All other histograms are copied from the first input.\n";
+	std::cout << "    --wrap                 | Let cells wrap around on overflow, as a scan does (default = clamp).\n";
+	std::cout << "    -j <N>                 | Combine histograms using N threads (default = 1).\n";
+}
+
+/// Parse a term of the form [+|-][factor*]prefix. Return false if the factor is invalid
+bool parse_term(std::string term_, double sign_, std::string &prefix_, double &weight_){
+	if(term_[0] == '+'){ term_ = term_.substr(1); }
+	else if(term_[0] == '-'){
+		sign_ = -sign_;
+		term_ = term_.substr(1);
+	}
+
+	weight_ = sign_;
+	size_t index = term_.find('*');
+	if(index != std::string::npos){
+		char *end = NULL;
+		std::string factor = term_.substr(0, index);
+		weight_ *= strtod(factor.c_str(), &end);
+		if(factor.empty() || *end != '\0'){ return false; }
+		term_ = term_.substr(index+1);
+	}
+
+	prefix_ = term_;
+	return !prefix_.empty();
+}
+
+int main(int argc, char *argv[]){
+	if(argc < 3){
+		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected at least 2, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	std::string output_prefix(argv[1]);
+	std::vector<std::string> inputs;
+	std::vector<double> weights;
+	HisCombineOptions options;
+	options.saturate = true;
+
+	double sign = 1.0;
+	int arg_index = 2;
+	while(arg_index < argc){
+		if(strcmp(argv[arg_index], "--ids") == 0){
+			if(++arg_index >= argc){
+				std::cout << " Error: --ids requires a histogram id range\n";
+				return 1;
+			}
+			std::string range(argv[arg_index]);
+			size_t index = range.find('-');
+			unsigned int first = strtoul(range.substr(0, index).c_str(), NULL, 10);
+			unsigned int last = (index != std::string::npos ? strtoul(range.substr(index+1).c_str(), NULL, 10) : first);
+			options.id_ranges.push_back(std::make_pair(first, last));
+		}
+		else if(strcmp(argv[arg_index], "--wrap") == 0){ options.saturate = false; }
+		else if(strcmp(argv[arg_index], "-j") == 0){
+			if(++arg_index >= argc || atoi(argv[arg_index]) <= 0){
+				std::cout << " Error: -j requires a positive number of threads\n";
+				return 1;
+			}
+			options.num_threads = atoi(argv[arg_index]);
+		}
+		else if(strcmp(argv[arg_index], "+") == 0){ sign = 1.0; }
+		else if(strcmp(argv[arg_index], "-") == 0){ sign = -1.0; }
+		else{
+			std::string prefix;
+			double weight;
+			if(!parse_term(argv[arg_index], sign, prefix, weight)){
+				std::cout << " Error: Invalid input term '" << argv[arg_index] << "'\n";
+				return 1;
+			}
+			inputs.push_back(prefix);
+			weights.push_back(weight);
+			sign = 1.0;
+		}
+		arg_index++;
+	}
+
+	if(inputs.empty()){
+		std::cout << " Error: No input files specified\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	for(size_t i = 0; i < inputs.size(); i++){
+		std::cout << "  " << (weights.at(i) < 0 ? "- " : "+ ") << (weights.at(i) < 0 ? -weights.at(i) : weights.at(i)) << " * " << inputs.at(i) << std::endl;
+	}
+
+	size_t overflows = 0;
+	if(!CombineHisFiles(inputs, weights, output_prefix, options, overflows)){
+		std::cout << " Error: Failed to write '" << output_prefix << ".his'\n";
+		return 1;
+	}
+
+	if(overflows > 0){ std::cout << " Warning! " << overflows << " cells were out of range and were " << (options.saturate ? "clamped" : "wrapped around") << std::endl; }
+	std::cout << " Done! Wrote '" << output_prefix << ".his'\n";
+
+	return 0;
+}
@@ -2,9 +2,12 @@
 // C. Thornsberry
 // Jul. 2nd, 2015
 // Read information about histograms in a damm .his file
-// SYNTAX: ./his2root [prefix] <options>
+// SYNTAX: ./hisReader [prefix] <--counts>
 
 #include <iostream>
+#include <iomanip>
+
+#include <string.h>
 
 #include "HisFile.h"
 
@@ -13,7 +16,8 @@ OutputHisFile *output_his;
 int main(int argc, char *argv[]){
 	if(argc < 2){
 		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected 1, received " << argc-1 << ".\n";
-		std::cout << "  SYNTAX: " << argv[0] << " [prefix]\n";
+		std::cout << "  SYNTAX: " << argv[0] << " [prefix] <--counts>\n";
+		std::cout << "   --counts | Print the id, the total number of counts and a checksum of the bins of each histogram.\n";
 		return 1;
 	}
 
@@ -23,10 +27,34 @@ int main(int argc, char *argv[]){
 		return 1;
 	}
 	
+	// One line per histogram, for comparing the output of two scans. The checksum
+	// (64-bit FNV-1a of the index and value of each non-empty bin) changes when
+	// counts move between bins, even if the total does not
+	if(argc > 2 && strcmp(argv[2], "--counts") == 0){
+		HisView view;
+		for(size_t i = 0; i < his_file.GetNumHistograms(); i++){
+			if(!his_file.GetView(i, view)){ continue; }
+			unsigned long long counts = 0;
+			unsigned long long checksum = 0xCBF29CE484222325ULL;
+			for(size_t bin = 0; bin < view.size; bin++){ 
+				unsigned int value = view.Get(bin);
+				if(value == 0){ continue; }
+				counts += value; 
+				unsigned long long words[2] = {bin, value};
+				for(int j = 0; j < 2; j++){
+					for(int k = 0; k < 8; k++){ checksum = (checksum ^ ((words[j] >> (8*k)) & 0xFF)) * 0x100000001B3ULL; }
+				}
+			}
+			std::cout << std::setw(6) << view.entry->hisID << " " << counts << " " << std::hex << std::setw(16) << std::setfill('0') << checksum;
+			std::cout << std::dec << std::setfill(' ') << std::endl;
+		}
+		return 0;
+	}
+
 	his_file.PrintHeader();
 	std::cout << std::endl;
 	
-	while(his_file.GetNextHistogram(false) > 0){
+	while(his_file.GetNextHistogram(true) > 0){ // Only the .drr entries are printed, no need to copy the data
 		his_file.PrintEntry(); 
 		std::cout << std::endl;
 	}
@@ -0,0 +1,109 @@
+/** \file ldfIndex.cpp
+  *
+  * \brief Build or display the spill index of an ldf or pld file and use it
+  *  to extract time ranges or split the file into spill-aligned pieces
+*/
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SpillIndex.hpp"
+
+void help(char *prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [filename] <options>\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --rebuild                        | Rebuild the index even if it is up to date.\n";
+	std::cout << "    --verbose                        | Print information about every spill.\n";
+	std::cout << "    --spills <first>-<last> <output> | Write spills first to last to a new file.\n";
+	std::cout << "    --skip <first>-<last> <output>   | Write all spills except first to last to a new file.\n";
+	std::cout << "    --time <start>-<stop> <output>   | Write the spills between start and stop (in seconds) to a new file.\n";
+	std::cout << "    --split <N> <prefix>             | Split the file into N spill-aligned pieces.\n";
+}
+
+/// Parse a range of the form <first>-<last>
+bool parse_range(const char *arg_, double &first_, double &last_){
+	std::string range(arg_);
+	size_t index = range.find('-', 1);
+	if(index == std::string::npos){ return false; }
+	first_ = strtod(range.substr(0, index).c_str(), NULL);
+	last_ = strtod(range.substr(index+1).c_str(), NULL);
+	return (last_ >= first_);
+}
+
+int main(int argc, char *argv[]){
+	if(argc < 2){
+		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected at least 1, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	bool rebuild = false;
+	bool verbose = false;
+	std::string mode = "";
+	std::string output = "";
+	double first = 0.0, last = 0.0;
+	int arg_index = 2;
+	while(arg_index < argc){
+		if(strcmp(argv[arg_index], "--rebuild") == 0){ rebuild = true; }
+		else if(strcmp(argv[arg_index], "--verbose") == 0){ verbose = true; }
+		else if(strcmp(argv[arg_index], "--spills") == 0 || strcmp(argv[arg_index], "--skip") == 0 || strcmp(argv[arg_index], "--time") == 0 || strcmp(argv[arg_index], "--split") == 0){
+			mode = argv[arg_index];
+			if(arg_index + 2 >= argc){
+				std::cout << " Error: " << mode << " requires two arguments\n";
+				return 1;
+			}
+			if(mode == "--split"){
+				first = atoi(argv[arg_index+1]);
+				if(first <= 0){
+					std::cout << " Error: --split requires a positive number of pieces\n";
+					return 1;
+				}
+			}
+			else if(!parse_range(argv[arg_index+1], first, last)){
+				std::cout << " Error: Invalid range '" << argv[arg_index+1] << "'\n";
+				return 1;
+			}
+			output = argv[arg_index+2];
+			arg_index += 2;
+		}
+		else{
+			std::cout << " Error: Encountered unrecognized option '" << argv[arg_index] << "'\n";
+			return 1;
+		}
+		arg_index++;
+	}
+
+	SpillIndex index;
+	if(!index.Open(argv[1], rebuild)){ return 1; }
+
+	if(mode.empty()){
+		index.Print(verbose);
+		return 0;
+	}
+
+	bool retval = true;
+	if(mode == "--split"){
+		std::vector<std::string> files;
+		retval = index.Split((size_t)first, output, files);
+		for(std::vector<std::string>::iterator iter = files.begin(); iter != files.end(); iter++){
+			std::cout << "  Wrote '" << *iter << "'\n";
+		}
+	}
+	else{
+		std::vector<SpillRange> ranges;
+		if(mode == "--spills"){ ranges.push_back(SpillRange((size_t)first, (size_t)last)); }
+		else if(mode == "--skip"){ ranges = index.Exclude(SpillRange((size_t)first, (size_t)last)); }
+		else{ ranges = index.FindTimeRange(first, last); }
+
+		if(ranges.empty()){
+			std::cout << " Error: No spills were selected\n";
+			return 1;
+		}
+		retval = index.Write(output, ranges);
+		if(retval){ std::cout << "  Wrote '" << output << "'\n"; }
+	}
+
+	return (retval ? 0 : 1);
+}
@@ -0,0 +1,515 @@
+/** \file pixieGen.cpp
+  *
+  * \brief Write an ldf file of synthetic Pixie16 (Rev F) events for
+  *  benchmarking the analysis without real data
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SyntheticPulse.hpp"
+
+#define LDF_BUFFER_WORDS 8194 // ldf buffer size including the 2 word buffer header
+#define LDF_END_BUFFER 0xFFFFFFFF
+#define MAX_CHUNK_WORDS 8000 // Largest spill chunk written to a single buffer
+
+#define BUFFER_DATA 0x41544144 // "DATA"
+#define BUFFER_HEAD 0x44414548 // "HEAD"
+#define BUFFER_DIR 0x20524944 // "DIR "
+#define BUFFER_EOF 0x20464F45 // "EOF "
+
+#define NUM_CHANNELS 16 // Channels per pixie module
+#define HEADER_WORDS 4 // Rev F event header length (no onboard sums)
+#define MAX_EVENT_WORDS 0xFFF // Largest event length that fits the header (mask 0x1FFE0000)
+#define MAX_TRACE_LEN (2 * (MAX_EVENT_WORDS - HEADER_WORDS)) // Two samples per word
+#define CLOCK_IN_SECONDS 8e-9 // One pixie clock tick
+#define CLOVER_LEAVES 4 // Crystals per clover, in order of location as in GeProcessor
+#define LOW_GAIN_RATIO 2.0 // High gain to low gain energy ratio of clover channels
+
+/// A channel which produces events
+struct GenChannel{
+	unsigned int module;
+	unsigned int channel;
+	PulseShape shape;
+	int partner; /// Index of the low gain channel of a clover high gain channel (-1 if none)
+	int clover; /// Clover number of a high gain channel (-1 if not a clover)
+	bool trigger; /// Channel may be picked for an event (false for clover low gain)
+
+	GenChannel(unsigned int module_, unsigned int channel_, PulseShape shape_) : module(module_), channel(channel_), shape(shape_), partner(-1), clover(-1), trigger(true) {}
+};
+
+/// A single channel event waiting to be written
+struct GenEvent{
+	unsigned long long time;
+	size_t index; /// Index of the channel in the channel list
+	unsigned int energy;
+	unsigned int cfd;
+
+	bool operator < (const GenEvent &rhs_) const { return time < rhs_.time; }
+};
+
+void help(char *prog_name_){
+	std::cout << "  SYNTAX: " << prog_name_ << " [output.ldf] <options>\n";
+	std::cout << "   Available options:\n";
+	std::cout << "    --map <filename>   | Generate events for the channels in a map2.txt style map file.\n";
+	std::cout << "    --modules <N>      | Generate events for all channels of N modules (default = 1).\n";
+	std::cout << "                       | With a map file, a module wildcard covers N modules.\n";
+	std::cout << "    --spills <N>       | Number of spills to write (default = 10).\n";
+	std::cout << "    --events <N>       | Number of physics events per spill (default = 10000).\n";
+	std::cout << "    --rate <Hz>        | Mean physics event rate (default = 10000).\n";
+	std::cout << "    --mult <M>         | Mean number of channels per physics event (default = 2).\n";
+	std::cout << "    --window <ticks>   | Maximum time spread of the channels in an event (default = 25).\n";
+	std::cout << "    --trace <N>        | Trace length in samples, 0 for no traces (default = 0).\n";
+	std::cout << "    --pulse <fast|slow>| Pulse shape used without a map file (default = fast).\n";
+	std::cout << "    --noise <sigma>    | Trace noise in adc channels (default = 3).\n";
+	std::cout << "    --seed <N>         | Random number seed (default = 1).\n";
+	std::cout << "    --scatter <P>      | Probability that a clover hit is shared with a second crystal (default = 0.25).\n";
+	std::cout << "   ge:clover_high channels of the map fire together with the ge:clover_low channel\n";
+	std::cout << "   of the same location, which gets 1/" << LOW_GAIN_RATIO << " of the energy.\n";
+}
+
+/** Expand a module or channel designation from a map file (n, m-n, with an
+  * optional trailing e or o for even or odd numbers only). A '*' is expanded
+  * to all of 0 to max_.
+  */
+bool expand_range(std::string str_, unsigned int max_, std::vector<unsigned int> &values_){
+	values_.clear();
+	if(str_ == "*"){
+		for(unsigned int i = 0; i <= max_; i++){ values_.push_back(i); }
+		return true;
+	}
+
+	int parity = -1;
+	if(!str_.empty() && (str_[str_.size()-1] == 'e' || str_[str_.size()-1] == 'o')){
+		parity = (str_[str_.size()-1] == 'e' ? 0 : 1);
+		str_.erase(str_.size()-1);
+	}
+
+	char *end = NULL;
+	unsigned int first = strtoul(str_.c_str(), &end, 10);
+	unsigned int last = first;
+	if(end == str_.c_str()){ return false; }
+	if(*end == '-'){
+		const char *start = end + 1;
+		last = strtoul(start, &end, 10);
+		if(end == start){ return false; }
+	}
+	if(*end != '\0' || last < first){ return false; }
+
+	for(unsigned int i = first; i <= last; i++){
+		if(parity < 0 || (int)(i % 2) == parity){ values_.push_back(i); }
+	}
+	return true;
+}
+
+/// Read the channels from a map2.txt style map file. Module wildcards cover modules 0 to num_modules_-1
+bool read_map(const char *fname_, unsigned int num_modules_, std::vector<GenChannel> &channels_){
+	std::ifstream file(fname_);
+	if(!file.good()){
+		std::cout << " Error: Failed to open map file '" << fname_ << "'\n";
+		return false;
+	}
+
+	bool used[14][NUM_CHANNELS];
+	memset(used, 0, sizeof(used));
+
+	// Locations of the clover channels, assigned as in MapFile
+	std::map<std::string, int> next_location;
+	std::map<int, size_t> high_gain, low_gain;
+
+	// Wildcard lines are processed after all single channel designations
+	std::vector<std::string> lines, wildcards;
+	std::string line;
+	while(std::getline(file, line)){
+		size_t comment = line.find('#');
+		if(comment != std::string::npos){ line.erase(comment); }
+		if(line.find('*') != std::string::npos){ wildcards.push_back(line); }
+		else{ lines.push_back(line); }
+	}
+	lines.insert(lines.end(), wildcards.begin(), wildcards.end());
+
+	for(std::vector<std::string>::iterator iter = lines.begin(); iter != lines.end(); iter++){
+		std::istringstream stream(*iter);
+		std::string mod_str, chan_str, type, subtype, location_str;
+		if(!(stream >> mod_str >> chan_str >> type)){ continue; }
+		if(mod_str == "MOD"){ continue; } // Column titles
+
+		// An optional subtype, then an optional starting location
+		stream >> subtype;
+		if(subtype.empty() || subtype.find_first_not_of("0123456789") == std::string::npos){ location_str = subtype; subtype = type; }
+		else{ stream >> location_str; }
+		if(subtype == "--"){ subtype = type; }
+		std::string key = type + ":" + subtype;
+		int location = next_location[key];
+		if(!location_str.empty() && location_str.find_first_not_of("0123456789") == std::string::npos){ location = atoi(location_str.c_str()); }
+
+		std::vector<unsigned int> modules, chans;
+		if(!expand_range(mod_str, num_modules_-1, modules) || !expand_range(chan_str, NUM_CHANNELS-1, chans)){
+			std::cout << " Warning! Skipping unrecognized map entry '" << *iter << "'\n";
+			continue;
+		}
+
+		PulseShape shape = shape_for_type(type);
+		for(std::vector<unsigned int>::iterator mod = modules.begin(); mod != modules.end(); mod++){
+			if(*mod >= 14){ continue; }
+			for(std::vector<unsigned int>::iterator chan = chans.begin(); chan != chans.end(); chan++){
+				if(*chan >= NUM_CHANNELS || used[*mod][*chan]){ continue; }
+				used[*mod][*chan] = true;
+				if(type != "ignore"){
+					if(key == "ge:clover_high"){ high_gain[location] = channels_.size(); }
+					else if(key == "ge:clover_low"){ low_gain[location] = channels_.size(); }
+					channels_.push_back(GenChannel(*mod, *chan, shape));
+				}
+				next_location[key] = std::max(next_location[key], ++location);
+			}
+		}
+	}
+
+	// Pair up the two gains of each crystal
+	unsigned int leaf = 0;
+	for(std::map<int, size_t>::iterator iter = high_gain.begin(); iter != high_gain.end(); iter++){
+		GenChannel &chan = channels_[iter->second];
+		chan.clover = leaf++ / CLOVER_LEAVES;
+		if(low_gain.count(iter->first)){ chan.partner = low_gain[iter->first]; }
+	}
+	for(std::map<int, size_t>::iterator iter = low_gain.begin(); iter != low_gain.end(); iter++){
+		channels_[iter->second].trigger = false;
+	}
+	if(!high_gain.empty()){ std::cout << "  Clovers:  " << (leaf + CLOVER_LEAVES - 1) / CLOVER_LEAVES << " (" << low_gain.size() << " low gain channels)\n"; }
+
+	return !channels_.empty();
+}
+
+/** Append the words of one spill to spill_. Each module with events gets a
+  * block of [block length, module number] followed by its events in time order.
+  * The spill ends with a [2, 9999] block.
+  */
+void write_spill(std::vector<GenEvent> &events_, const std::vector<GenChannel> &channels_, unsigned int trace_len_, double noise_, GenRandom &rand_, std::vector<unsigned int> &spill_){
+	std::stable_sort(events_.begin(), events_.end());
+
+	unsigned int max_module = 0;
+	for(std::vector<GenChannel>::const_iterator iter = channels_.begin(); iter != channels_.end(); iter++){
+		max_module = std::max(max_module, iter->module);
+	}
+
+	std::vector<unsigned int> trace(trace_len_);
+	unsigned int event_len = HEADER_WORDS + trace_len_ / 2;
+	spill_.clear();
+	for(unsigned int mod = 0; mod <= max_module; mod++){
+		size_t block_start = spill_.size();
+		spill_.push_back(0);
+		spill_.push_back(mod);
+		for(std::vector<GenEvent>::iterator event = events_.begin(); event != events_.end(); event++){
+			const GenChannel &chan = channels_.at(event->index);
+			if(chan.module != mod){ continue; }
+
+			// Rev F header. Slot numbers start at 2 and the crate is 0
+			spill_.push_back((event_len << 17) | (HEADER_WORDS << 12) | ((mod + 2) << 4) | chan.channel);
+			spill_.push_back((unsigned int)(event->time & 0xFFFFFFFF));
+			spill_.push_back((unsigned int)((event->time >> 32) & 0xFFFF) | (event->cfd << 16));
+			spill_.push_back((trace_len_ << 16) | (event->energy & 0xFFFF));
+
+			if(trace_len_ > 0){
+				make_trace(chan.shape, event->energy / 8.0, noise_, rand_, trace);
+				for(unsigned int i = 0; i < trace_len_; i += 2){ spill_.push_back(trace[i] | (trace[i+1] << 16)); }
+			}
+		}
+		spill_.at(block_start) = spill_.size() - block_start;
+	}
+	spill_.push_back(2);
+	spill_.push_back(9999);
+}
+
+/// Return true if channel index_ already has a hit in events_ at or after first_
+bool has_hit(const std::vector<GenEvent> &events_, size_t first_, size_t index_){
+	for(size_t i = first_; i < events_.size(); i++){
+		if(events_[i].index == index_){ return true; }
+	}
+	return false;
+}
+
+/// Add a hit, and the low gain hit of a clover high gain channel
+void add_hit(std::vector<GenEvent> &events_, const std::vector<GenChannel> &channels_, size_t index_, unsigned long long time_, unsigned int energy_, GenRandom &rand_){
+	GenEvent event;
+	event.index = index_;
+	event.time = time_;
+	event.energy = std::min(energy_, 32767U);
+	event.cfd = rand_.Next() & 0x3FFF; // Bit 30 of the word is the cfd trigger source
+	events_.push_back(event);
+
+	if(channels_[index_].partner >= 0){
+		event.index = channels_[index_].partner;
+		event.time = time_ + rand_.Next() % 2;
+		event.energy = (unsigned int)(event.energy / LOW_GAIN_RATIO + rand_.Uniform());
+		event.cfd = rand_.Next() & 0x3FFF;
+		events_.push_back(event);
+	}
+}
+
+/// Writes ldf buffers, splitting each spill into chunks which fit in a single buffer
+class LdfWriter{
+  private:
+	std::ofstream file;
+	std::vector<unsigned int> buffer;
+	size_t pos;
+	unsigned int num_buffers;
+
+	void flush(){
+		file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+		std::fill(buffer.begin() + 2, buffer.end(), LDF_END_BUFFER);
+		pos = 2;
+		num_buffers++;
+	}
+
+	void put_chunk(const unsigned int *data_, unsigned int nWords_, unsigned int total_, unsigned int number_){
+		if(pos + nWords_ + 3 > LDF_BUFFER_WORDS){ flush(); }
+		buffer[pos++] = (nWords_ + 3) * 4;
+		buffer[pos++] = total_;
+		buffer[pos++] = number_;
+		memcpy((char*)&buffer[pos], (const char*)data_, nWords_*4);
+		pos += nWords_;
+	}
+
+	/// Copy a string into the buffer as a fixed length, space padded field
+	void put_string(std::vector<unsigned int> &buff_, size_t word_, const std::string &str_, size_t length_){
+		std::string padded = str_.substr(0, length_);
+		padded.resize(length_, ' ');
+		memcpy((char*)&buff_[word_], padded.c_str(), length_);
+	}
+
+  public:
+	LdfWriter() : buffer(LDF_BUFFER_WORDS, LDF_END_BUFFER), pos(2), num_buffers(0) {}
+
+	/// Open the file and write the DIR and HEAD buffers
+	bool Open(const char *fname_, const std::string &title_){
+		file.open(fname_, std::ios::binary);
+		if(!file.good()){ return false; }
+
+		std::vector<unsigned int> head(LDF_BUFFER_WORDS, 0);
+		head[0] = BUFFER_DIR;
+		head[1] = LDF_BUFFER_WORDS - 2;
+		head[2] = LDF_BUFFER_WORDS;
+		head[6] = 1; // Run number
+		file.write((char*)&head[0], LDF_BUFFER_WORDS*4);
+
+		char date[32];
+		time_t now = time(NULL);
+		strftime(date, sizeof(date), "%m/%d/%y %H:%M", localtime(&now));
+
+		std::fill(head.begin(), head.end(), 0);
+		head[0] = BUFFER_HEAD;
+		head[1] = 64;
+		put_string(head, 2, "HHIRF", 8);
+		put_string(head, 4, "L003", 8);
+		put_string(head, 6, "LIST DATA", 16);
+		put_string(head, 10, date, 16);
+		put_string(head, 14, title_, 80);
+		head[34] = 1; // Run number
+		file.write((char*)&head[0], LDF_BUFFER_WORDS*4);
+
+		num_buffers = 2;
+		buffer[0] = BUFFER_DATA;
+		buffer[1] = LDF_BUFFER_WORDS - 2;
+		return file.good();
+	}
+
+	/// Write a complete spill
+	void Write(const std::vector<unsigned int> &spill_){
+		unsigned int total = (spill_.size() + MAX_CHUNK_WORDS - 1) / MAX_CHUNK_WORDS + 1;
+		unsigned int number = 0;
+		for(size_t i = 0; i < spill_.size(); i += MAX_CHUNK_WORDS){
+			put_chunk(&spill_[i], std::min((size_t)MAX_CHUNK_WORDS, spill_.size() - i), total, number++);
+		}
+
+		// The last chunk of a spill is a footer
+		unsigned int footer[2] = {2, 9999};
+		put_chunk(footer, 2, total, number);
+	}
+
+	/// Flush the last data buffer, write two EOF buffers and update the buffer count in the DIR buffer
+	bool Close(){
+		if(pos > 2){ flush(); }
+		std::fill(buffer.begin(), buffer.end(), LDF_END_BUFFER);
+		buffer[0] = BUFFER_EOF;
+		buffer[1] = LDF_BUFFER_WORDS - 2;
+		file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+		file.write((char*)&buffer[0], LDF_BUFFER_WORDS*4);
+		num_buffers += 2;
+
+		file.seekp(12);
+		file.write((char*)&num_buffers, 4);
+		bool retval = file.good();
+		file.close();
+		return retval;
+	}
+
+	unsigned int GetNumBuffers(){ return num_buffers; }
+};
+
+int main(int argc, char *argv[]){
+	if(argc < 2 || argv[1][0] == '-'){
+		std::cout << " Error: Invalid number of arguments to " << argv[0] << ". Expected at least 1, received " << argc-1 << ".\n";
+		help(argv[0]);
+		return 1;
+	}
+
+	const char *map_fname = NULL;
+	unsigned int num_modules = 1;
+	unsigned int num_spills = 10;
+	unsigned int events_per_spill = 10000;
+	double rate = 10000.0;
+	double multiplicity = 2.0;
+	unsigned int window = 25;
+	unsigned int trace_len = 0;
+	PulseShape pulse = FAST_PULSE;
+	double noise = 3.0;
+	unsigned long long seed = 1;
+	double scatter = 0.25;
+
+	int arg_index = 2;
+	while(arg_index < argc){
+		std::string opt(argv[arg_index]);
+		if(opt != "--map" && opt != "--modules" && opt != "--spills" && opt != "--events" && opt != "--rate" && opt != "--mult" &&
+		   opt != "--window" && opt != "--trace" && opt != "--pulse" && opt != "--noise" && opt != "--seed" && opt != "--scatter"){
+			std::cout << " Error: Encountered unrecognized option '" << opt << "'\n";
+			return 1;
+		}
+		if(++arg_index >= argc){
+			std::cout << " Error: " << opt << " requires an argument\n";
+			return 1;
+		}
+
+		const char *value = argv[arg_index];
+		if(opt == "--map"){ map_fname = value; }
+		else if(opt == "--modules"){ num_modules = atoi(value); }
+		else if(opt == "--spills"){ num_spills = atoi(value); }
+		else if(opt == "--events"){ events_per_spill = atoi(value); }
+		else if(opt == "--rate"){ rate = strtod(value, NULL); }
+		else if(opt == "--mult"){ multiplicity = strtod(value, NULL); }
+		else if(opt == "--window"){ window = atoi(value); }
+		else if(opt == "--trace"){ trace_len = atoi(value) & ~1U; } // Two samples per word
+		else if(opt == "--noise"){ noise = strtod(value, NULL); }
+		else if(opt == "--seed"){ seed = strtoull(value, NULL, 0); }
+		else if(opt == "--scatter"){ scatter = strtod(value, NULL); }
+		else if(strcmp(value, "fast") == 0){ pulse = FAST_PULSE; }
+		else if(strcmp(value, "slow") == 0){ pulse = SLOW_PULSE; }
+		else{
+			std::cout << " Error: Unknown pulse shape '" << value << "'\n";
+			return 1;
+		}
+		arg_index++;
+	}
+
+	if(num_modules == 0 || num_modules > 14 || num_spills == 0 || events_per_spill == 0 || rate <= 0.0 || multiplicity <= 0.0){
+		std::cout << " Error: Invalid generator settings\n";
+		return 1;
+	}
+
+	if(trace_len > MAX_TRACE_LEN){
+		std::cout << " Error: Trace length " << trace_len << " does not fit the event header, the maximum is " << MAX_TRACE_LEN << "\n";
+		return 1;
+	}
+
+	std::vector<GenChannel> channels;
+	if(map_fname){
+		if(!read_map(map_fname, num_modules, channels)){ return 1; }
+	}
+	else{
+		for(unsigned int mod = 0; mod < num_modules; mod++){
+			for(unsigned int chan = 0; chan < NUM_CHANNELS; chan++){ channels.push_back(GenChannel(mod, chan, pulse)); }
+		}
+	}
+
+	LdfWriter writer;
+	if(!writer.Open(argv[1], "Synthetic pixie16 data")){
+		std::cout << " Error: Failed to open output file '" << argv[1] << "'\n";
+		return 1;
+	}
+
+	// Channels which start hits, and the crystals of each clover
+	std::vector<size_t> triggers;
+	std::vector<std::vector<size_t> > clovers;
+	for(size_t i = 0; i < channels.size(); i++){
+		if(channels[i].trigger){ triggers.push_back(i); }
+		if(channels[i].clover >= 0){
+			if(clovers.size() <= (size_t)channels[i].clover){ clovers.resize(channels[i].clover + 1); }
+			clovers[channels[i].clover].push_back(i);
+		}
+	}
+	if(triggers.empty()){
+		std::cout << " Error: No channels to generate events for\n";
+		return 1;
+	}
+
+	GenRandom rand(seed);
+	std::vector<GenEvent> events;
+	std::vector<unsigned int> spill;
+	unsigned long long time = 1000000; // Pixie clock ticks
+	unsigned long long mean_ticks = (unsigned long long)(1.0 / (rate * CLOCK_IN_SECONDS));
+	unsigned long long total_events = 0, total_chans = 0, total_words = 0;
+	for(unsigned int s = 0; s < num_spills; s++){
+		events.clear();
+		for(unsigned int e = 0; e < events_per_spill; e++){
+			time += 1 + (unsigned long long)rand.Exponential(mean_ticks);
+
+			// Pick a set of distinct channels for this event
+			size_t first = events.size();
+			unsigned int mult = 1 + rand.Poisson(multiplicity - 1.0);
+			unsigned int hits = 0; // Distinct trigger channels used, including shared clover hits
+			for(unsigned int m = 0; m < mult && hits < triggers.size(); m++){
+				size_t index;
+				do{ index = triggers[rand.Next() % triggers.size()]; }
+				while(has_hit(events, first, index));
+
+				unsigned long long hit_time = time + (m > 0 ? rand.Next() % (window + 1) : 0);
+				unsigned int energy = 10 + (unsigned int)rand.Exponential(4000.0);
+
+				// Share a clover hit with a neighboring crystal (for addback)
+				int clover = channels[index].clover;
+				if(clover >= 0 && clovers[clover].size() > 1 && rand.Uniform() < scatter){
+					size_t other = clovers[clover][rand.Next() % clovers[clover].size()];
+					if(other != index && !has_hit(events, first, other)){
+						unsigned int shared = (unsigned int)(energy * (0.2 + 0.6 * rand.Uniform()));
+						add_hit(events, channels, other, hit_time + rand.Next() % 4, shared, rand);
+						energy -= shared;
+						hits++;
+					}
+				}
+				add_hit(events, channels, index, hit_time, energy, rand);
+				hits++;
+			}
+		}
+
+		write_spill(events, channels, trace_len, noise, rand, spill);
+		writer.Write(spill);
+
+		total_events += events_per_spill;
+		total_chans += events.size();
+		total_words += spill.size();
+		time += mean_ticks * 10; // Readout dead time between spills
+	}
+
+	if(!writer.Close()){
+		std::cout << " Error: Failed to write output file '" << argv[1] << "'\n";
+		return 1;
+	}
+
+	std::cout << "  Channels: " << channels.size() << std::endl;
+	std::cout << "  Spills:   " << num_spills << std::endl;
+	std::cout << "  Events:   " << total_events << std::endl;
+	std::cout << "  Hits:     " << total_chans << std::endl;
+	std::cout << "  Words:    " << total_words << std::endl;
+	std::cout << "  Buffers:  " << writer.GetNumBuffers() << std::endl;
+	std::cout << "  Wrote '" << argv[1] << "'\n";
+
+	return 0;
+}
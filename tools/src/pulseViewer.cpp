@@ -11,6 +11,9 @@
 #include "TGraph.h"
 #include "TSystem.h"
 #include "TApplication.h"
+#include "TLeaf.h"
+
+#include "TraceCodec.hpp"
 
 #include <string.h>
 #include <iostream>
@@ -35,6 +38,7 @@ void help(char * prog_name_){
 	std::cout << "    --skip <num>         | Skip a number of entries between displaying pulses.\n";
 	std::cout << "    --mult-branch <name> | Explicitly specify the name of the multiplicity branch.\n";
 	std::cout << "    --fast-fwd <entry>   | Skip a specified number of entries at the beginning of the tree.\n";
+	std::cout << "    --packed             | Force decoding of the branch as TraceCodec packed traces.\n";
 }
 
 // For compilation
@@ -48,6 +52,7 @@ int main(int argc, char* argv[]){
 	int skip = 0;
 	int start_entry = 0;
 	int index = 3;
+	bool packed = false;
 	std::string mult_branch = "";
 	while(index < argc){
 		if(strcmp(argv[index], "--skip") == 0){
@@ -85,6 +90,9 @@ int main(int argc, char* argv[]){
 			}
 			std::cout << " Starting at entry no. " << start_entry << std::endl;
 		}
+		else if(strcmp(argv[index], "--packed") == 0){
+			packed = true;
+		}
 		else{ 
 			std::cout << " Error! Unrecognized option '" << argv[index] << "'!\n";
 			help(argv[0]);
@@ -100,6 +108,7 @@ int main(int argc, char* argv[]){
 	
 	// Branch variables
 	std::vector<int> wave;
+	std::vector<unsigned int> packed_wave;
 	std::vector<double> energy;
 	int mult;
 	int wave_size = 0;
@@ -120,8 +129,14 @@ int main(int argc, char* argv[]){
 	std::string branch_name = std::string(argv[2]);
 	if(mult_branch == ""){ mult_branch = GetBranch(argv[2]) + "_mult"; }
 	
+	// Traces written by RootPixieScan are packed using TraceCodec
+	TLeaf *leaf = tree->GetLeaf(branch_name.c_str());
+	if(leaf && std::string(leaf->GetTypeName()) == "vector<unsigned int>"){ packed = true; }
+	if(packed){ std::cout << " Decoding packed traces from branch '" << branch_name << "'\n"; }
+	
 	TBranch *b_wave, *b_mult;
-	tree->SetBranchAddress(branch_name.c_str(), &wave, &b_wave);
+	if(packed){ tree->SetBranchAddress(branch_name.c_str(), &packed_wave, &b_wave); }
+	else{ tree->SetBranchAddress(branch_name.c_str(), &wave, &b_wave); }
 	tree->SetBranchAddress(mult_branch.c_str(), &mult, &b_mult);
 	
 	if(!b_wave){
@@ -138,6 +153,10 @@ int main(int argc, char* argv[]){
 	// Get the pulse size
 	for(int i = 0; i < tree->GetEntries(); i++){
 		tree->GetEntry(i);
+		if(packed){
+			wave.clear();
+			TraceCodec::Decode(packed_wave, wave);
+		}
 		if(mult == 0 || wave.size() == 0){ continue; }
 		else{ 
 			wave_size = wave.size()/mult;
@@ -170,6 +189,10 @@ int main(int argc, char* argv[]){
 	std::cout << " Processing " << tree->GetEntries() << " entries\n";
 	for(int i = start_entry; i < tree->GetEntries(); i++){
 		tree->GetEntry(i);
+		if(packed){
+			wave.clear();
+			TraceCodec::Decode(packed_wave, wave);
+		}
 		if(i % 100000 == 0 && i != 0){ std::cout << " Entry no. " << i << std::endl; }
 		if(mult > 0 && count >= skip){
 			count = 0;
@@ -26,6 +26,7 @@ DataType::DataType(const std::string &type_, const std::string &name_, const std
 	SetType(type_);
 	name = name_; 
 	descrip = description_;
+	is_packed = false;
 
 	if(name.find("_wave") != std::string::npos){ trace_value = true; }
 	else{ trace_value = false; }
@@ -64,6 +65,7 @@ DataType::DataType(const std::string &entry_, const char &delimiter){
 
 void DataType::SetType(const std::string &input_){
 	is_vector = false;
+	is_packed = false;
 	
 	type = "";
 	decl = "";
@@ -73,6 +75,11 @@ void DataType::SetType(const std::string &input_){
 		is_vector = true;
 		type = input_.substr(index + 7);
 	}
+	else if((index = input_.find("packed:")) != std::string::npos){
+		is_vector = true;
+		is_packed = true;
+		type = input_.substr(index + 7);
+	}
 	else{ type = input_; }
 	
 	index = type.find("u_");
@@ -82,6 +89,10 @@ void DataType::SetType(const std::string &input_){
 	
 	if(is_vector){ decl = "std::vector<" + type + ">"; }
 	else{ decl = type; }
+	
+	// Packed traces are stored as TraceCodec words, but are appended as normal vectors
+	arg_decl = decl;
+	if(is_packed){ decl = "std::vector<unsigned int>"; }
 }
 
 void DataType::Print(){
@@ -147,10 +158,10 @@ void StructureEntry::WriteHeader(std::ofstream *file_){
 			}
 		}
 		else{ // Write the waveform variables
-			(*file_) << "const " << waveform_types.front()->decl << " &" << waveform_types.front()->name << "_";
+			(*file_) << "const " << waveform_types.front()->arg_decl << " &" << waveform_types.front()->name << "_";
 			for(std::vector<DataType*>::iterator iter = waveform_types.begin()+1; iter != waveform_types.end(); iter++){
 				if(!(*iter)->trace_value || (*iter)->mult_value){ continue; }
-				(*file_) << ", const " << (*iter)->decl << " &" << (*iter)->name << "_";
+				(*file_) << ", const " << (*iter)->arg_decl << " &" << (*iter)->name << "_";
 			}
 		}
 		(*file_) << ");\n\n";
@@ -177,7 +188,16 @@ void StructureEntry::WriteHeader(std::ofstream *file_){
 		(*file_) << "\t/// Set all values to that of other_\n";
 		(*file_) << "\t" << name << suffix[i] << " &Set(" << name << suffix[i] << " *other_);\n\n";
 
-		(*file_) << "\tClassDef(" << name << suffix[i] << ", 1); // " << name << "\n";
+		// Packed traces are stored as std::vector<unsigned int> instead of the
+		// appended type, so their classes get a new version for schema evolution
+		int class_version = 1;
+		if(i == 1){
+			for(std::vector<DataType*>::iterator iter = waveform_types.begin(); iter != waveform_types.end(); iter++){
+				if((*iter)->is_packed){ class_version = 2; }
+			}
+		}
+
+		(*file_) << "\tClassDef(" << name << suffix[i] << ", " << class_version << "); // " << name << "\n";
 		(*file_) << "};\n";
 	}
 }
@@ -230,14 +250,15 @@ void StructureEntry::WriteSource(std::ofstream *file_){
 			}
 		}
 		else if(!structure_types.front()->mult_value){ // Write the waveform variables
-			(*file_) << "const " << waveform_types.front()->decl << " &" << waveform_types.front()->name << "_";
+			(*file_) << "const " << waveform_types.front()->arg_decl << " &" << waveform_types.front()->name << "_";
 			for(std::vector<DataType*>::iterator iter = waveform_types.begin()+1; iter != waveform_types.end(); iter++){
 				if(!(*iter)->trace_value || (*iter)->mult_value){ continue; }
-				(*file_) << ", const " << (*iter)->decl << " &" << (*iter)->name << "_";
+				(*file_) << ", const " << (*iter)->arg_decl << " &" << (*iter)->name << "_";
 			}
 			(*file_) << "){\n";
 			for(std::vector<DataType*>::iterator iter = waveform_types.begin(); iter != waveform_types.end(); iter++){
 				if(!(*iter)->trace_value){ continue; }
+				else if((*iter)->is_packed){ (*file_) << "\tTraceCodec::Encode(" << (*iter)->name << "_, " << (*iter)->name << ");\n"; }
 				else if(!(*iter)->mult_value){ (*file_) << "\t" << (*iter)->name << " = " << (*iter)->name << "_;\n"; }
 				else{ (*file_) << "\t" << (*iter)->name << "++;\n"; }
 			}
@@ -252,16 +273,24 @@ void StructureEntry::WriteSource(std::ofstream *file_){
 				(*file_) << (*iter)->type << " *" << (*iter)->name << "_, ";
 			}
 			(*file_) << " const size_t &size_){\n";
+			bool has_unpacked = false;
 			for(std::vector<DataType*>::iterator iter = waveform_types.begin(); iter != waveform_types.end(); iter++){
 				if(!(*iter)->trace_value || (*iter)->mult_value){ continue; }
-				(*file_) << "\t" << (*iter)->name << ".reserve(size_);\n";
+				if((*iter)->is_packed){ (*file_) << "\tTraceCodec::Encode(" << (*iter)->name << "_, size_, " << (*iter)->name << ");\n"; }
+				else{ 
+					(*file_) << "\t" << (*iter)->name << ".reserve(size_);\n"; 
+					has_unpacked = true;
+				}
 			}
-			(*file_) << "\tfor(size_t index = 0; index < size_; index++){\n";
-			for(std::vector<DataType*>::iterator iter = waveform_types.begin(); iter != waveform_types.end(); iter++){
-				if(!(*iter)->trace_value || (*iter)->mult_value){ continue; }
-				(*file_) << "\t\t" << (*iter)->name << ".push_back(" << (*iter)->name << "_[index]);\n";
+			if(has_unpacked){
+				(*file_) << "\tfor(size_t index = 0; index < size_; index++){\n";
+				for(std::vector<DataType*>::iterator iter = waveform_types.begin(); iter != waveform_types.end(); iter++){
+					if(!(*iter)->trace_value || (*iter)->mult_value || (*iter)->is_packed){ continue; }
+					(*file_) << "\t\t" << (*iter)->name << ".push_back(" << (*iter)->name << "_[index]);\n";
+				}
+				(*file_) << "\t}\n";
 			}
-			(*file_) << "\t}\n}\n\n";
+			(*file_) << "}\n\n";
 		}
 	
 		// Zero
@@ -381,7 +410,8 @@ bool StructureFile::Open(){
 	hppfile << " * is used in the scan code should have its own Structure class. These classes\n";
 	hppfile << " * should contain simple C++ data types or vectors of simple C++ data types.\n";
 	hppfile << " * Vectors should be used for processors which are likely to have multiplicities\n";
-	hppfile << " * greater than one.\n\n";
+	hppfile << " * greater than one. Traces declared as 'packed:' are stored using TraceCodec\n";
+	hppfile << " * and must be unpacked with TraceCodec::Decode.\n\n";
 	hppfile << " * File automatically generated by\n";
 	hppfile << " *  RootClassBuilder (v. " << VERSION << ") on " << asctime(timeinfo);
 	hppfile << " *\n";
@@ -418,6 +448,7 @@ bool StructureFile::Open(){
 	hppfile << "};\n";
 	
 	cppfile << "#include \"Structures.h\"\n";
+	cppfile << "#include \"TraceCodec.hpp\"\n";
 
 	linkfile << "#ifdef __CINT__\n\n";
 	linkfile << "#include <vector>\n\n";